@@ -0,0 +1,20 @@
+#ifndef BENCHMARK_BENCH_UTIL_HPP_
+#define BENCHMARK_BENCH_UTIL_HPP_
+
+#include <stdint.h>
+#include <time.h>
+
+// ベンチマークで共通して使う関数
+
+namespace bench {
+
+// CLOCK_MONOTONIC の現在時刻(ns)
+inline int64_t GetNanoTime() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+}  // namespace bench
+
+#endif
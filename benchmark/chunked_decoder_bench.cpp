@@ -0,0 +1,179 @@
+// Transfer-Encoding: chunked のボディをデコードする処理のベンチマーク
+//
+// chunked のボディが kReadSize (16KB) ずつ届くたびにデコードし､
+// 1秒あたりに取り出せるボディのバイト数とチャンク1つあたりの時間を計測する｡
+//
+// 比較対象
+//   legacy:  以前の HttpRequest::ParseChunkedBody()｡ チャンク全体が届くまで
+//            待ち､届くたびにサイズの行を探し直して文字列にコピーする｡
+//   decoder: ChunkedDecoder｡ 届いた所まで1バイトずつ状態を進め､
+//            chunk-data はまとめて取り出す｡
+//
+// シナリオ (チャンクの大きさ)
+//   1B:   1バイトずつのチャンク (オーバーヘッドが最大になる)
+//   1KB:  1KB ずつのチャンク
+//   64KB: 64KB ずつのチャンク (1回の読み込みより大きい)
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "bench_util.hpp"
+#include "http/chunked_decoder.hpp"
+#include "http/scan.hpp"
+#include "utils/ByteBuffer.hpp"
+#include "utils/ByteVector.hpp"
+#include "utils/string.hpp"
+
+namespace {
+using namespace result;
+
+const size_t kReadSize = 16 * 1024;
+
+struct Scenario {
+  const char *name;
+  size_t chunk_size;
+  size_t body_size;
+};
+
+enum Method { kLegacy, kDecoder };
+
+std::string CreateChunkedBody(const Scenario &scenario) {
+  std::string res;
+  char size_line[32];
+  snprintf(size_line, sizeof(size_line), "%lx\r\n",
+           static_cast<unsigned long>(scenario.chunk_size));
+  for (size_t size = 0; size < scenario.body_size;
+       size += scenario.chunk_size) {
+    res += size_line;
+    res.append(scenario.chunk_size, 'a');
+    res += "\r\n";
+  }
+  return res + "0\r\n\r\n";
+}
+
+// 以前の CheckChunkReceived() と同じ処理
+Result<size_t> FindCrlfInBuffer(const utils::ByteBuffer &buffer,
+                                size_t start_pos) {
+  const char *begin = reinterpret_cast<const char *>(buffer.data());
+  const char *end = begin + buffer.size();
+  const char *found = http::FindCrlf(begin + start_pos, end);
+  if (found == end) {
+    return Error();
+  }
+  return found - begin;
+}
+
+// 終わりまでデコードできたら true を返す
+bool DecodeLegacy(utils::ByteBuffer &buffer, utils::ByteVector &body) {
+  while (buffer.empty() == false) {
+    Result<size_t> pos = FindCrlfInBuffer(buffer, 0);
+    if (pos.IsErr()) {
+      return false;
+    }
+    std::string size_str = buffer.SubstrBeforePos(pos.Ok());
+    Result<unsigned long> data_size =
+        utils::Stoul(size_str, utils::kHexadecimal);
+    if (data_size.IsErr()) {
+      return false;
+    }
+    if (data_size.Ok() == 0) {
+      buffer.EraseHead(size_str.size() + 2);
+      return true;
+    }
+    const size_t data_pos = size_str.size() + 2;
+    if (buffer.size() < data_pos + data_size.Ok() + 2) {
+      return false;
+    }
+    Result<size_t> data_end = FindCrlfInBuffer(buffer, data_pos);
+    if (data_end.IsErr() || data_end.Ok() - data_pos != data_size.Ok()) {
+      return false;
+    }
+    buffer.EraseHead(data_pos);
+    body.AppendDataToBuffer(buffer.data(), data_size.Ok());
+    buffer.EraseHead(data_size.Ok() + 2);
+  }
+  return false;
+}
+
+bool DecodeWithDecoder(http::ChunkedDecoder &decoder,
+                       utils::ByteBuffer &buffer, utils::ByteVector &body) {
+  while (buffer.empty() == false &&
+         decoder.GetStatus() == http::ChunkedDecoder::kInProgress) {
+    const utils::Byte *data;
+    size_t data_size;
+    size_t consumed =
+        decoder.Decode(buffer.data(), buffer.size(), &data, &data_size);
+    body.AppendDataToBuffer(data, data_size);
+    buffer.EraseHead(consumed);
+  }
+  return decoder.GetStatus() == http::ChunkedDecoder::kFinished;
+}
+
+// 全体をデコードするのにかかった時間(ns)を返す
+int64_t Bench(const std::string &input, Method method,
+              utils::ByteVector &body) {
+  const utils::Byte *bytes =
+      reinterpret_cast<const utils::Byte *>(input.data());
+  utils::ByteBuffer buffer;
+  http::ChunkedDecoder decoder;
+  body.clear();
+  bool is_finished = false;
+
+  int64_t start = bench::GetNanoTime();
+  for (size_t pos = 0; pos < input.size() && !is_finished;) {
+    size_t read_size = std::min(kReadSize, input.size() - pos);
+    buffer.AppendDataToBuffer(bytes + pos, read_size);
+    pos += read_size;
+    if (method == kLegacy) {
+      is_finished = DecodeLegacy(buffer, body);
+    } else {
+      is_finished = DecodeWithDecoder(decoder, buffer, body);
+    }
+  }
+  int64_t elapsed = bench::GetNanoTime() - start;
+  return is_finished ? elapsed : -1;
+}
+
+}  // namespace
+
+int main() {
+  const Scenario kScenarios[] = {{"1B", 1, 256 * 1024},
+                                 {"1KB", 1024, 8 * 1024 * 1024},
+                                 {"64KB", 64 * 1024, 8 * 1024 * 1024}};
+  const char *kMethodNames[] = {"legacy", "decoder"};
+  const int kRepeat = 5;
+
+  printf("%6s %8s %10s %12s %14s\n", "chunk", "method", "body", "MB/s",
+         "ns/chunk");
+  for (size_t i = 0; i < sizeof(kScenarios) / sizeof(kScenarios[0]); ++i) {
+    const Scenario &scenario = kScenarios[i];
+    const std::string input = CreateChunkedBody(scenario);
+    const size_t chunk_num = scenario.body_size / scenario.chunk_size;
+    utils::ByteVector body;
+    body.reserve(scenario.body_size);
+    for (int m = kLegacy; m <= kDecoder; ++m) {
+      // 一番速かった回の時間を使う
+      int64_t best = -1;
+      for (int r = 0; r < kRepeat; ++r) {
+        int64_t elapsed = Bench(input, static_cast<Method>(m), body);
+        if (elapsed < 0 || body.size() != scenario.body_size) {
+          fprintf(stderr, "%s %s: decode error\n", scenario.name,
+                  kMethodNames[m]);
+          return 1;
+        }
+        if (best < 0 || elapsed < best) {
+          best = elapsed;
+        }
+      }
+      const double elapsed = static_cast<double>(best);
+      printf("%6s %8s %10lu %12.1f %14.1f\n", scenario.name, kMethodNames[m],
+             static_cast<unsigned long>(scenario.body_size),
+             scenario.body_size / elapsed * 1e9 / (1024 * 1024),
+             elapsed / chunk_num);
+    }
+  }
+  return 0;
+}
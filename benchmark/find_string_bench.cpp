@@ -0,0 +1,124 @@
+// ヘッダーとボディの区切り(\r\n\r\n)を探す処理のベンチマーク
+//
+// ヘッダーが read_size ずつ届くたびに区切りを探し､
+// 区切りが見つかるまでにかかった時間を計測する｡
+//
+// 比較対象
+//   naive:   ByteVector::FindString() の以前の実装｡ 1バイトずつ at() で比較し､
+//            届くたびに先頭から探し直す｡
+//   rescan:  memmem() で探すが､届くたびに先頭から探し直す｡
+//   resume:  memmem() で前回探し終えた位置から探す｡ (HttpRequest の方式)
+//
+// シナリオ
+//   typical:    普通のブラウザのリクエスト程度のヘッダーが 1KB ずつ届く
+//   cookie:     大きな Cookie を含むヘッダーが 1KB ずつ届く
+//   slow:       大きなヘッダーが 16 バイトずつ届く (slowloris のような送り方)
+//   crlf-heavy: 短いヘッダー行が大量に並び､区切りの一部に何度も一致する
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <string>
+
+#include "bench_util.hpp"
+#include "utils/ByteBuffer.hpp"
+
+namespace {
+using namespace result;
+
+const std::string kBoundary = "\r\n\r\n";
+
+struct Scenario {
+  const char *name;
+  size_t header_size;
+  size_t read_size;
+  // ヘッダーを埋める1行
+  const char *line;
+};
+
+enum Method { kNaive, kRescan, kResume };
+
+std::string CreateHeader(const Scenario &scenario) {
+  std::string header = "GET / HTTP/1.1\r\nHost: localhost\r\n";
+  while (header.size() + kBoundary.size() < scenario.header_size) {
+    header += scenario.line;
+  }
+  header.resize(scenario.header_size - kBoundary.size(), 'a');
+  return header + kBoundary;
+}
+
+// 以前の ByteVector::FindString() と同じ実装
+Result<size_t> FindStringNaive(const utils::ByteVector &vec,
+                               const std::string &str) {
+  if (str.size() > vec.size()) {
+    return Error();
+  }
+  for (size_t i = 0; i < (vec.size() - str.size() + 1); i++) {
+    for (size_t j = 0; j < str.size(); j++) {
+      if (str[j] != vec.at(i + j))
+        break;
+      if (j + 1 == str.size())
+        return i;
+    }
+  }
+  return Error();
+}
+
+// 区切りが見つかるまでの時間(ns)を返す
+int64_t Bench(const std::string &header, size_t read_size, Method method) {
+  const utils::Byte *bytes =
+      reinterpret_cast<const utils::Byte *>(header.data());
+  utils::ByteVector vec;
+  utils::ByteBuffer buffer;
+  size_t search_pos = 0;
+
+  int64_t start = bench::GetNanoTime();
+  for (size_t pos = 0; pos < header.size(); pos += read_size) {
+    size_t size =
+        header.size() - pos < read_size ? header.size() - pos : read_size;
+    if (method == kNaive) {
+      vec.AppendDataToBuffer(bytes + pos, size);
+      if (FindStringNaive(vec, kBoundary).IsOk())
+        break;
+    } else {
+      buffer.AppendDataToBuffer(bytes + pos, size);
+      Result<size_t> res = buffer.FindString(kBoundary, search_pos);
+      if (res.IsOk())
+        break;
+      if (method == kResume)
+        search_pos = buffer.GetResumePos(kBoundary);
+    }
+  }
+  return bench::GetNanoTime() - start;
+}
+
+}  // namespace
+
+int main() {
+  const Scenario kScenarios[] = {
+      {"typical", 512, 1024, "Accept-Language: ja,en-US;q=0.9\r\n"},
+      {"cookie", 8 * 1024, 1024, "Cookie: session=0123456789abcdef\r\n"},
+      {"slow", 64 * 1024, 16, "X-Padding: 0123456789abcdef\r\n"},
+      {"crlf-heavy", 64 * 1024, 1024, "a:\r\n"}};
+  const int kRepeat = 5;
+
+  printf("%12s %10s %10s %14s %14s %14s\n", "scenario", "header", "read",
+         "naive[us]", "rescan[us]", "resume[us]");
+  for (size_t i = 0; i < sizeof(kScenarios) / sizeof(kScenarios[0]); ++i) {
+    const Scenario &scenario = kScenarios[i];
+    std::string header = CreateHeader(scenario);
+    int64_t elapsed[3] = {0, 0, 0};
+    for (int r = 0; r < kRepeat; ++r) {
+      elapsed[kNaive] += Bench(header, scenario.read_size, kNaive);
+      elapsed[kRescan] += Bench(header, scenario.read_size, kRescan);
+      elapsed[kResume] += Bench(header, scenario.read_size, kResume);
+    }
+    printf("%12s %10lu %10lu %14.2f %14.2f %14.2f\n", scenario.name,
+           static_cast<unsigned long>(header.size()),
+           static_cast<unsigned long>(scenario.read_size),
+           elapsed[kNaive] / 1000.0 / kRepeat,
+           elapsed[kRescan] / 1000.0 / kRepeat,
+           elapsed[kResume] / 1000.0 / kRepeat);
+  }
+  return 0;
+}
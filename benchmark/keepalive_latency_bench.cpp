@@ -0,0 +1,209 @@
+// keep-alive の接続で小さいレスポンスを返す時のレイテンシのベンチマーク
+//
+// 1つの接続でリクエストを送ってレスポンスを全て受け取るのを繰り返し､
+// 1往復にかかった時間の平均､中央値､99パーセンタイルを計測する｡
+//
+// 引数なしで実行した場合はベンチマーク内のサーバーに対して以下を比較する｡
+//   split:  ヘッダーとボディを別々の write(2) で書き込む
+//   writev: ヘッダーとボディを1回の writev(2) で書き込む (OutputChain の方式)
+// それぞれ TCP_NODELAY を付けない場合と付けた場合を計測する｡
+// split で TCP_NODELAY を付けないと､ボディが Nagle アルゴリズムで
+// クライアントの遅延 ACK を待つので1往復ごとに数十ms 遅れる｡
+//
+// 起動している webserv に対して計測する場合
+//   keepalive_latency_bench <port> <path> [requests]
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench_util.hpp"
+
+namespace {
+
+const char kBody[] = "hello, world\n";
+
+enum WriteMethod { kSplit, kWritev };
+
+struct ServerArg {
+  int listen_fd;
+  WriteMethod method;
+  bool is_nodelay;
+};
+
+void SetNodelay(int fd) {
+  int optval = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+}
+
+// 127.0.0.1 の空いているポートで listen し､ポート番号を *port に入れる
+int ListenLocal(int *port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  socklen_t addrlen = sizeof(addr);
+  if (bind(fd, reinterpret_cast<struct sockaddr *>(&addr), addrlen) < 0 ||
+      listen(fd, 1) < 0 ||
+      getsockname(fd, reinterpret_cast<struct sockaddr *>(&addr), &addrlen) <
+          0) {
+    perror("listen");
+    exit(1);
+  }
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+int ConnectLocal(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  if (connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) <
+      0) {
+    perror("connect");
+    exit(1);
+  }
+  return fd;
+}
+
+// リクエストを1つ受け取るたびに小さいレスポンスを返す
+void *ServeConnection(void *arg) {
+  const ServerArg *server_arg = static_cast<const ServerArg *>(arg);
+  int fd = accept(server_arg->listen_fd, NULL, NULL);
+  if (server_arg->is_nodelay) {
+    SetNodelay(fd);
+  }
+  char header[128];
+  int header_len = snprintf(header, sizeof(header),
+                            "HTTP/1.1 200 OK\r\nContent-Length: %lu\r\n\r\n",
+                            static_cast<unsigned long>(sizeof(kBody) - 1));
+  std::string request;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    request.append(buf, n);
+    std::string::size_type pos;
+    while ((pos = request.find("\r\n\r\n")) != std::string::npos) {
+      request.erase(0, pos + 4);
+      if (server_arg->method == kSplit) {
+        write(fd, header, header_len);
+        write(fd, kBody, sizeof(kBody) - 1);
+      } else {
+        struct iovec iov[2];
+        iov[0].iov_base = header;
+        iov[0].iov_len = header_len;
+        iov[1].iov_base = const_cast<char *>(kBody);
+        iov[1].iov_len = sizeof(kBody) - 1;
+        writev(fd, iov, 2);
+      }
+    }
+  }
+  close(fd);
+  return NULL;
+}
+
+// レスポンスのヘッダーとボディを全て受け取る
+bool ReadResponse(int fd) {
+  std::string response;
+  char buf[64 * 1024];
+  while (true) {
+    std::string::size_type header_end = response.find("\r\n\r\n");
+    if (header_end != std::string::npos) {
+      std::string::size_type pos = response.find("Content-Length: ");
+      if (pos != std::string::npos && pos < header_end) {
+        size_t content_length = std::strtoul(
+            response.c_str() + pos + std::strlen("Content-Length: "), NULL, 10);
+        if (response.size() >= header_end + 4 + content_length) {
+          return true;
+        }
+      }
+    }
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n <= 0) {
+      return false;
+    }
+    response.append(buf, n);
+  }
+}
+
+// requests 回往復した時間(ns)を返す
+std::vector<int64_t> Bench(int port, const std::string &path, int requests) {
+  int fd = ConnectLocal(port);
+  std::string request =
+      "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  std::vector<int64_t> elapsed;
+  for (int i = 0; i < requests; ++i) {
+    int64_t start = bench::GetNanoTime();
+    write(fd, request.data(), request.size());
+    if (!ReadResponse(fd)) {
+      fprintf(stderr, "connection closed\n");
+      exit(1);
+    }
+    elapsed.push_back(bench::GetNanoTime() - start);
+  }
+  close(fd);
+  return elapsed;
+}
+
+void PrintResult(const char *name, std::vector<int64_t> elapsed) {
+  std::sort(elapsed.begin(), elapsed.end());
+  int64_t total = 0;
+  for (size_t i = 0; i < elapsed.size(); ++i) {
+    total += elapsed[i];
+  }
+  printf("%20s %12.1f %12.1f %12.1f\n", name,
+         total / 1000.0 / elapsed.size(),
+         elapsed[elapsed.size() / 2] / 1000.0,
+         elapsed[elapsed.size() * 99 / 100] / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  printf("%20s %12s %12s %12s\n", "method", "avg[us]", "p50[us]", "p99[us]");
+  if (argc >= 3) {
+    int requests = argc >= 4 ? std::atoi(argv[3]) : 1000;
+    PrintResult("webserv", Bench(std::atoi(argv[1]), argv[2], requests));
+    return 0;
+  }
+
+  // 遅延 ACK で待つ場合は1往復に数十ms かかるので回数は少なめにする
+  const int kRequests = 50;
+  const struct {
+    const char *name;
+    WriteMethod method;
+    bool is_nodelay;
+  } kCases[] = {{"split", kSplit, false},
+                {"split+nodelay", kSplit, true},
+                {"writev", kWritev, false},
+                {"writev+nodelay", kWritev, true}};
+  for (size_t i = 0; i < sizeof(kCases) / sizeof(kCases[0]); ++i) {
+    int port;
+    ServerArg arg;
+    arg.listen_fd = ListenLocal(&port);
+    arg.method = kCases[i].method;
+    arg.is_nodelay = kCases[i].is_nodelay;
+    pthread_t thread;
+    pthread_create(&thread, NULL, ServeConnection, &arg);
+    PrintResult(kCases[i].name, Bench(port, "/", kRequests));
+    pthread_join(thread, NULL);
+    close(arg.listen_fd);
+  }
+  return 0;
+}
@@ -0,0 +1,124 @@
+// HttpRequest でリクエストのヘッダーをパースする処理のベンチマーク
+//
+// 同じリクエストを繰り返しパースし､1リクエストあたりの時間､
+// 1コアで1秒あたりにパースできるリクエスト数とメモリ確保(operator new)の
+// 回数を計測する｡
+// パースした後はレスポンスを作る時と同じように Host などのヘッダーだけを読む｡
+//
+// シナリオ
+//   minimal: Host だけのリクエスト
+//   browser: 普通のブラウザが送る程度のヘッダー
+//   heavy:   大きな Cookie と Authorization を含むヘッダー
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "bench_util.hpp"
+#include "config/config_parser.hpp"
+#include "http/http_request.hpp"
+#include "utils/ByteBuffer.hpp"
+
+namespace {
+
+long alloc_count = 0;
+
+struct Scenario {
+  const char *name;
+  std::string request;
+};
+
+std::string CreateRequest(const std::string &headers) {
+  return "GET /index.html?q=1 HTTP/1.1\r\nHost: localhost:8080\r\n" + headers +
+         "\r\n";
+}
+
+}  // namespace
+
+// メモリ確保の回数を数える
+void *operator new(size_t size) throw(std::bad_alloc) {
+  ++alloc_count;
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) throw() {
+  std::free(p);
+}
+
+int main() {
+  config::Parser parser;
+  parser.LoadData(
+      "server {"
+      "  listen 8080;"
+      "  location / {"
+      "    allow_method GET POST;"
+      "    root /var/www/html;"
+      "  }"
+      "}");
+  const config::Config conf = parser.ParseConfig();
+
+  const std::string browser_headers =
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+      "Accept-Language: ja,en-US;q=0.9,en;q=0.8\r\n"
+      "Accept-Encoding: gzip, deflate, br\r\n"
+      "Connection: keep-alive\r\n"
+      "Upgrade-Insecure-Requests: 1\r\n"
+      "Sec-Fetch-Dest: document\r\n"
+      "Sec-Fetch-Mode: navigate\r\n"
+      "Sec-Fetch-Site: none\r\n"
+      "Cache-Control: max-age=0\r\n";
+  std::string cookie = "Cookie: ";
+  for (int i = 0; i < 40; ++i) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%sk%02d=0123456789abcdef0123456789",
+             i == 0 ? "" : "; ", i);
+    cookie += buf;
+  }
+  const std::string heavy_headers =
+      browser_headers + cookie + "\r\n" + "Authorization: Bearer " +
+      std::string(1024, 'x') + "\r\n" +
+      "X-Forwarded-For: 10.0.0.1, 10.0.0.2\r\n";
+
+  const Scenario kScenarios[] = {{"minimal", CreateRequest("")},
+                                 {"browser", CreateRequest(browser_headers)},
+                                 {"heavy", CreateRequest(heavy_headers)}};
+  const int kRepeat = 20000;
+
+  printf("%10s %8s %14s %12s %12s\n", "scenario", "size", "time[ns/req]",
+         "req/s", "allocs/req");
+  for (size_t i = 0; i < sizeof(kScenarios) / sizeof(kScenarios[0]); ++i) {
+    const Scenario &scenario = kScenarios[i];
+    // 時刻の取得が遅い環境もあるので､ループ全体の時間を計測する｡
+    // (バッファを作る時間も含む)
+    long allocs = 0;
+    int64_t start = bench::GetNanoTime();
+    for (int r = 0; r < kRepeat; ++r) {
+      utils::ByteBuffer buffer(scenario.request);
+      long alloc_start = alloc_count;
+      {
+        http::HttpRequest request;
+        request.ParseRequest(buffer, conf, config::kAnyIpAddress, "8080");
+        if (request.IsErrorRequest()) {
+          fprintf(stderr, "%s: parse error\n", scenario.name);
+          return 1;
+        }
+        request.GetHeader(http::kHeaderConnection);
+      }
+      allocs += alloc_count - alloc_start;
+    }
+    const double elapsed = static_cast<double>(bench::GetNanoTime() - start);
+    printf("%10s %8lu %14.1f %12.0f %12.1f\n", scenario.name,
+           static_cast<unsigned long>(scenario.request.size()),
+           elapsed / kRepeat, kRepeat / elapsed * 1e9,
+           static_cast<double>(allocs) / kRepeat);
+  }
+  return 0;
+}
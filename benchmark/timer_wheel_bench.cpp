@@ -0,0 +1,180 @@
+// Epoll のタイムアウト処理のベンチマーク
+//
+// 接続数を 1k ~ 100k に変えて､イベントループ1回あたりのタイムアウト処理に
+// かかる時間を計測する｡ 比較対象として TimerWheel 導入前の
+// registered_fd_events_ を全走査する方式も計測する｡
+//
+// 実際の fd は使わず､100ms ごとにループが回るのを仮想時刻で再現する｡
+//
+// シナリオ
+//   idle:      5秒のタイムアウト｡ 大半の接続がアイドルでタイムアウトし､
+//              新しい接続に置き換わる｡ (期限切れの数は接続数に比例する)
+//   keepalive: 120秒のタイムアウト｡ 計測期間中に期限切れになる接続はない｡
+
+#include <stdint.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "server/epoll.hpp"
+#include "server/timer_wheel.hpp"
+
+namespace {
+
+const long kLoopIntervalMs = 100;
+const int kIterations = 600;
+// 1回のループでアクティビティがある接続の割合(%)
+const int kActivePercent = 1;
+
+struct Scenario {
+  const char *name;
+  long timeout_ms;
+  // last_active の初期値を [now - spread, now] に散らばらせる
+  long last_active_spread_ms;
+};
+
+struct BenchResult {
+  double ns_per_iter;
+  double expired_per_iter;
+};
+
+std::vector<server::FdEvent *> CreateFdEvents(int num, long now_ms,
+                                              const Scenario &scenario) {
+  std::vector<server::FdEvent *> fdes;
+  for (int i = 0; i < num; ++i) {
+    server::FdEvent *fde = server::CreateFdEvent(i, NULL, NULL);
+    fde->state = server::kFdeRead | server::kFdeTimeout;
+    fde->timeout_ms = scenario.timeout_ms;
+    fde->last_active = now_ms - (rand() % scenario.last_active_spread_ms);
+    fdes.push_back(fde);
+  }
+  return fdes;
+}
+
+void DeleteFdEvents(std::vector<server::FdEvent *> &fdes) {
+  for (size_t i = 0; i < fdes.size(); ++i) {
+    delete fdes[i];
+  }
+  fdes.clear();
+}
+
+// 1回のループでアクティビティがあった接続の last_active を更新する
+void TouchActiveFdEvents(std::vector<server::FdEvent *> &fdes, long now_ms) {
+  int active_num = fdes.size() * kActivePercent / 100;
+  for (int i = 0; i < active_num; ++i) {
+    fdes[rand() % fdes.size()]->last_active = now_ms;
+  }
+}
+
+// TimerWheel 導入前の Epoll::RetrieveTimeouts() と同じ全走査
+void RetrieveTimeoutsByScan(const std::map<int, server::FdEvent *> &fd_events,
+                            long now_ms,
+                            std::vector<server::FdEvent *> &expired) {
+  for (std::map<int, server::FdEvent *>::const_iterator it = fd_events.begin();
+       it != fd_events.end(); ++it) {
+    server::FdEvent *fde = it->second;
+    if (fde->state & server::kFdeTimeout &&
+        now_ms - fde->last_active > fde->timeout_ms) {
+      expired.push_back(fde);
+    }
+  }
+}
+
+BenchResult BenchScan(int num, const Scenario &scenario) {
+  long now_ms = 0;
+  std::vector<server::FdEvent *> fdes =
+      CreateFdEvents(num, now_ms, scenario);
+  std::map<int, server::FdEvent *> fd_events;
+  for (size_t i = 0; i < fdes.size(); ++i) {
+    fd_events[fdes[i]->fd] = fdes[i];
+  }
+
+  int64_t elapsed = 0;
+  size_t expired_num = 0;
+  std::vector<server::FdEvent *> expired;
+  for (int i = 0; i < kIterations; ++i) {
+    now_ms += kLoopIntervalMs;
+    TouchActiveFdEvents(fdes, now_ms);
+
+    expired.clear();
+    int64_t start = bench::GetNanoTime();
+    RetrieveTimeoutsByScan(fd_events, now_ms, expired);
+    elapsed += bench::GetNanoTime() - start;
+    expired_num += expired.size();
+
+    // タイムアウトした接続は閉じられ､新しい接続に置き換わる
+    for (size_t j = 0; j < expired.size(); ++j) {
+      expired[j]->last_active = now_ms;
+    }
+  }
+  DeleteFdEvents(fdes);
+
+  BenchResult result;
+  result.ns_per_iter = static_cast<double>(elapsed) / kIterations;
+  result.expired_per_iter = static_cast<double>(expired_num) / kIterations;
+  return result;
+}
+
+BenchResult BenchTimerWheel(int num, const Scenario &scenario) {
+  long now_ms = 0;
+  std::vector<server::FdEvent *> fdes =
+      CreateFdEvents(num, now_ms, scenario);
+  server::TimerWheel timer_wheel(now_ms);
+  for (size_t i = 0; i < fdes.size(); ++i) {
+    timer_wheel.Arm(fdes[i], now_ms);
+  }
+
+  int64_t elapsed = 0;
+  size_t expired_num = 0;
+  std::vector<server::FdEvent *> expired;
+  for (int i = 0; i < kIterations; ++i) {
+    now_ms += kLoopIntervalMs;
+    TouchActiveFdEvents(fdes, now_ms);
+
+    expired.clear();
+    int64_t start = bench::GetNanoTime();
+    timer_wheel.RetrieveExpired(now_ms, expired);
+    elapsed += bench::GetNanoTime() - start;
+    expired_num += expired.size();
+
+    for (size_t j = 0; j < expired.size(); ++j) {
+      expired[j]->last_active = now_ms;
+      timer_wheel.Arm(expired[j], now_ms);
+    }
+  }
+  DeleteFdEvents(fdes);
+
+  BenchResult result;
+  result.ns_per_iter = static_cast<double>(elapsed) / kIterations;
+  result.expired_per_iter = static_cast<double>(expired_num) / kIterations;
+  return result;
+}
+
+}  // namespace
+
+int main() {
+  const int kFdNums[] = {1000, 10000, 100000};
+  const Scenario kScenarios[] = {{"idle", 5 * 1000, 5 * 1000},
+                                 {"keepalive", 120 * 1000, 1}};
+
+  srand(42);
+  for (size_t i = 0; i < sizeof(kScenarios) / sizeof(kScenarios[0]); ++i) {
+    const Scenario &scenario = kScenarios[i];
+    printf("scenario: %s (timeout %ldms, %d iterations)\n", scenario.name,
+           scenario.timeout_ms, kIterations);
+    printf("%10s %16s %16s %16s\n", "fds", "expired/iter", "scan[us/iter]",
+           "wheel[us/iter]");
+    for (size_t j = 0; j < sizeof(kFdNums) / sizeof(kFdNums[0]); ++j) {
+      BenchResult scan = BenchScan(kFdNums[j], scenario);
+      BenchResult wheel = BenchTimerWheel(kFdNums[j], scenario);
+      printf("%10d %16.1f %16.2f %16.2f\n", kFdNums[j],
+             wheel.expired_per_iter, scan.ns_per_iter / 1000,
+             wheel.ns_per_iter / 1000);
+    }
+    printf("\n");
+  }
+  return 0;
+}
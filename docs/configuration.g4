@@ -1,6 +1,42 @@
 grammar configuration;
 
-config: server (NEWLINE server)*;
+config: (config_directive | server) (
+		NEWLINE (config_directive | server)
+	)*;
+config_directive:
+	edge_triggered_directive
+	| worker_processes_directive
+	| worker_threads_directive
+	| thread_balancing_directive
+	| event_backend_directive
+	| reuse_port_directive
+	| accept_batch_directive
+	| epoll_events_directive
+	| sendfile_directive
+	| tcp_nodelay_directive
+	| tcp_nopush_directive
+	| connection_buffer_limit_directive
+	| client_body_buffer_size_directive;
+edge_triggered_directive:
+	'edge_triggered' WHITESPACE ON_OFF END_DIRECTIVE;
+worker_processes_directive:
+	'worker_processes' WHITESPACE (NUMBER | 'auto') END_DIRECTIVE;
+worker_threads_directive:
+	'worker_threads' WHITESPACE (NUMBER | 'auto') END_DIRECTIVE;
+thread_balancing_directive:
+	'thread_balancing' WHITESPACE ('round_robin' | 'least_conn') END_DIRECTIVE;
+event_backend_directive:
+	'event_backend' WHITESPACE ('epoll' | 'io_uring') END_DIRECTIVE;
+reuse_port_directive: 'reuse_port' WHITESPACE ON_OFF END_DIRECTIVE;
+accept_batch_directive: 'accept_batch' WHITESPACE NUMBER END_DIRECTIVE;
+epoll_events_directive: 'epoll_events' WHITESPACE NUMBER END_DIRECTIVE;
+sendfile_directive: 'sendfile' WHITESPACE ON_OFF END_DIRECTIVE;
+tcp_nodelay_directive: 'tcp_nodelay' WHITESPACE ON_OFF END_DIRECTIVE;
+tcp_nopush_directive: 'tcp_nopush' WHITESPACE ON_OFF END_DIRECTIVE;
+connection_buffer_limit_directive:
+	'connection_buffer_limit' WHITESPACE NUMBER END_DIRECTIVE;
+client_body_buffer_size_directive:
+	'client_body_buffer_size' WHITESPACE NUMBER END_DIRECTIVE;
 server: 'server' '{' server_directive+ '}';
 server_directive:
 	listen_directive
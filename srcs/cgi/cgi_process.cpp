@@ -1,5 +1,6 @@
 #include "cgi/cgi_process.hpp"
 
+#include <cerrno>
 #include <csignal>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -13,6 +14,8 @@ CgiProcess::CgiProcess(const config::LocationConf *location, Epoll *epoll,
                        ConnSocket *socket)
     : cgi_request_(NULL),
       cgi_response_(NULL),
+      cgi_input_(),
+      cgi_input_offset_(0),
       cgi_input_buffer_(),
       cgi_output_buffer_(),
       location_(location),
@@ -57,13 +60,13 @@ http::HttpStatus CgiProcess::RunCgi(server::ConnSocket *conn_sock,
     cgi_response_ = NULL;
     return cgi_res_code;
   }
-  cgi_input_buffer_.insert(cgi_input_buffer_.begin(), request.GetBody().begin(),
-                           request.GetBody().end());
+  cgi_input_ = request.GetBody();
+  cgi_input_offset_ = 0;
 
   FdEvent *fde =
       CreateFdEvent(cgi_request_->GetCgiUnisock(), HandleCgiEvent, this);
   epoll_->Register(fde);
-  if (!cgi_input_buffer_.empty()) {
+  if (!cgi_input_.empty()) {
     epoll_->Add(fde, kFdeWrite);
   } else {
     shutdown(cgi_request_->GetCgiUnisock(), SHUT_WR);
@@ -132,7 +135,32 @@ void CgiProcess::EnableWriteEventToClient() const {
   if (client_fde == NULL) {
     return;
   }
-  epoll_->Add(client_fde, kFdeWrite);
+  if (epoll_->IsEdgeTriggered()) {
+    // エッジトリガーでは書き込みイベントを常に監視しているので､
+    // 通知させるために再登録する
+    epoll_->Rearm(client_fde);
+  } else {
+    epoll_->Add(client_fde, kFdeWrite);
+  }
+}
+
+Result<void> CgiProcess::FillInputBuffer() {
+  size_t size = cgi_input_.size() - cgi_input_offset_;
+  if (size > kDataPerWrite) {
+    size = kDataPerWrite;
+  }
+  Result<size_t> read_res = cgi_input_.Read(
+      cgi_input_offset_, cgi_input_buffer_.PrepareWrite(size), size);
+  if (read_res.IsErr() || read_res.Ok() == 0) {
+    return Error();
+  }
+  cgi_input_buffer_.CommitWrite(read_res.Ok());
+  cgi_input_offset_ += read_res.Ok();
+  return Result<void>();
+}
+
+bool CgiProcess::IsInputFinished() const {
+  return cgi_input_buffer_.empty() && cgi_input_offset_ == cgi_input_.size();
 }
 
 void CgiProcess::HandleCgiEvent(FdEvent *fde, unsigned int events, void *data,
@@ -171,15 +199,24 @@ void CgiProcess::HandleCgiEvent(FdEvent *fde, unsigned int events, void *data,
 bool CgiProcess::HandleCgiWriteEvent(CgiProcess *cgi_process, FdEvent *fde,
                                      Epoll *epoll) {
   CgiRequest *cgi_request = cgi_process->cgi_request_;
+  utils::ByteBuffer &input_buffer = cgi_process->cgi_input_buffer_;
   // Write request's body to unisock
-  ssize_t write_res =
-      write(cgi_request->GetCgiUnisock(), cgi_process->cgi_input_buffer_.data(),
-            cgi_process->cgi_input_buffer_.size());
-  if (write_res < 0) {
-    return true;
-  }
-  cgi_process->cgi_input_buffer_.EraseHead(write_res);
-  if (cgi_process->cgi_input_buffer_.empty()) {
+  // エッジトリガーの場合は書き込めなくなるまで書き込む
+  do {
+    if (input_buffer.empty() && cgi_process->FillInputBuffer().IsErr()) {
+      return true;
+    }
+    ssize_t write_res = write(cgi_request->GetCgiUnisock(),
+                              input_buffer.data(), input_buffer.size());
+    if (write_res < 0) {
+      return !(epoll->IsEdgeTriggered() &&
+               (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+    input_buffer.EraseHead(write_res);
+  } while (epoll->IsEdgeTriggered() && !cgi_process->IsInputFinished());
+
+  if (cgi_process->IsInputFinished()) {
+    cgi_process->cgi_input_.clear();
     shutdown(cgi_request->GetCgiUnisock(), SHUT_WR);
     epoll->Del(fde, kFdeWrite);
   }
@@ -189,18 +226,30 @@ bool CgiProcess::HandleCgiWriteEvent(CgiProcess *cgi_process, FdEvent *fde,
 bool CgiProcess::HandleCgiReadEvent(CgiProcess *cgi_process) {
   CgiRequest *cgi_request = cgi_process->cgi_request_;
   CgiResponse *cgi_response = cgi_process->cgi_response_;
+  bool is_edge_triggered = cgi_process->epoll_->IsEdgeTriggered();
+  bool is_finished = false;
   // Read data from unisock and store data in buffer
-  utils::Byte buf[kDataPerRead];
-  ssize_t read_res = read(cgi_request->GetCgiUnisock(), buf, kDataPerRead);
+  // エッジトリガーの場合は EAGAIN になるまで読み込む
+  utils::ByteBuffer &output_buffer = cgi_process->cgi_output_buffer_;
+  do {
+    ssize_t read_res = read(cgi_request->GetCgiUnisock(),
+                            output_buffer.PrepareWrite(kDataPerRead),
+                            kDataPerRead);
+    if (read_res < 0 && is_edge_triggered &&
+        (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (read_res <= 0) {
+      is_finished = true;
+      break;
+    }
+    output_buffer.CommitWrite(read_res);
+    cgi_response->Parse(output_buffer);
+  } while (is_edge_triggered);
+  output_buffer.ReleaseIfEmpty();
 
   cgi_process->EnableWriteEventToClient();
-
-  if (read_res <= 0) {
-    return true;
-  }
-  cgi_process->cgi_output_buffer_.AppendDataToBuffer(buf, read_res);
-  cgi_response->Parse(cgi_process->cgi_output_buffer_);
-  return false;
+  return is_finished;
 }
 
 }  // namespace cgi
@@ -3,6 +3,7 @@
 
 #include "cgi/cgi_request.hpp"
 #include "cgi/cgi_response.hpp"
+#include "utils/SpoolBuffer.hpp"
 
 namespace cgi {
 
@@ -20,14 +21,18 @@ class CgiProcess {
 
  private:
   static const unsigned long kDataPerRead = 1024;   // 1KB
-  static const unsigned long kDataPerWrite = 1024;  // 1KB
-  static const long kUnisockTimeout = 5 * 1000;     // 5[sec]
+  static const unsigned long kDataPerWrite = 64 * 1024;  // 64KB
+  static const long kUnisockTimeout = 5 * 1000;          // 5[sec]
 
   CgiRequest *cgi_request_;
   CgiResponse *cgi_response_;
 
-  utils::ByteVector cgi_input_buffer_;
-  utils::ByteVector cgi_output_buffer_;
+  // CGI の標準入力に書き込むリクエストのボディ｡
+  // cgi_input_buffer_ が空になったら kDataPerWrite ずつ読み込む｡
+  utils::SpoolBuffer cgi_input_;
+  size_t cgi_input_offset_;
+  utils::ByteBuffer cgi_input_buffer_;
+  utils::ByteBuffer cgi_output_buffer_;
 
   const config::LocationConf *location_;
   Epoll *epoll_;
@@ -68,6 +73,11 @@ class CgiProcess {
 
   void EnableWriteEventToClient() const;
 
+  // cgi_input_ の続きを cgi_input_buffer_ に読み込む
+  Result<void> FillInputBuffer();
+  // ボディを全て書き込んだか
+  bool IsInputFinished() const;
+
   static void HandleCgiEvent(FdEvent *fde, unsigned int events, void *data,
                              Epoll *epoll);
   static bool HandleCgiWriteEvent(CgiProcess *cgi_process, FdEvent *fde,
@@ -6,6 +6,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <cstdlib>
+#include <cstring>
 #include <map>
 #include <set>
 
@@ -19,6 +21,20 @@
 namespace cgi {
 
 const std::string CgiRequest::kPython = "python3";
+const std::string CgiRequest::kDefaultExecutorSearchPath = "/bin:/usr/bin";
+
+namespace {
+
+// fork(2) した子プロセスから write(2) だけでエラーを出力する
+void WriteErrorInChild(const char *message, const std::string &path) {
+  if (write(STDERR_FILENO, message, strlen(message)) < 0 ||
+      write(STDERR_FILENO, path.data(), path.size()) < 0 ||
+      write(STDERR_FILENO, "\n", 1) < 0) {
+    return;
+  }
+}
+
+}  // namespace
 
 CgiRequest::CgiRequest() : cgi_pid_(-1), cgi_unisock_(-1) {}
 
@@ -152,7 +168,21 @@ bool CgiRequest::DetermineExecutionCgiPath(
 
 // Exec Cgi
 // ========================================================================
+// ワーカーが複数のスレッドで動いている場合､fork(2) した時に他のスレッドが
+// 持っていたロック(malloc, stdio など)は子プロセスでは解放されない｡
+// そのため子プロセスでは async-signal-safe な関数しか呼ばないように､
+// execve(2) に渡すものは全て fork の前に作っておく｡
 bool CgiRequest::ForkAndExecuteCgi() {
+  Result<std::string> exec_dir = GetCgiExecutionDir();
+  if (exec_dir.IsErr()) {
+    utils::PrintLog("GetCgiExecutionDir fail %s",
+                    exec_cgi_script_path_.c_str());
+    return false;
+  }
+  ExecParams params;
+  params.path = SearchExecutorPath();
+  params.dir = exec_dir.Ok();
+
   int sockfds[2];
   if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockfds) == -1) {
     return false;
@@ -161,8 +191,13 @@ bool CgiRequest::ForkAndExecuteCgi() {
   int parentsock = sockfds[0];
   int childsock = sockfds[1];
 
-  if (AddNonBlockingOptToFd(parentsock) == false ||
-      CreateAndRunChildProcesses(parentsock, childsock) == false) {
+  params.argv = utils::AllocVectorStringToCharDptr(CreateArgv());
+  params.envp = utils::AllocVectorStringToCharDptr(CreateEnvp());
+  bool is_ok = AddNonBlockingOptToFd(parentsock) &&
+               CreateAndRunChildProcesses(parentsock, childsock, params);
+  utils::DeleteCharDprt(params.argv);
+  utils::DeleteCharDprt(params.envp);
+  if (!is_ok) {
     close(parentsock);
     close(childsock);
     return false;
@@ -172,7 +207,8 @@ bool CgiRequest::ForkAndExecuteCgi() {
   return true;
 }
 
-bool CgiRequest::CreateAndRunChildProcesses(int parentsock, int childsock) {
+bool CgiRequest::CreateAndRunChildProcesses(int parentsock, int childsock,
+                                            const ExecParams &params) {
   cgi_pid_ = fork();
   if (cgi_pid_ < 0) {
     return false;
@@ -183,11 +219,11 @@ bool CgiRequest::CreateAndRunChildProcesses(int parentsock, int childsock) {
         dup2(childsock, STDIN_FILENO) < 0 ||
         dup2(childsock, STDOUT_FILENO) < 0) {
       close(childsock);
-      exit(EXIT_FAILURE);
+      _exit(EXIT_FAILURE);
     }
     close(childsock);
-    ExecuteCgi();
-    exit(EXIT_FAILURE);
+    ExecuteCgi(params);
+    _exit(EXIT_FAILURE);
   }
   return true;
 }
@@ -202,27 +238,68 @@ bool CgiRequest::AddNonBlockingOptToFd(int fd) const {
   return true;
 }
 
-void CgiRequest::ExecuteCgi() {
-  UnsetAllEnvironmentVariables();
-  SetMetaVariables();
-  if (!MoveToCgiExecutionDir(exec_cgi_script_path_)) {
-    utils::PrintLog("MoveToCgiExecutionDir fail %s",
-                    exec_cgi_script_path_.c_str());
+void CgiRequest::ExecuteCgi(const ExecParams &params) const {
+  if (chdir(params.dir.c_str()) < 0) {
+    WriteErrorInChild("MoveToCgiExecutionDir fail ", exec_cgi_script_path_);
     return;
   }
-  cgi_args_.insert(cgi_args_.begin(), cgi_executor_);
-  cgi_args_.insert(cgi_args_.begin() + 1, exec_cgi_script_path_);
-  char **argv = utils::AllocVectorStringToCharDptr(cgi_args_);
+  execve(params.path.c_str(), params.argv, params.envp);
+  WriteErrorInChild("execve fail ", exec_cgi_script_path_);
+}
+
+std::string CgiRequest::SearchExecutorPath() const {
+  if (cgi_executor_.find('/') != std::string::npos) {
+    return cgi_executor_;
+  }
+  // execvpe(3) と同じく PATH が無ければデフォルトのディレクトリから探す
+  const char *env_path = getenv("PATH");
+  std::vector<std::string> dirs = utils::SplitString(
+      env_path != NULL ? env_path : kDefaultExecutorSearchPath, ":");
+  for (std::vector<std::string>::const_iterator it = dirs.begin();
+       it != dirs.end(); ++it) {
+    // 空の要素はカレントディレクトリを表すが､子プロセスでは chdir(2) するので
+    // 同じファイルを指さない｡ そのため探さない｡
+    if (it->empty()) {
+      continue;
+    }
+    std::string path = utils::JoinPath(*it, cgi_executor_);
+    if (access(path.c_str(), X_OK) == 0) {
+      return path;
+    }
+  }
+  // 見つからなければ execve(2) が失敗する
+  return cgi_executor_;
+}
+
+Result<std::string> CgiRequest::GetCgiExecutionDir() const {
+  return utils::NormalizePath(utils::JoinPath(exec_cgi_script_path_, ".."));
+}
 
-  execvpe(cgi_executor_.c_str(), argv, environ);
-  utils::PrintLog("execve fail %s", exec_cgi_script_path_.c_str());
-  utils::DeleteCharDprt(argv);
+std::vector<std::string> CgiRequest::CreateArgv() const {
+  std::vector<std::string> argv;
+  argv.push_back(cgi_executor_);
+  argv.push_back(exec_cgi_script_path_);
+  argv.insert(argv.end(), cgi_args_.begin(), cgi_args_.end());
+  return argv;
 }
 
-void CgiRequest::UnsetAllEnvironmentVariables() const {
-  for (size_t i = 0; environ[i] != NULL; i++) {
-    unsetenv(environ[i]);
+std::vector<std::string> CgiRequest::CreateEnvp() const {
+  std::vector<std::string> envp;
+  for (size_t i = 0; environ[i] != NULL; ++i) {
+    const char *variable = environ[i];
+    const char *equal = strchr(variable, '=');
+    std::string name =
+        equal != NULL ? std::string(variable, equal - variable) : variable;
+    if (cgi_variables_.count(name) == 0) {
+      envp.push_back(variable);
+    }
+  }
+  for (std::map<std::string, std::string>::const_iterator it =
+           cgi_variables_.begin();
+       it != cgi_variables_.end(); ++it) {
+    envp.push_back(it->first + "=" + it->second);
   }
+  return envp;
 }
 
 // 各変数の役割は以下のサイトを参照
@@ -253,14 +330,14 @@ void CgiRequest::CreateCgiMetaVariablesFromHttpRequest(
 void CgiRequest::CreateCgiContentVariables(const http::HttpRequest &request) {
   // CONTENT_TYPE
   Result<const std::vector<std::string> &> content_type_res =
-      request.GetHeader("Content-Type");
+      request.GetHeader(http::kHeaderContentType);
   if (content_type_res.IsOk() && !content_type_res.Ok().empty()) {
     cgi_variables_["CONTENT_TYPE"] = content_type_res.Ok()[0];
   }
 
   // CONTENT_LENGTH
   Result<const std::vector<std::string> &> content_length_res =
-      request.GetHeader("Content-Length");
+      request.GetHeader(http::kHeaderContentLength);
   if (content_length_res.IsOk() && !content_length_res.Ok().empty()) {
     cgi_variables_["CONTENT_LENGTH"] = content_length_res.Ok()[0];
   }
@@ -289,7 +366,8 @@ void CgiRequest::CreateCgiHttpVariables(const http::HttpRequest &request) {
 void CgiRequest::CreateCgiNetworkVariables(const server::ConnSocket *conn_sock,
                                            const http::HttpRequest &request) {
   // SERVER_NAME
-  Result<const std::vector<std::string> &> host_res = request.GetHeader("Host");
+  Result<const std::vector<std::string> &> host_res =
+      request.GetHeader(http::kHeaderHost);
   if (host_res.IsOk() && !host_res.Ok().empty()) {
     cgi_variables_["SERVER_NAME"] = host_res.Ok()[0];
   } else {
@@ -310,26 +388,4 @@ void CgiRequest::CreateCgiNetworkVariables(const server::ConnSocket *conn_sock,
   cgi_variables_["REMOTE_ADDR"] = conn_sock->GetRemoteIp();
 }
 
-void CgiRequest::SetMetaVariables() {
-  for (std::map<std::string, std::string>::const_iterator it =
-           cgi_variables_.begin();
-       it != cgi_variables_.end(); ++it) {
-    setenv(it->first.c_str(), it->second.c_str(), 1);
-  }
-}
-
-bool CgiRequest::MoveToCgiExecutionDir(
-    const std::string &exec_cgi_script_path_) const {
-  Result<std::string> result =
-      utils::NormalizePath(utils::JoinPath(exec_cgi_script_path_, ".."));
-  if (result.IsErr()) {
-    return false;
-  }
-  std::string exec_dir = result.Ok();
-  if (chdir(exec_dir.c_str())) {
-    return false;
-  }
-  return true;
-}
-
 }  // namespace cgi
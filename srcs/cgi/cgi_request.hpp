@@ -23,6 +23,18 @@ using namespace result;
 class CgiRequest {
  private:
   static const std::string kPython;
+  // PATH が設定されていない場合に cgi_executor を探すディレクトリ
+  // (execvpe(3) と同じ)
+  static const std::string kDefaultExecutorSearchPath;
+
+  // execve(2) に渡すもの｡ fork(2) の前に作っておく｡
+  struct ExecParams {
+    std::string path;
+    // スクリプトのあるディレクトリ
+    std::string dir;
+    char **argv;
+    char **envp;
+  };
 
   pid_t cgi_pid_;
   int cgi_unisock_;
@@ -56,7 +68,8 @@ class CgiRequest {
                                     const config::LocationConf &location);
 
   bool ForkAndExecuteCgi();
-  bool CreateAndRunChildProcesses(int parentsock, int childsock);
+  bool CreateAndRunChildProcesses(int parentsock, int childsock,
+                                  const ExecParams &params);
 
   bool AddNonBlockingOptToFd(int fd) const;
 
@@ -68,12 +81,16 @@ class CgiRequest {
   void CreateCgiNetworkVariables(const server::ConnSocket *conn_sock,
                                  const http::HttpRequest &request);
   void CreateCgiHttpVariables(const http::HttpRequest &request);
-  void UnsetAllEnvironmentVariables() const;
 
-  void SetMetaVariables();
+  // execvpe(3) と同じように cgi_executor_ のパスを探す
+  std::string SearchExecutorPath() const;
+  Result<std::string> GetCgiExecutionDir() const;
+  std::vector<std::string> CreateArgv() const;
+  // サーバーの環境変数を cgi_variables_ で上書きして "<name>=<value>" にする
+  std::vector<std::string> CreateEnvp() const;
 
-  void ExecuteCgi();
-  bool MoveToCgiExecutionDir(const std::string &exec_cgi_script_path_) const;
+  // fork(2) した子プロセスで呼ぶ｡ async-signal-safe な関数しか呼ばない｡
+  void ExecuteCgi(const ExecParams &params) const;
 };
 
 }  // namespace cgi
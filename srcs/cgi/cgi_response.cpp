@@ -32,7 +32,9 @@ Result<std::string> GetValueOfHeader(const std::string &header);
 }  // namespace
 
 CgiResponse::CgiResponse()
-    : newline_chars_(""), response_type_(kNotIdentified) {}
+    : newline_chars_(""),
+      header_search_pos_(0),
+      response_type_(kNotIdentified) {}
 
 CgiResponse::CgiResponse(const CgiResponse &rhs) {
   *this = rhs;
@@ -41,6 +43,7 @@ CgiResponse::CgiResponse(const CgiResponse &rhs) {
 CgiResponse &CgiResponse::operator=(const CgiResponse &rhs) {
   if (this != &rhs) {
     newline_chars_ = rhs.newline_chars_;
+    header_search_pos_ = rhs.header_search_pos_;
     response_type_ = rhs.response_type_;
     headers_ = rhs.headers_;
     body_ = rhs.body_;
@@ -50,7 +53,7 @@ CgiResponse &CgiResponse::operator=(const CgiResponse &rhs) {
 
 CgiResponse::~CgiResponse() {}
 
-CgiResponse::ResponseType CgiResponse::Parse(utils::ByteVector &buffer) {
+CgiResponse::ResponseType CgiResponse::Parse(utils::ByteBuffer &buffer) {
   if (response_type_ == kNotIdentified) {
     // まだ response_type が決まっていない場合
     if (newline_chars_.empty() && DetermineNewlineChars(buffer).IsErr()) {
@@ -113,9 +116,11 @@ utils::ByteVector &CgiResponse::GetBody() {
 }
 
 Result<void> CgiResponse::DetermineNewlineChars(
-    const utils::ByteVector &buffer) {
-  Result<size_t> lflf_res = buffer.FindString(kLF + kLF);
-  Result<size_t> crlfcrlf_res = buffer.FindString(kCRLF + kCRLF);
+    const utils::ByteBuffer &buffer) {
+  const std::string lflf = kLF + kLF;
+  const std::string crlfcrlf = kCRLF + kCRLF;
+  Result<size_t> lflf_res = buffer.FindString(lflf, header_search_pos_);
+  Result<size_t> crlfcrlf_res = buffer.FindString(crlfcrlf, header_search_pos_);
 
   if (lflf_res.IsOk() && crlfcrlf_res.IsOk()) {
     size_t lflf_idx = lflf_res.Ok();
@@ -130,6 +135,8 @@ Result<void> CgiResponse::DetermineNewlineChars(
   } else if (crlfcrlf_res.IsOk()) {
     newline_chars_ = kCRLF;
   } else {
+    // 長い方の区切りの一部が末尾に届いている場合があるのでその分戻す
+    header_search_pos_ = buffer.GetResumePos(crlfcrlf);
     return Error();
   }
   return Result<void>();
@@ -151,7 +158,7 @@ CgiResponse::ResponseType CgiResponse::IdentifyResponseType() const {
   }
 }
 
-Result<void> CgiResponse::SetHeadersFromBuffer(utils::ByteVector &buffer) {
+Result<void> CgiResponse::SetHeadersFromBuffer(utils::ByteBuffer &buffer) {
   Result<HeaderVecType> header_vec_res = GetHeaderVecFromBuffer(buffer);
   if (header_vec_res.IsErr()) {
     return Error();
@@ -170,16 +177,19 @@ Result<void> CgiResponse::SetHeadersFromBuffer(utils::ByteVector &buffer) {
   return Result<void>();
 }
 
-utils::ByteVector CgiResponse::ConvertToChunkResponse(utils::ByteVector data) {
+utils::ByteVector CgiResponse::ConvertToChunkResponse(
+    const utils::ByteBuffer &data) {
   std::stringstream ss;
-  while (data.empty() == false) {
-    size_t chunk_size =
-        data.size() < http::kMaxUriLength ? data.size() : http::kMaxUriLength;
+  size_t pos = 0;
+  while (pos < data.size()) {
+    size_t chunk_size = data.size() - pos < http::kMaxUriLength
+                            ? data.size() - pos
+                            : http::kMaxUriLength;
     ss << std::hex << chunk_size;
     ss << http::kCrlf;
-    ss << data.SubstrBeforePos(chunk_size);
+    ss.write(reinterpret_cast<const char *>(data.data() + pos), chunk_size);
     ss << http::kCrlf;
-    data.erase(data.begin(), data.begin() + chunk_size);
+    pos += chunk_size;
   }
   return ss.str();
 }
@@ -217,7 +227,7 @@ void CgiResponse::AdjustHeadersBasedOnResponseType() {
 }
 
 Result<CgiResponse::HeaderVecType> CgiResponse::GetHeaderVecFromBuffer(
-    const utils::ByteVector &buffer) const {
+    const utils::ByteBuffer &buffer) const {
   Result<size_t> headers_boundary_res =
       buffer.FindString(newline_chars_ + newline_chars_);
   if (headers_boundary_res.IsErr()) {
@@ -6,6 +6,7 @@
 
 #include "http/http_response.hpp"
 #include "result/result.hpp"
+#include "utils/ByteBuffer.hpp"
 #include "utils/ByteVector.hpp"
 
 namespace cgi {
@@ -34,6 +35,9 @@ class CgiResponse {
   // ヘッダー部における改行文字(LF or CRLF)
   std::string newline_chars_;
 
+  // ヘッダーとボディの区切りを探し終えた位置｡ 次はここから探す｡
+  size_t header_search_pos_;
+
   ResponseType response_type_;
 
   // CGIレスポンスタイプの判定にはヘッダーの順序も関係するのでベクターで保持する
@@ -47,10 +51,10 @@ class CgiResponse {
   CgiResponse &operator=(const CgiResponse &rhs);
   ~CgiResponse();
 
-  utils::ByteVector ConvertToChunkResponse(utils::ByteVector data);
+  utils::ByteVector ConvertToChunkResponse(const utils::ByteBuffer &data);
   void AppendLastChunk();
 
-  ResponseType Parse(utils::ByteVector &buffer);
+  ResponseType Parse(utils::ByteBuffer &buffer);
 
   // ========================================================================
   // Getter and Setter
@@ -76,14 +80,14 @@ class CgiResponse {
   static const unsigned long kMaxStatusHeaderSize = 16 * 1024;  // 16KB
 
   // 改行文字を決定する
-  Result<void> DetermineNewlineChars(const utils::ByteVector &buffer);
+  Result<void> DetermineNewlineChars(const utils::ByteBuffer &buffer);
 
   // headers_ を元にレスポンスタイプを決定する｡
   ResponseType IdentifyResponseType() const;
 
   // ヘッダー部からヘッダーをセットし､
   // ヘッダーとボディの区切りまでを buffer から削除する
-  Result<void> SetHeadersFromBuffer(utils::ByteVector &buffer);
+  Result<void> SetHeadersFromBuffer(utils::ByteBuffer &buffer);
 
   void AppendBodyFromBuffer(const utils::ByteVector &buffer);
 
@@ -94,7 +98,7 @@ class CgiResponse {
   // buffer からヘッダー部分を取り出す｡
   // ヘッダーの値が不正である場合やヘッダー部の検出が出来ない場合はエラー
   Result<HeaderVecType> GetHeaderVecFromBuffer(
-      const utils::ByteVector &buffer) const;
+      const utils::ByteBuffer &buffer) const;
 
   // document-response = Content-Type [ Status ] *other-field NL response-body
   bool IsDocumentResponse() const;
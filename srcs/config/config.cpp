@@ -11,7 +11,21 @@
 
 namespace config {
 
-Config::Config() : servers_() {}
+Config::Config()
+    : servers_(),
+      is_edge_triggered_(false),
+      worker_processes_(1),
+      worker_threads_(1),
+      thread_balancing_(kRoundRobin),
+      event_backend_(kEpollBackend),
+      is_reuse_port_(true),
+      accept_batch_(kDefaultAcceptBatch),
+      epoll_events_(kDefaultEpollEvents),
+      is_sendfile_(true),
+      is_tcp_nodelay_(true),
+      is_tcp_nopush_(true),
+      connection_buffer_limit_(kDefaultConnectionBufferLimit),
+      client_body_buffer_size_(kDefaultClientBodyBufferSize) {}
 
 Config::Config(const Config &rhs) {
   *this = rhs;
@@ -20,6 +34,19 @@ Config::Config(const Config &rhs) {
 Config &Config::operator=(const Config &rhs) {
   if (this != &rhs) {
     servers_ = rhs.servers_;
+    is_edge_triggered_ = rhs.is_edge_triggered_;
+    worker_processes_ = rhs.worker_processes_;
+    worker_threads_ = rhs.worker_threads_;
+    thread_balancing_ = rhs.thread_balancing_;
+    event_backend_ = rhs.event_backend_;
+    is_reuse_port_ = rhs.is_reuse_port_;
+    accept_batch_ = rhs.accept_batch_;
+    epoll_events_ = rhs.epoll_events_;
+    is_sendfile_ = rhs.is_sendfile_;
+    is_tcp_nodelay_ = rhs.is_tcp_nodelay_;
+    is_tcp_nopush_ = rhs.is_tcp_nopush_;
+    connection_buffer_limit_ = rhs.connection_buffer_limit_;
+    client_body_buffer_size_ = rhs.client_body_buffer_size_;
   }
   return *this;
 }
@@ -27,7 +54,9 @@ Config &Config::operator=(const Config &rhs) {
 Config::~Config() {}
 
 bool Config::IsValid() const {
-  if (servers_.empty()) {
+  if (servers_.empty() || worker_processes_ < 1 || worker_threads_ < 1 ||
+      accept_batch_ < 1 || epoll_events_ < 1 ||
+      connection_buffer_limit_ == 0) {
     return false;
   }
   for (VirtualServerConfVector::const_iterator it = servers_.begin();
@@ -40,6 +69,24 @@ bool Config::IsValid() const {
 }
 
 void Config::Print() const {
+  std::cout << "edge_triggered: " << is_edge_triggered_ << "\n";
+  std::cout << "worker_processes: " << worker_processes_ << "\n";
+  std::cout << "worker_threads: " << worker_threads_ << "\n";
+  std::cout << "thread_balancing: "
+            << (thread_balancing_ == kRoundRobin ? "round_robin" : "least_conn")
+            << "\n";
+  std::cout << "event_backend: "
+            << (event_backend_ == kEpollBackend ? "epoll" : "io_uring")
+            << "\n";
+  std::cout << "reuse_port: " << is_reuse_port_ << "\n";
+  std::cout << "accept_batch: " << accept_batch_ << "\n";
+  std::cout << "epoll_events: " << epoll_events_ << "\n";
+  std::cout << "sendfile: " << is_sendfile_ << "\n";
+  std::cout << "tcp_nodelay: " << is_tcp_nodelay_ << "\n";
+  std::cout << "tcp_nopush: " << is_tcp_nopush_ << "\n";
+  std::cout << "connection_buffer_limit: " << connection_buffer_limit_ << "\n";
+  std::cout << "client_body_buffer_size: " << client_body_buffer_size_
+            << "\n\n";
   for (VirtualServerConfVector::const_iterator it = servers_.begin();
        it != servers_.end(); ++it) {
     it->Print();
@@ -77,6 +124,110 @@ void Config::AppendVirtualServerConf(
   servers_.push_back(virtual_server_conf);
 }
 
+bool Config::GetIsEdgeTriggered() const {
+  return is_edge_triggered_;
+}
+
+void Config::SetIsEdgeTriggered(bool is_edge_triggered) {
+  is_edge_triggered_ = is_edge_triggered;
+}
+
+int Config::GetWorkerProcesses() const {
+  return worker_processes_;
+}
+
+void Config::SetWorkerProcesses(int worker_processes) {
+  worker_processes_ = worker_processes;
+}
+
+int Config::GetWorkerThreads() const {
+  return worker_threads_;
+}
+
+void Config::SetWorkerThreads(int worker_threads) {
+  worker_threads_ = worker_threads;
+}
+
+Config::ThreadBalancing Config::GetThreadBalancing() const {
+  return thread_balancing_;
+}
+
+void Config::SetThreadBalancing(ThreadBalancing thread_balancing) {
+  thread_balancing_ = thread_balancing;
+}
+
+Config::EventBackend Config::GetEventBackend() const {
+  return event_backend_;
+}
+
+void Config::SetEventBackend(EventBackend event_backend) {
+  event_backend_ = event_backend;
+}
+
+bool Config::GetIsReusePort() const {
+  return is_reuse_port_;
+}
+
+void Config::SetIsReusePort(bool is_reuse_port) {
+  is_reuse_port_ = is_reuse_port;
+}
+
+int Config::GetAcceptBatch() const {
+  return accept_batch_;
+}
+
+void Config::SetAcceptBatch(int accept_batch) {
+  accept_batch_ = accept_batch;
+}
+
+int Config::GetEpollEvents() const {
+  return epoll_events_;
+}
+
+void Config::SetEpollEvents(int epoll_events) {
+  epoll_events_ = epoll_events;
+}
+
+bool Config::GetIsSendfile() const {
+  return is_sendfile_;
+}
+
+void Config::SetIsSendfile(bool is_sendfile) {
+  is_sendfile_ = is_sendfile;
+}
+
+bool Config::GetIsTcpNodelay() const {
+  return is_tcp_nodelay_;
+}
+
+void Config::SetIsTcpNodelay(bool is_tcp_nodelay) {
+  is_tcp_nodelay_ = is_tcp_nodelay;
+}
+
+bool Config::GetIsTcpNopush() const {
+  return is_tcp_nopush_;
+}
+
+void Config::SetIsTcpNopush(bool is_tcp_nopush) {
+  is_tcp_nopush_ = is_tcp_nopush;
+}
+
+unsigned long Config::GetConnectionBufferLimit() const {
+  return connection_buffer_limit_;
+}
+
+void Config::SetConnectionBufferLimit(unsigned long connection_buffer_limit) {
+  connection_buffer_limit_ = connection_buffer_limit;
+}
+
+unsigned long Config::GetClientBodyBufferSize() const {
+  return client_body_buffer_size_;
+}
+
+void Config::SetClientBodyBufferSize(unsigned long client_body_buffer_size) {
+  client_body_buffer_size_ = client_body_buffer_size;
+}
+
 Config ParseConfig(const std::string &filepath) {
   Parser parser;
   parser.LoadFile(filepath);
@@ -16,9 +16,80 @@ class Config {
  public:
   typedef std::vector<VirtualServerConf> VirtualServerConfVector;
 
+  // worker_threads が2以上の場合に､受け付けた接続をスレッドに振り分ける方法
+  enum ThreadBalancing {
+    // 順番に振り分ける
+    kRoundRobin,
+    // 接続数が最も少ないスレッドに振り分ける
+    kLeastConnections
+  };
+
+  // イベントループで fd を監視するのに使う仕組み
+  enum EventBackend {
+    kEpollBackend,
+    // io_uring が使えない環境では epoll にフォールバックする
+    kIoUringBackend
+  };
+
+  // accept_batch のデフォルト値
+  static const int kDefaultAcceptBatch = 64;
+
+  // epoll_events のデフォルト値
+  static const int kDefaultEpollEvents = 512;
+
+  // connection_buffer_limit のデフォルト値 (1MB)
+  static const unsigned long kDefaultConnectionBufferLimit = 1024 * 1024;
+
+  // client_body_buffer_size のデフォルト値 (16KB)
+  static const unsigned long kDefaultClientBodyBufferSize = 16 * 1024;
+
  private:
   VirtualServerConfVector servers_;
 
+  // epoll をエッジトリガーで使うか
+  bool is_edge_triggered_;
+
+  // イベントループを回すワーカープロセスの数
+  // 1 の場合はマスタープロセスを作らずに1プロセスで動く
+  int worker_processes_;
+
+  // 1プロセス内でイベントループを回すスレッドの数
+  // 1 の場合はスレッドを作らない
+  int worker_threads_;
+
+  ThreadBalancing thread_balancing_;
+
+  EventBackend event_backend_;
+
+  // worker_processes が2以上の場合に､各ワーカーが SO_REUSEPORT で
+  // listen socket を作成するか｡ false ならマスターが作成した listen socket を
+  // 全てのワーカーで共有し､EPOLLEXCLUSIVE で監視する｡
+  bool is_reuse_port_;
+
+  // listen socket のイベント1回で accept する接続の最大数
+  int accept_batch_;
+
+  // イベントループが1回の待機で受け取るイベントの最大数
+  int epoll_events_;
+
+  // ファイルのボディを sendfile(2) で送るか
+  bool is_sendfile_;
+
+  // 受け付けた接続に TCP_NODELAY を付けるか
+  bool is_tcp_nodelay_;
+
+  // sendfile(2) で送るファイルの前のヘッダーを MSG_MORE を付けて書き込み､
+  // ファイルの先頭と同じセグメントで送るか
+  bool is_tcp_nopush_;
+
+  // 1つの接続で受信してまだレスポンスを返していないデータの上限｡
+  // 超えたらレスポンスを返して減るまで読み込みを止める｡
+  unsigned long connection_buffer_limit_;
+
+  // リクエストのボディをメモリに持つ上限｡
+  // 超えた分は一時ファイルに書き出す｡
+  unsigned long client_body_buffer_size_;
+
  public:
   Config();
 
@@ -50,6 +121,45 @@ class Config {
   //
   // 引数がポインタじゃないのはデータがスタック領域とヒープ領域に混在するのを避けるためである｡
   void AppendVirtualServerConf(const VirtualServerConf &virtual_server_conf);
+
+  bool GetIsEdgeTriggered() const;
+  void SetIsEdgeTriggered(bool is_edge_triggered);
+
+  int GetWorkerProcesses() const;
+  void SetWorkerProcesses(int worker_processes);
+
+  int GetWorkerThreads() const;
+  void SetWorkerThreads(int worker_threads);
+
+  ThreadBalancing GetThreadBalancing() const;
+  void SetThreadBalancing(ThreadBalancing thread_balancing);
+
+  EventBackend GetEventBackend() const;
+  void SetEventBackend(EventBackend event_backend);
+
+  bool GetIsReusePort() const;
+  void SetIsReusePort(bool is_reuse_port);
+
+  int GetAcceptBatch() const;
+  void SetAcceptBatch(int accept_batch);
+
+  int GetEpollEvents() const;
+  void SetEpollEvents(int epoll_events);
+
+  bool GetIsSendfile() const;
+  void SetIsSendfile(bool is_sendfile);
+
+  bool GetIsTcpNodelay() const;
+  void SetIsTcpNodelay(bool is_tcp_nodelay);
+
+  bool GetIsTcpNopush() const;
+  void SetIsTcpNopush(bool is_tcp_nopush);
+
+  unsigned long GetConnectionBufferLimit() const;
+  void SetConnectionBufferLimit(unsigned long connection_buffer_limit);
+
+  unsigned long GetClientBodyBufferSize() const;
+  void SetClientBodyBufferSize(unsigned long client_body_buffer_size);
 };
 
 Config ParseConfig(const std::string &filepath);
@@ -2,6 +2,7 @@
 
 #include <fcntl.h>
 #include <cstdlib>
+#include <sys/sysinfo.h>
 #include <sys/types.h>
 
 #include <algorithm>
@@ -31,6 +32,8 @@ Parser &Parser::operator=(const Parser &rhs) {
   if (&rhs != this) {
     file_content_ = rhs.file_content_;
     buf_idx_ = rhs.buf_idx_;
+    config_set_directives_ = rhs.config_set_directives_;
+    location_set_directives_ = rhs.location_set_directives_;
   }
   return *this;
 }
@@ -53,19 +56,266 @@ void Parser::LoadData(const std::string &data) {
 
 Config Parser::ParseConfig() {
   Config config;
+  config_set_directives_.clear();
   while (!IsEofReached()) {
     SkipSpaces();
     std::string directive = GetWord();
     if (directive == "server") {
       ParseServerBlock(config);
+    } else if (directive == "edge_triggered") {
+      ParseEdgeTriggeredDirective(config);
+    } else if (directive == "worker_processes") {
+      ParseWorkerProcessesDirective(config);
+    } else if (directive == "worker_threads") {
+      ParseWorkerThreadsDirective(config);
+    } else if (directive == "thread_balancing") {
+      ParseThreadBalancingDirective(config);
+    } else if (directive == "event_backend") {
+      ParseEventBackendDirective(config);
+    } else if (directive == "reuse_port") {
+      ParseReusePortDirective(config);
+    } else if (directive == "accept_batch") {
+      ParseAcceptBatchDirective(config);
+    } else if (directive == "epoll_events") {
+      ParseEpollEventsDirective(config);
+    } else if (directive == "sendfile") {
+      ParseSendfileDirective(config);
+    } else if (directive == "tcp_nodelay") {
+      ParseTcpNodelayDirective(config);
+    } else if (directive == "tcp_nopush") {
+      ParseTcpNopushDirective(config);
+    } else if (directive == "connection_buffer_limit") {
+      ParseConnectionBufferLimitDirective(config);
+    } else if (directive == "client_body_buffer_size") {
+      ParseClientBodyBufferSizeDirective(config);
     } else {
       throw ParserException("Unknown directive in config.");
     }
     SkipSpaces();
+    config_set_directives_.insert(directive);
   }
   return config;
 }
 
+void Parser::ParseEdgeTriggeredDirective(Config &config) {
+  if (IsDirectiveSetInConfig("edge_triggered")) {
+    throw ParserException("edge_triggered has already set.");
+  }
+
+  SkipSpaces();
+  std::string on_or_off = GetWord();
+  config.SetIsEdgeTriggered(ParseOnOff(on_or_off));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after edge_triggered directive.");
+  }
+}
+
+void Parser::ParseWorkerProcessesDirective(Config &config) {
+  if (IsDirectiveSetInConfig("worker_processes")) {
+    throw ParserException("worker_processes has already set.");
+  }
+
+  SkipSpaces();
+  config.SetWorkerProcesses(ParseWorkerNum(GetWord()));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after worker_processes directive.");
+  }
+}
+
+void Parser::ParseWorkerThreadsDirective(Config &config) {
+  if (IsDirectiveSetInConfig("worker_threads")) {
+    throw ParserException("worker_threads has already set.");
+  }
+
+  SkipSpaces();
+  config.SetWorkerThreads(ParseWorkerNum(GetWord()));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after worker_threads directive.");
+  }
+}
+
+void Parser::ParseThreadBalancingDirective(Config &config) {
+  if (IsDirectiveSetInConfig("thread_balancing")) {
+    throw ParserException("thread_balancing has already set.");
+  }
+
+  SkipSpaces();
+  std::string arg = GetWord();
+  if (arg == "round_robin") {
+    config.SetThreadBalancing(Config::kRoundRobin);
+  } else if (arg == "least_conn") {
+    config.SetThreadBalancing(Config::kLeastConnections);
+  } else {
+    throw ParserException("thread_balancing %s is invalid.", arg.c_str());
+  }
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after thread_balancing directive.");
+  }
+}
+
+void Parser::ParseEventBackendDirective(Config &config) {
+  if (IsDirectiveSetInConfig("event_backend")) {
+    throw ParserException("event_backend has already set.");
+  }
+
+  SkipSpaces();
+  std::string arg = GetWord();
+  if (arg == "epoll") {
+    config.SetEventBackend(Config::kEpollBackend);
+  } else if (arg == "io_uring") {
+    config.SetEventBackend(Config::kIoUringBackend);
+  } else {
+    throw ParserException("event_backend %s is invalid.", arg.c_str());
+  }
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after event_backend directive.");
+  }
+}
+
+void Parser::ParseReusePortDirective(Config &config) {
+  if (IsDirectiveSetInConfig("reuse_port")) {
+    throw ParserException("reuse_port has already set.");
+  }
+
+  SkipSpaces();
+  std::string on_or_off = GetWord();
+  config.SetIsReusePort(ParseOnOff(on_or_off));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException("Can't find semicolon after reuse_port directive.");
+  }
+}
+
+void Parser::ParseAcceptBatchDirective(Config &config) {
+  if (IsDirectiveSetInConfig("accept_batch")) {
+    throw ParserException("accept_batch has already set.");
+  }
+
+  SkipSpaces();
+  std::string arg = GetWord();
+  Result<unsigned long> result = utils::Stoul(arg);
+  if (result.IsErr() || result.Ok() == 0 || result.Ok() > kMaxAcceptBatch) {
+    throw ParserException("accept_batch %s is invalid.", arg.c_str());
+  }
+  config.SetAcceptBatch(result.Ok());
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after accept_batch directive.");
+  }
+}
+
+void Parser::ParseEpollEventsDirective(Config &config) {
+  if (IsDirectiveSetInConfig("epoll_events")) {
+    throw ParserException("epoll_events has already set.");
+  }
+
+  SkipSpaces();
+  std::string arg = GetWord();
+  Result<unsigned long> result = utils::Stoul(arg);
+  if (result.IsErr() || result.Ok() == 0 || result.Ok() > kMaxEpollEvents) {
+    throw ParserException("epoll_events %s is invalid.", arg.c_str());
+  }
+  config.SetEpollEvents(result.Ok());
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after epoll_events directive.");
+  }
+}
+
+void Parser::ParseSendfileDirective(Config &config) {
+  if (IsDirectiveSetInConfig("sendfile")) {
+    throw ParserException("sendfile has already set.");
+  }
+
+  SkipSpaces();
+  std::string on_or_off = GetWord();
+  config.SetIsSendfile(ParseOnOff(on_or_off));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException("Can't find semicolon after sendfile directive.");
+  }
+}
+
+void Parser::ParseTcpNodelayDirective(Config &config) {
+  if (IsDirectiveSetInConfig("tcp_nodelay")) {
+    throw ParserException("tcp_nodelay has already set.");
+  }
+
+  SkipSpaces();
+  std::string on_or_off = GetWord();
+  config.SetIsTcpNodelay(ParseOnOff(on_or_off));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException("Can't find semicolon after tcp_nodelay directive.");
+  }
+}
+
+void Parser::ParseTcpNopushDirective(Config &config) {
+  if (IsDirectiveSetInConfig("tcp_nopush")) {
+    throw ParserException("tcp_nopush has already set.");
+  }
+
+  SkipSpaces();
+  std::string on_or_off = GetWord();
+  config.SetIsTcpNopush(ParseOnOff(on_or_off));
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException("Can't find semicolon after tcp_nopush directive.");
+  }
+}
+
+void Parser::ParseConnectionBufferLimitDirective(Config &config) {
+  if (IsDirectiveSetInConfig("connection_buffer_limit")) {
+    throw ParserException("connection_buffer_limit has already set.");
+  }
+
+  SkipSpaces();
+  std::string arg = GetWord();
+  Result<unsigned long> result = utils::Stoul(arg);
+  if (result.IsErr() || result.Ok() == 0) {
+    throw ParserException("connection_buffer_limit %s is invalid.",
+                          arg.c_str());
+  }
+  config.SetConnectionBufferLimit(result.Ok());
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after connection_buffer_limit directive.");
+  }
+}
+
+void Parser::ParseClientBodyBufferSizeDirective(Config &config) {
+  if (IsDirectiveSetInConfig("client_body_buffer_size")) {
+    throw ParserException("client_body_buffer_size has already set.");
+  }
+
+  SkipSpaces();
+  std::string arg = GetWord();
+  Result<unsigned long> result = utils::Stoul(arg);
+  if (result.IsErr()) {
+    throw ParserException("client_body_buffer_size %s is invalid.",
+                          arg.c_str());
+  }
+  config.SetClientBodyBufferSize(result.Ok());
+  SkipSpaces();
+  if (GetC() != ';') {
+    throw ParserException(
+        "Can't find semicolon after client_body_buffer_size directive.");
+  }
+}
+
 void Parser::ParseServerBlock(Config &config) {
   VirtualServerConf vserver;
   SkipSpaces();
@@ -542,10 +792,27 @@ bool Parser::ParseOnOff(const std::string &on_or_off) {
   throw ParserException("ParseOnOff");
 }
 
+int Parser::ParseWorkerNum(const std::string &arg) {
+  if (arg == "auto") {
+    // オンラインの CPU の数だけワーカーを立てる
+    return get_nprocs();
+  }
+  Result<unsigned long> result = utils::Stoul(arg);
+  if (result.IsErr() || result.Ok() == 0 || result.Ok() > kMaxWorkers) {
+    throw ParserException("The number of workers %s is invalid.", arg.c_str());
+  }
+  return result.Ok();
+}
+
 bool Parser::IsEofReached() {
   return buf_idx_ >= file_content_.length();
 }
 
+bool Parser::IsDirectiveSetInConfig(const std::string &directive) {
+  return config_set_directives_.find(directive) !=
+         config_set_directives_.end();
+}
+
 bool Parser::IsDirectiveSetInLocation(const std::string &directive) {
   return location_set_directives_.find(directive) !=
          location_set_directives_.end();
@@ -19,6 +19,7 @@ class Parser {
   std::string file_content_;
   size_t buf_idx_;
 
+  std::set<std::string> config_set_directives_;
   std::set<std::string> location_set_directives_;
 
   // ピリオドを含むドメイン全体の長さ
@@ -27,6 +28,12 @@ class Parser {
   static const int kMaxDomainLabelLength = 63;
   // ポート番号の最大値
   static const unsigned long kMaxPortNumber = 65535;
+  // worker_processes, worker_threads の最大値
+  static const unsigned long kMaxWorkers = 1024;
+  // accept_batch の最大値
+  static const unsigned long kMaxAcceptBatch = 4096;
+  // epoll_events の最大値
+  static const unsigned long kMaxEpollEvents = 65536;
 
  public:
   Parser();
@@ -40,7 +47,7 @@ class Parser {
   // data の内容を file_content_ に載せる｡テストとかで使う｡
   void LoadData(const std::string &data);
 
-  // config: server (NEWLINE server)*;
+  // config: (config_directive | server) (NEWLINE (config_directive | server))*;
   Config ParseConfig();
 
   class ParserException : public std::exception {
@@ -58,6 +65,51 @@ class Parser {
  private:
   // 文法の詳細は docks/configuration.g4 に書いてある｡
 
+  // edge_triggered_directive: 'edge_triggered' WHITESPACE ON_OFF END_DIRECTIVE;
+  void ParseEdgeTriggeredDirective(Config &config);
+
+  // worker_processes_directive:
+  //   'worker_processes' WHITESPACE (NUMBER | 'auto') END_DIRECTIVE;
+  void ParseWorkerProcessesDirective(Config &config);
+
+  // worker_threads_directive:
+  //   'worker_threads' WHITESPACE (NUMBER | 'auto') END_DIRECTIVE;
+  void ParseWorkerThreadsDirective(Config &config);
+
+  // thread_balancing_directive:
+  //   'thread_balancing' WHITESPACE ('round_robin' | 'least_conn') END_DIRECTIVE;
+  void ParseThreadBalancingDirective(Config &config);
+
+  // event_backend_directive:
+  //   'event_backend' WHITESPACE ('epoll' | 'io_uring') END_DIRECTIVE;
+  void ParseEventBackendDirective(Config &config);
+
+  // reuse_port_directive: 'reuse_port' WHITESPACE ON_OFF END_DIRECTIVE;
+  void ParseReusePortDirective(Config &config);
+
+  // accept_batch_directive: 'accept_batch' WHITESPACE NUMBER END_DIRECTIVE;
+  void ParseAcceptBatchDirective(Config &config);
+
+  // epoll_events_directive: 'epoll_events' WHITESPACE NUMBER END_DIRECTIVE;
+  void ParseEpollEventsDirective(Config &config);
+
+  // sendfile_directive: 'sendfile' WHITESPACE ON_OFF END_DIRECTIVE;
+  void ParseSendfileDirective(Config &config);
+
+  // tcp_nodelay_directive: 'tcp_nodelay' WHITESPACE ON_OFF END_DIRECTIVE;
+  void ParseTcpNodelayDirective(Config &config);
+
+  // tcp_nopush_directive: 'tcp_nopush' WHITESPACE ON_OFF END_DIRECTIVE;
+  void ParseTcpNopushDirective(Config &config);
+
+  // connection_buffer_limit_directive:
+  //   'connection_buffer_limit' WHITESPACE NUMBER END_DIRECTIVE;
+  void ParseConnectionBufferLimitDirective(Config &config);
+
+  // client_body_buffer_size_directive:
+  //   'client_body_buffer_size' WHITESPACE NUMBER END_DIRECTIVE;
+  void ParseClientBodyBufferSizeDirective(Config &config);
+
   // server block
   // server: 'server' '{' directive+ '}';
   void ParseServerBlock(Config &config);
@@ -150,9 +202,16 @@ class Parser {
   // "on" なら true, "off" なら false を返す｡
   bool ParseOnOff(const std::string &on_or_off);
 
+  // worker_processes, worker_threads の引数をパースする｡
+  // "auto" ならオンラインの CPU の数を返す｡
+  int ParseWorkerNum(const std::string &arg);
+
   // file_content_ をすべて読み込んだか
   bool IsEofReached();
 
+  // config_set_directives_を参照し､そのディレクティブがトップレベルで既にセットされたかどうかを返す
+  bool IsDirectiveSetInConfig(const std::string &directive);
+
   // location_set_directives_を参照し､そのディレクティブが今見ているlocation内で既にセットされたかどうかを返す
   bool IsDirectiveSetInLocation(const std::string &directive);
 };
@@ -0,0 +1,202 @@
+#include "http/chunked_decoder.hpp"
+
+#include <climits>
+
+namespace http {
+
+namespace {
+
+// 16進数の数字でなければ -1 を返す
+int HexValue(utils::Byte c) {
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  }
+  if ('a' <= c && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if ('A' <= c && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+}  // namespace
+
+ChunkedDecoder::ChunkedDecoder()
+    : state_(kSize),
+      status_(kInProgress),
+      max_body_size_(ULONG_MAX),
+      body_size_(0),
+      chunk_size_(0),
+      line_size_(0) {}
+
+ChunkedDecoder::ChunkedDecoder(const ChunkedDecoder &rhs) {
+  *this = rhs;
+}
+
+ChunkedDecoder::~ChunkedDecoder() {}
+
+ChunkedDecoder &ChunkedDecoder::operator=(const ChunkedDecoder &rhs) {
+  if (this != &rhs) {
+    state_ = rhs.state_;
+    status_ = rhs.status_;
+    max_body_size_ = rhs.max_body_size_;
+    body_size_ = rhs.body_size_;
+    chunk_size_ = rhs.chunk_size_;
+    line_size_ = rhs.line_size_;
+  }
+  return *this;
+}
+
+void ChunkedDecoder::SetMaxBodySize(unsigned long max_body_size) {
+  max_body_size_ = max_body_size;
+}
+
+size_t ChunkedDecoder::Decode(const utils::Byte *data, size_t size,
+                              const utils::Byte **body, size_t *body_size) {
+  *body = data;
+  *body_size = 0;
+  size_t pos = 0;
+  while (pos < size && status_ == kInProgress) {
+    if (state_ == kData) {
+      // chunk-data は1バイトずつ見ずにまとめて取り出す
+      size_t data_size = size - pos;
+      if (data_size > chunk_size_) {
+        data_size = chunk_size_;
+      }
+      *body = data + pos;
+      *body_size = data_size;
+      chunk_size_ -= data_size;
+      body_size_ += data_size;
+      if (chunk_size_ == 0) {
+        state_ = kDataCr;
+      }
+      return pos + data_size;
+    }
+    ConsumeByte(data[pos]);
+    ++pos;
+  }
+  return pos;
+}
+
+ChunkedDecoder::Status ChunkedDecoder::GetStatus() const {
+  return status_;
+}
+
+unsigned long ChunkedDecoder::GetBodySize() const {
+  return body_size_;
+}
+
+void ChunkedDecoder::ConsumeByte(utils::Byte c) {
+  switch (state_) {
+    case kSize:
+    case kExtension:
+      if (++line_size_ > kMaxSizeLineSize) {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      ConsumeSizeByte(c);
+      return;
+    case kSizeLf:
+      if (c != '\n') {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      line_size_ = 0;
+      state_ = chunk_size_ == 0 ? kTrailerLineStart : kData;
+      return;
+    case kDataCr:
+      if (c != '\r') {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      state_ = kDataLf;
+      return;
+    case kDataLf:
+      if (c != '\n') {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      line_size_ = 0;
+      state_ = kSize;
+      return;
+    case kTrailerLineStart:
+    case kTrailerLine:
+      if (++line_size_ > kMaxTrailerSize) {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      if (c == '\r') {
+        state_ = state_ == kTrailerLineStart ? kLastLf : kTrailerLineLf;
+      } else if (c == '\n') {
+        Fail(kErrorBadRequest);
+      } else {
+        state_ = kTrailerLine;
+      }
+      return;
+    case kTrailerLineLf:
+      if (c != '\n') {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      state_ = kTrailerLineStart;
+      return;
+    case kLastLf:
+      if (c != '\n') {
+        Fail(kErrorBadRequest);
+        return;
+      }
+      state_ = kDone;
+      status_ = kFinished;
+      return;
+    default:
+      return;
+  }
+}
+
+// chunk-size = 1*HEXDIG
+// chunk-ext  = *( BWS ";" BWS chunk-ext-name [ BWS "=" BWS chunk-ext-val ] )
+// chunk-ext は区切りだけ確かめて CR まで読み飛ばす
+void ChunkedDecoder::ConsumeSizeByte(utils::Byte c) {
+  const bool is_first_byte = line_size_ == 1;
+  if (c == '\r') {
+    if (is_first_byte) {
+      Fail(kErrorBadRequest);
+      return;
+    }
+    state_ = kSizeLf;
+    return;
+  }
+  if (c == '\n') {
+    Fail(kErrorBadRequest);
+    return;
+  }
+  if (state_ == kExtension) {
+    return;
+  }
+
+  int digit = HexValue(c);
+  if (digit < 0) {
+    if (is_first_byte || (c != ';' && c != ' ' && c != '\t')) {
+      Fail(kErrorBadRequest);
+      return;
+    }
+    state_ = kExtension;
+    return;
+  }
+  if (chunk_size_ > (ULONG_MAX - digit) / 16) {
+    Fail(kErrorTooLarge);
+    return;
+  }
+  chunk_size_ = chunk_size_ * 16 + digit;
+  if (chunk_size_ > max_body_size_ - body_size_) {
+    Fail(kErrorTooLarge);
+  }
+}
+
+void ChunkedDecoder::Fail(Status status) {
+  state_ = kDone;
+  status_ = status;
+}
+
+}  // namespace http
@@ -0,0 +1,83 @@
+#ifndef HTTP_CHUNKED_DECODER_HPP_
+#define HTTP_CHUNKED_DECODER_HPP_
+
+#include <cstddef>
+
+#include "utils/ByteVector.hpp"
+
+namespace http {
+
+// Transfer-Encoding: chunked のボディを1バイトずつ解釈する｡
+//
+//   chunked-body = *chunk last-chunk trailer-section CRLF
+//   chunk        = chunk-size [ chunk-ext ] CRLF chunk-data CRLF
+//   last-chunk   = 1*("0") [ chunk-ext ] CRLF
+//
+// 解釈の途中の状態を持つので､データが途中までしか届いていなくても
+// 届いた所まで読み進め､次に届いたデータから続ける｡
+// 読み進めたデータをコピーしたり先頭から探し直したりはしない｡
+// chunk-ext と trailer-section は読み飛ばす｡
+class ChunkedDecoder {
+ public:
+  enum Status { kInProgress, kFinished, kErrorBadRequest, kErrorTooLarge };
+
+  // chunk-size と chunk-ext の行の長さの上限
+  static const size_t kMaxSizeLineSize = 4 * 1024;
+  // trailer-section 全体の長さの上限
+  static const size_t kMaxTrailerSize = 8 * 1024;
+
+ private:
+  enum State {
+    kSize,
+    kExtension,
+    kSizeLf,
+    kData,
+    kDataCr,
+    kDataLf,
+    kTrailerLineStart,
+    kTrailerLine,
+    kTrailerLineLf,
+    kLastLf,
+    kDone
+  };
+
+  State state_;
+  Status status_;
+  unsigned long max_body_size_;
+  unsigned long body_size_;
+  // 解釈中のチャンクの chunk-size｡ kData ではまだ読んでいないバイト数｡
+  unsigned long chunk_size_;
+  // 解釈中の行のバイト数 (trailer-section では全体のバイト数)
+  size_t line_size_;
+
+ public:
+  ChunkedDecoder();
+  ChunkedDecoder(const ChunkedDecoder &rhs);
+  ~ChunkedDecoder();
+
+  ChunkedDecoder &operator=(const ChunkedDecoder &rhs);
+
+  // chunk-data の合計がこれを超えたら kErrorTooLarge にする
+  void SetMaxBodySize(unsigned long max_body_size);
+
+  // data から最大 size バイトを読み進め､読み進めたバイト数を返す｡
+  // chunk-data の部分を見つけたらその終わりで止まり､*body と *body_size に
+  // data の中の chunk-data の位置を入れる｡ 無ければ *body_size は 0｡
+  // 呼び出し側は chunk-data を取り出してから残りを渡し直す｡
+  // kInProgress 以外になった後は何も読み進めない｡
+  size_t Decode(const utils::Byte *data, size_t size,
+                const utils::Byte **body, size_t *body_size);
+
+  Status GetStatus() const;
+  // これまでに取り出した chunk-data の合計
+  unsigned long GetBodySize() const;
+
+ private:
+  void ConsumeByte(utils::Byte c);
+  void ConsumeSizeByte(utils::Byte c);
+  void Fail(Status status);
+};
+
+}  // namespace http
+
+#endif
@@ -2,6 +2,8 @@
 
 #include <unistd.h>
 
+#include <list>
+
 namespace http {
 
 HttpCgiResponse::HttpCgiResponse(const config::LocationConf *location,
@@ -61,21 +63,17 @@ HttpCgiResponse::CreateResponsePhase HttpCgiResponse::ExecuteRequest(
 Result<HttpCgiResponse::CreateResponsePhase>
 HttpCgiResponse::MakeResponseBody() {
   if (file_fd_ >= 0) {
-    Result<bool> file_res = ReadFile();
-    if (file_res.IsErr()) {
-      return file_res.Err();
-    } else {
-      return file_res.Ok() ? kComplete : kBody;
-    }
+    AppendFileBody();
+    return kComplete;
   } else {
+    // CGI の出力はコピーせずに write_buffer_ に移す
     utils::ByteVector &cgi_response_body =
         cgi_process_->GetCgiResponse()->GetBody();
-    write_buffer_.AppendDataToBuffer(cgi_response_body);
-    cgi_response_body.clear();
+    write_buffer_.AppendBytes(cgi_response_body);
 
     if (cgi_process_->IsRemovable()) {
       cgi_process_->GetCgiResponse()->AppendLastChunk();
-      write_buffer_.AppendDataToBuffer(cgi_response_body);
+      write_buffer_.AppendBytes(cgi_response_body);
       return kComplete;
     } else {
       return kBody;
@@ -100,12 +98,16 @@ HttpCgiResponse::CreateResponsePhase HttpCgiResponse::MakeDocumentResponse(
 HttpCgiResponse::CreateResponsePhase HttpCgiResponse::MakeLocalRedirectResponse(
     server::ConnSocket *conn_sock) {
   // LocalRedirect を反映させた Request を2番目にinsertする
-  std::deque<http::HttpRequest> &requests = conn_sock->GetRequests();
+  std::list<http::HttpRequest> &requests = conn_sock->GetRequests();
   HttpRequest new_request = CreateLocalRedirectRequest(requests.front());
   if (new_request.GetLocalRedirectCount() > 10) {
     return MakeErrorResponse(SERVER_ERROR);
   } else {
-    requests.insert(requests.begin() + 1, new_request);
+    std::list<http::HttpRequest>::iterator next = requests.begin();
+    ++next;
+    requests.insert(next, new_request);
+    // 取り除く時に差し引かれるので元のリクエストと同じように数える
+    conn_sock->AddParsedRequest(new_request);
     return kComplete;
   }
 }
@@ -1,7 +1,10 @@
 #include "http/http_request.hpp"
 
+#include <strings.h>
+
 #include <cstdio>
 
+#include "http/scan.hpp"
 #include "result/result.hpp"
 #include "utils/log.hpp"
 #include "utils/path.hpp"
@@ -11,28 +14,42 @@ namespace http {
 namespace {
 
 using namespace result;
-bool IsMethod(const std::string &token);
-bool IsObsFold(const utils::ByteVector &buf);
-bool IsTcharString(const std::string &str);
-bool IsCorrectHTTPVersion(const std::string &str);
-Result<std::vector<std::string> > ParseHeaderFieldValue(std::string &str);
-std::pair<Chunk::ChunkStatus, Chunk> CheckChunkReceived(
-    utils::ByteVector &buffer, const unsigned long acceptable_size);
+bool IsMethod(const char *token, size_t size);
+bool IsObsFold(const std::string &str, size_t pos);
+bool IsValidHeaderFieldValue(const char *str, size_t size);
+bool IsCorrectHTTPVersion(const char *str, size_t size);
+size_t CountChar(const char *str, size_t size, char c);
+void SplitHeaderFieldValue(const char *str, size_t size,
+                           std::vector<std::string> &values);
+Result<size_t> FindCrlfInBuffer(const utils::ByteBuffer &buffer,
+                                size_t start_pos);
+Result<size_t> FindHeaderBoundary(const utils::ByteBuffer &buffer,
+                                  size_t start_pos);
 }  // namespace
 
 HttpRequest::HttpRequest()
     : method_(""),
       path_(""),
       minor_version_(-1),
+      raw_headers_(),
+      header_slices_(),
       headers_(),
+      is_headers_loaded_(false),
       phase_(kRequestLine),
       parse_status_(OK),
       body_(),
       body_size_(0),
       is_chunked_(false),
+      chunked_decoder_(),
+      search_pos_(0),
+      received_size_(0),
       vserver_(NULL),
       location_(NULL),
-      local_redirect_count_(0) {}
+      local_redirect_count_(0) {
+  std::fill(known_header_slices_, known_header_slices_ + kKnownHeaderNum, 0);
+  std::fill(is_known_header_loaded_, is_known_header_loaded_ + kKnownHeaderNum,
+            false);
+}
 
 HttpRequest::HttpRequest(const HttpRequest &rhs) {
   *this = rhs;
@@ -46,12 +63,27 @@ const HttpRequest &HttpRequest::operator=(const HttpRequest &rhs) {
     path_ = rhs.path_;
     query_param_ = rhs.query_param_;
     minor_version_ = rhs.minor_version_;
+    raw_headers_ = rhs.raw_headers_;
+    header_slices_ = rhs.header_slices_;
+    std::copy(rhs.known_header_slices_,
+              rhs.known_header_slices_ + kKnownHeaderNum,
+              known_header_slices_);
+    std::copy(rhs.known_header_values_,
+              rhs.known_header_values_ + kKnownHeaderNum,
+              known_header_values_);
+    std::copy(rhs.is_known_header_loaded_,
+              rhs.is_known_header_loaded_ + kKnownHeaderNum,
+              is_known_header_loaded_);
     headers_ = rhs.headers_;
+    is_headers_loaded_ = rhs.is_headers_loaded_;
     phase_ = rhs.phase_;
     parse_status_ = rhs.parse_status_;
     body_ = rhs.body_;
     body_size_ = rhs.body_size_;
     is_chunked_ = rhs.is_chunked_;
+    chunked_decoder_ = rhs.chunked_decoder_;
+    search_pos_ = rhs.search_pos_;
+    received_size_ = rhs.received_size_;
     vserver_ = rhs.vserver_;
     location_ = rhs.location_;
     local_redirect_count_ = rhs.local_redirect_count_;
@@ -93,10 +125,11 @@ const config::LocationConf *HttpRequest::GetLocation() const {
 //========================================================================
 // Parse系関数　内部でInterpret系関数を呼び出す　主にphaseで動作管理
 
-void HttpRequest::ParseRequest(utils::ByteVector &buffer,
+void HttpRequest::ParseRequest(utils::ByteBuffer &buffer,
                                const config::Config &conf,
                                const std::string &ip,
                                const config::PortType &port) {
+  const size_t buffer_size = buffer.size();
   if (buffer.size() > kMaxBufferLength) {
     parse_status_ = BAD_REQUEST;
     phase_ = kError;
@@ -109,57 +142,84 @@ void HttpRequest::ParseRequest(utils::ByteVector &buffer,
     phase_ = LoadHeader(conf, ip, port);
   if (phase_ == kBody)
     phase_ = ParseBody(buffer);
+  received_size_ += buffer_size - buffer.size();
   PrintRequestInfo();
 }
 
 HttpRequest::ParsingPhase HttpRequest::ParseRequestLine(
-    utils::ByteVector &buffer) {
+    utils::ByteBuffer &buffer) {
   while (buffer.CompareHead(kCrlf)) {
     buffer.EraseHead(kCrlf.size());
+    search_pos_ = 0;
   }
 
-  Result<size_t> pos = buffer.FindString(kCrlf);
-  if (pos.IsErr())
+  Result<size_t> pos = FindCrlfInBuffer(buffer, search_pos_);
+  if (pos.IsErr()) {
+    search_pos_ = buffer.GetResumePos(kCrlf);
     return kRequestLine;
-
-  const std::string str = buffer.SubstrBeforePos(pos.Ok());
-  if (std::count(str.begin(), str.end(), ' ') != 2) {
+  }
+  search_pos_ = 0;
+
+  // 行全体や分割した結果を文字列にせず､バッファから直接トークンを取り出す
+  const char *line = reinterpret_cast<const char *>(buffer.data());
+  const char *line_end = line + pos.Ok();
+  const char *first_sp =
+      static_cast<const char *>(std::memchr(line, ' ', line_end - line));
+  const char *second_sp =
+      first_sp == NULL ? NULL
+                       : static_cast<const char *>(std::memchr(
+                             first_sp + 1, ' ', line_end - first_sp - 1));
+  if (second_sp == NULL ||
+      std::memchr(second_sp + 1, ' ', line_end - second_sp - 1) != NULL) {
     parse_status_ = BAD_REQUEST;
     return kError;
   }
-
-  std::vector<std::string> tokens = utils::SplitString(str, " ");
-  if (InterpretMethod(tokens[0]) == OK && InterpretPath(tokens[1]) == OK &&
-      InterpretVersion(tokens[2]) == OK) {
-    buffer.erase(buffer.begin(), buffer.begin() + pos.Ok());
+  if (InterpretMethod(line, first_sp - line) == OK &&
+      InterpretPath(first_sp + 1, second_sp - first_sp - 1) == OK &&
+      InterpretVersion(second_sp + 1, line_end - second_sp - 1) == OK) {
+    buffer.EraseHead(pos.Ok());
     return kHeaderField;
   }
   return kError;
 }
 
 HttpRequest::ParsingPhase HttpRequest::ParseHeaderField(
-    utils::ByteVector &buffer) {
-  Result<size_t> boundary_pos = buffer.FindString(kHeaderBoundary);
-  if (boundary_pos.IsErr())
+    utils::ByteBuffer &buffer) {
+  Result<size_t> boundary_pos = FindHeaderBoundary(buffer, search_pos_);
+  if (boundary_pos.IsErr()) {
+    search_pos_ = buffer.GetResumePos(kHeaderBoundary);
     return kHeaderField;
+  }
+  search_pos_ = 0;
+
+  // リクエストラインの後の CRLF から空行の CRLFCRLF までを1回でコピーする
+  const size_t headers_size = boundary_pos.Ok() + kHeaderBoundary.size();
+  raw_headers_.assign(reinterpret_cast<const char *>(buffer.data()),
+                      headers_size);
+  buffer.EraseHead(headers_size);
+  // ヘッダーの行数は LF の数を超えないので､先にまとめて確保しておく
+  header_slices_.reserve(CountChar(raw_headers_.data(), headers_size, '\n'));
 
+  size_t pos = 0;
   while (1) {
-    if (IsObsFold(buffer)) {  //先頭がobs-foldの時
+    if (IsObsFold(raw_headers_, pos)) {  //先頭がobs-foldの時
       parse_status_ = BAD_REQUEST;
       return kError;
-    } else if (buffer.CompareHead(kHeaderBoundary)) {
+    } else if (raw_headers_.compare(pos, kHeaderBoundary.size(),
+                                    kHeaderBoundary) == 0) {
       //先頭が\r\n\r\nなので終了処理
-      buffer.EraseHead(kHeaderBoundary.size());
       return kLoadHeader;
     } else {
-      buffer.EraseHead(kCrlf.size());
+      pos += kCrlf.size();
     }
 
-    Result<size_t> crlf_pos = buffer.FindString(kCrlf);
-    if (InterpretHeaderField(buffer.SubstrBeforePos(crlf_pos.Ok())) != OK)
+    const char *headers = raw_headers_.data();
+    size_t crlf_pos =
+        FindCrlf(headers + pos, headers + raw_headers_.size()) - headers;
+    if (InterpretHeaderField(pos, crlf_pos - pos) != OK)
       return kError;
     else
-      buffer.erase(buffer.begin(), buffer.begin() + crlf_pos.Ok());
+      pos = crlf_pos;
   }
 }
 
@@ -183,10 +243,12 @@ HttpRequest::ParsingPhase HttpRequest::LoadHeader(
 
   if (DecideBodySize() != OK)
     return kError;
+  body_.SetMemoryLimit(conf.GetClientBodyBufferSize());
+  chunked_decoder_.SetMaxBodySize(location_->GetClientMaxBodySize());
   return kBody;
 }
 
-HttpRequest::ParsingPhase HttpRequest::ParseBody(utils::ByteVector &buffer) {
+HttpRequest::ParsingPhase HttpRequest::ParseBody(utils::ByteBuffer &buffer) {
   if (is_chunked_) {
     return ParseChunkedBody(buffer);
   } else {
@@ -195,103 +257,108 @@ HttpRequest::ParsingPhase HttpRequest::ParseBody(utils::ByteVector &buffer) {
 }
 
 HttpRequest::ParsingPhase HttpRequest::ParsePlainBody(
-    utils::ByteVector &buffer) {
+    utils::ByteBuffer &buffer) {
   if (body_size_ == 0)
     return kParsed;
 
-  size_t request_size = body_size_ - body_.size();
-  if (buffer.size() <= request_size) {
-    body_.insert(body_.end(), buffer.begin(), buffer.end());
-    buffer.clear();
-  } else {
-    body_.insert(body_.end(), buffer.begin(), buffer.begin() + request_size);
-    buffer.erase(buffer.begin(), buffer.begin() + request_size);
+  size_t append_size = std::min(body_size_ - body_.size(), buffer.size());
+  if (body_.Append(buffer.data(), append_size).IsErr()) {
+    parse_status_ = SERVER_ERROR;
+    return kError;
   }
+  buffer.EraseHead(append_size);
   return body_.size() == body_size_ ? kParsed : kBody;
 }
 
 HttpRequest::ParsingPhase HttpRequest::ParseChunkedBody(
-    utils::ByteVector &buffer) {
-  while (buffer.empty() == false) {
-    std::pair<Chunk::ChunkStatus, Chunk> chunk_pair = CheckChunkReceived(
-        buffer, location_->GetClientMaxBodySize() - body_size_);
-    switch (chunk_pair.first) {
-      case Chunk::kWaiting:  // bufferにchunkが届ききっていない。
-        return phase_;
-      case Chunk::kErrorBadRequest:
-        parse_status_ = BAD_REQUEST;
-        return kError;
-      case Chunk::kErrorLength:
-        parse_status_ = PAYLOAD_TOO_LARGE;
-        return kError;
-      default:
-        break;
+    utils::ByteBuffer &buffer) {
+  while (buffer.empty() == false &&
+         chunked_decoder_.GetStatus() == ChunkedDecoder::kInProgress) {
+    const utils::Byte *data;
+    size_t data_size;
+    size_t consumed = chunked_decoder_.Decode(buffer.data(), buffer.size(),
+                                              &data, &data_size);
+    if (data_size > 0 && body_.Append(data, data_size).IsErr()) {
+      parse_status_ = SERVER_ERROR;
+      return kError;
     }
+    buffer.EraseHead(consumed);
+  }
+  body_size_ = chunked_decoder_.GetBodySize();
 
-    Chunk chunk = chunk_pair.second;
-    buffer.erase(buffer.begin(),
-                 buffer.begin() + chunk.size_str.size() + kCrlf.size());
-    if (chunk_pair.second.data_size == 0)
+  switch (chunked_decoder_.GetStatus()) {
+    case ChunkedDecoder::kFinished:
       return kParsed;
-    body_.insert(body_.end(), buffer.begin(), buffer.begin() + chunk.data_size);
-    buffer.erase(buffer.begin(),
-                 buffer.begin() + chunk.data_size + kCrlf.size());
-    body_size_ += chunk_pair.second.data_size;
+    case ChunkedDecoder::kErrorBadRequest:
+      parse_status_ = BAD_REQUEST;
+      return kError;
+    case ChunkedDecoder::kErrorTooLarge:
+      parse_status_ = PAYLOAD_TOO_LARGE;
+      return kError;
+    default:
+      return kBody;
   }
-  return phase_;
 }
 
 //========================================================================
 // Interpret系関数　文字列を解釈する関数　主にparse_statusで動作管理(OKじゃなくなったら次は実行されない)
 
-HttpStatus HttpRequest::InterpretMethod(const std::string &token) {
-  if (IsMethod(token)) {
-    method_ = token;
+HttpStatus HttpRequest::InterpretMethod(const char *method, size_t size) {
+  if (IsMethod(method, size)) {
+    method_.assign(method, size);
     return parse_status_ = OK;
-  } else if (token.empty() || IsTcharString(token) == false) {
+  } else if (size == 0 || SpanTchar(method, size) != size) {
     return parse_status_ = BAD_REQUEST;
   } else {
     return parse_status_ = NOT_IMPLEMENTED;
   }
 }
 
-void HttpRequest::DivideParamAsPath(const std::string &token) {
-  std::string::size_type pos = token.find("?");
-  if (pos != std::string::npos) {
-    path_ = token.substr(0, pos);
-    query_param_ = token.substr(pos + 1);
+void HttpRequest::DivideParamAsPath(const char *target, size_t size) {
+  const char *question =
+      static_cast<const char *>(std::memchr(target, '?', size));
+  if (question != NULL) {
+    path_.assign(target, question - target);
+    query_param_.assign(question + 1, target + size - question - 1);
   } else {
-    path_ = token;
-    query_param_ = "";
+    path_.assign(target, size);
+    query_param_.clear();
   }
 }
 
-HttpStatus HttpRequest::InterpretPath(const std::string &token) {
-  if (token.size() > kMaxUriLength) {
+HttpStatus HttpRequest::InterpretPath(const std::string &path) {
+  return InterpretPath(path.data(), path.size());
+}
+
+HttpStatus HttpRequest::InterpretPath(const char *target, size_t size) {
+  if (size > kMaxUriLength) {
     return parse_status_ = URI_TOO_LONG;
   }
-  DivideParamAsPath(token);
-  Result<std::string> decoded = utils::PercentDecode(path_);
-  if (decoded.IsErr()) {
+  DivideParamAsPath(target, size);
+  // デコードも正規化も path_ の中で行い､途中の文字列を作らない
+  if (utils::PercentDecodeInPlace(path_).IsErr()) {
     return parse_status_ = BAD_REQUEST;
   }
-  Result<std::string> normalized = utils::NormalizePath(decoded.Ok());
-  if (normalized.IsErr()) {
+  if (utils::NormalizePathInPlace(path_).IsErr()) {
     return parse_status_ = BAD_REQUEST;
   }
-  path_ = normalized.Ok();
   return parse_status_ = OK;
 }
 
-HttpStatus HttpRequest::InterpretVersion(const std::string &token) {
-  if (utils::ForwardMatch(token, kHttpVersionPrefix)) {
-    const std::string str = token.substr(kHttpVersionPrefix.size());
-    if (IsCorrectHTTPVersion(str)) {
+HttpStatus HttpRequest::InterpretVersion(const char *version, size_t size) {
+  const size_t prefix_size = kHttpVersionPrefix.size();
+  if (size >= prefix_size &&
+      kHttpVersionPrefix.compare(0, prefix_size, version, prefix_size) == 0) {
+    const char *str = version + prefix_size;
+    const size_t str_size = size - prefix_size;
+    if (IsCorrectHTTPVersion(str, str_size)) {
       // HTTP1.~ が保証される
-      minor_version_ =
-          std::atoi(str.substr(kExpectMajorVersion.size()).c_str());
+      minor_version_ = 0;
+      for (size_t i = kExpectMajorVersion.size(); i < str_size; i++) {
+        minor_version_ = minor_version_ * 10 + (str[i] - '0');
+      }
       return parse_status_ = OK;
-    } else if (str.empty() == false && '2' <= str[0] && str[0] <= '9') {
+    } else if (str_size != 0 && '2' <= str[0] && str[0] <= '9') {
       // HTTP2.0とかHTTP/2hogeとか
       return parse_status_ = HTTP_VERSION_NOT_SUPPORTED;
     }
@@ -300,23 +367,41 @@ HttpStatus HttpRequest::InterpretVersion(const std::string &token) {
   return parse_status_ = BAD_REQUEST;
 }
 
-HttpStatus HttpRequest::InterpretHeaderField(const std::string &str) {
-  size_t collon_pos = str.find_first_of(":");
+HttpStatus HttpRequest::InterpretHeaderField(size_t pos, size_t size) {
+  const char *line = raw_headers_.data() + pos;
+  // ヘッダー名の検証とコロンの位置の検索を1回の走査で行う｡
+  // ヘッダー名の tchar が途切れた位置がコロンでなければエラー｡
+  const size_t name_size = SpanTchar(line, size);
 
-  if (collon_pos == std::string::npos || collon_pos == 0)
+  if (name_size == 0 || name_size == size || line[name_size] != ':')
     return parse_status_ = BAD_REQUEST;
 
-  std::string header = str.substr(0, collon_pos);
-  std::string value_str = str.substr(collon_pos + 1);
-  Result<std::vector<std::string> > result = ParseHeaderFieldValue(value_str);
-  if (result.IsErr() || IsTcharString(header) == false) {
+  HeaderSlice slice;
+  slice.name_pos = pos;
+  slice.name_size = name_size;
+  slice.value_pos = pos + slice.name_size + 1;
+  slice.value_size = size - slice.name_size - 1;
+  if (IsValidHeaderFieldValue(line + name_size + 1, slice.value_size) ==
+      false) {
     return parse_status_ = BAD_REQUEST;
   }
-  std::transform(header.begin(), header.end(), header.begin(), toupper);
-  headers_[header] = result.Ok();
+  // 同じヘッダーが複数ある場合は最後のものを使う
+  slice.known_header = LookupKnownHeader(line, name_size);
+  header_slices_.push_back(slice);
+  if (slice.known_header != kKnownHeaderNum) {
+    known_header_slices_[slice.known_header] = header_slices_.size();
+  }
   return parse_status_ = OK;
 }
 
+void HttpRequest::CreateHeaderValue(size_t index,
+                                    std::vector<std::string> &values) const {
+  const HeaderSlice &slice = header_slices_[index];
+  // InterpretHeaderField() で検証済みなので失敗しない
+  SplitHeaderFieldValue(raw_headers_.data() + slice.value_pos,
+                        slice.value_size, values);
+}
+
 HttpStatus HttpRequest::InterpretContentLength(
     const HeaderMap::mapped_type &length_header) {
   // ヘッダ値が相違する，複数の Content-Length ヘッダが在る†
@@ -368,6 +453,13 @@ void HttpRequest::ReBindPathAndLocation(const std::string &new_path) {
   }
 }
 
+void HttpRequest::SetBufferLimitExceeded() {
+  assert(IsResponsible() == false);
+  parse_status_ =
+      phase_ == kBody ? PAYLOAD_TOO_LARGE : REQUEST_HEADER_FIELDS_TOO_LARGE;
+  phase_ = kError;
+}
+
 //========================================================================
 // Is系関数　外部から状態取得
 bool HttpRequest::IsResponsible() const {
@@ -385,12 +477,43 @@ bool HttpRequest::IsErrorRequest() const {
 // ========================================================================
 // Getter and Setter
 Result<const std::vector<std::string> &> HttpRequest::GetHeader(
-    std::string header) const {
-  std::transform(header.begin(), header.end(), header.begin(), toupper);
-  for (HeaderMap::const_iterator it = headers_.begin(); it != headers_.end();
-       ++it) {
-    if (it->first == header) {
-      return it->second;
+    KnownHeader header) const {
+  if (known_header_slices_[header] == 0) {
+    return Error();
+  }
+  if (!is_known_header_loaded_[header]) {
+    CreateHeaderValue(known_header_slices_[header] - 1,
+                      known_header_values_[header]);
+    is_known_header_loaded_[header] = true;
+  }
+  return known_header_values_[header];
+}
+
+Result<const std::vector<std::string> &> HttpRequest::GetHeader(
+    const std::string &header) const {
+  KnownHeader known_header = LookupKnownHeader(header.data(), header.size());
+  if (known_header != kKnownHeaderNum) {
+    return GetHeader(known_header);
+  }
+  std::string upper_header = header;
+  std::transform(upper_header.begin(), upper_header.end(),
+                 upper_header.begin(), toupper);
+  HeaderMap::const_iterator it = headers_.find(upper_header);
+  if (it != headers_.end()) {
+    return it->second;
+  }
+  if (is_headers_loaded_) {
+    return Error();
+  }
+  // 同じヘッダーが複数ある場合は最後のものを使う
+  for (size_t i = header_slices_.size(); i > 0; --i) {
+    const HeaderSlice &slice = header_slices_[i - 1];
+    if (slice.name_size == header.size() &&
+        strncasecmp(raw_headers_.data() + slice.name_pos, header.data(),
+                    header.size()) == 0) {
+      std::vector<std::string> &value = headers_[upper_header];
+      CreateHeaderValue(i - 1, value);
+      return value;
     }
   }
   return Error();
@@ -403,6 +526,17 @@ std::string HttpRequest::GetHttpVersion() const {
 }
 
 const HeaderMap &HttpRequest::GetHeaders() const {
+  if (!is_headers_loaded_) {
+    // 同じヘッダーが複数ある場合は後のもので上書きされる
+    for (size_t i = 0; i < header_slices_.size(); ++i) {
+      const HeaderSlice &slice = header_slices_[i];
+      std::string header =
+          raw_headers_.substr(slice.name_pos, slice.name_size);
+      std::transform(header.begin(), header.end(), header.begin(), toupper);
+      CreateHeaderValue(i, headers_[header]);
+    }
+    is_headers_loaded_ = true;
+  }
   return headers_;
 }
 
@@ -410,30 +544,36 @@ HttpStatus HttpRequest::GetParseStatus() const {
   return parse_status_;
 }
 
-const utils::ByteVector &HttpRequest::GetBody() const {
+const utils::SpoolBuffer &HttpRequest::GetBody() const {
   return body_;
 }
 
+size_t HttpRequest::GetReceivedSize() const {
+  return received_size_;
+}
+
 //========================================================================
 // Helper関数
 
 HttpStatus HttpRequest::DecideBodySize() {
   // https://triple-underscore.github.io/RFC7230-ja.html#message.body.length
 
-  HeaderMap::iterator encoding_header_it = headers_.find("TRANSFER-ENCODING");
-  HeaderMap::iterator length_header_it = headers_.find("CONTENT-LENGTH");
-  bool has_encoding_header = encoding_header_it != headers_.end();
-  bool has_length_header = length_header_it != headers_.end();
+  Result<const HeaderMap::mapped_type &> encoding_header =
+      GetHeader(kHeaderTransferEncoding);
+  Result<const HeaderMap::mapped_type &> length_header =
+      GetHeader(kHeaderContentLength);
+  bool has_encoding_header = encoding_header.IsOk();
+  bool has_length_header = length_header.IsOk();
 
   if (has_encoding_header && has_length_header) {
     return parse_status_ = BAD_REQUEST;
   }
 
   if (has_encoding_header)
-    return InterpretTransferEncoding((*encoding_header_it).second);
+    return InterpretTransferEncoding(encoding_header.Ok());
 
   if (has_length_header)
-    return InterpretContentLength((*length_header_it).second);
+    return InterpretContentLength(length_header.Ok());
 
   return OK;
 }
@@ -441,7 +581,7 @@ HttpStatus HttpRequest::DecideBodySize() {
 bool HttpRequest::LoadVirtualServer(const config::Config &conf,
                                     const std::string &ip,
                                     const config::PortType &port) {
-  Result<const std::vector<std::string> &> host_res = GetHeader("Host");
+  Result<const std::vector<std::string> &> host_res = GetHeader(kHeaderHost);
   if (host_res.IsErr() || host_res.Ok().size() != 1)
     return false;
 
@@ -462,138 +602,166 @@ bool HttpRequest::LoadLocation() {
 }
 
 namespace {
-bool IsMethod(const std::string &token) {
-  return token == method_strs::kGet || token == method_strs::kDelete ||
-         token == method_strs::kPost;
-}
-
-bool IsObsFold(const utils::ByteVector &buf) {
-  return buf.CompareHead(kCrlf + " ") || buf.CompareHead(kCrlf + "\t");
+bool IsMethod(const char *token, size_t size) {
+  return method_strs::kGet.compare(0, std::string::npos, token, size) == 0 ||
+         method_strs::kDelete.compare(0, std::string::npos, token, size) ==
+             0 ||
+         method_strs::kPost.compare(0, std::string::npos, token, size) == 0;
 }
 
-// Chunk内にCRLFがあること、CRLFがチャンクの末尾についている事を検証する。
-bool ValidateChunkDataFormat(const Chunk &chunk, utils::ByteVector &buffer) {
-  utils::ByteVector chunk_data_bytes = utils::ByteVector(
-      buffer.begin() + chunk.size_str.size() + kCrlf.size(), buffer.end());
-  Result<size_t> res = chunk_data_bytes.FindString(kCrlf);
-  if (res.IsOk()) {
-    return res.Ok() == chunk.data_size;
-  }
-  return false;
+// str の pos から始まる行が obs-fold か
+bool IsObsFold(const std::string &str, size_t pos) {
+  return str.compare(pos, kCrlf.size(), kCrlf) == 0 &&
+         pos + kCrlf.size() < str.size() &&
+         (str[pos + kCrlf.size()] == ' ' || str[pos + kCrlf.size()] == '\t');
 }
 
-std::pair<Chunk::ChunkStatus, Chunk> CheckChunkReceived(
-    utils::ByteVector &buffer, const unsigned long acceptable_size) {
-  Chunk res;
-
-  Result<size_t> pos = buffer.FindString(kCrlf);
-  if (pos.IsErr())
-    return std::make_pair(Chunk::kWaiting, res);
-  res.size_str = buffer.SubstrBeforePos(pos.Ok());
-
-  Result<unsigned long> convert_res =
-      utils::Stoul(res.size_str, utils::kHexadecimal);
-  if (convert_res.IsErr())
-    return std::make_pair(Chunk::kErrorBadRequest, res);
-  res.data_size = convert_res.Ok();
-
-  if (res.data_size >= acceptable_size) {
-    return std::make_pair(Chunk::kErrorLength, res);
+// buffer の start_pos 以降で最初に現れる CRLF の位置
+Result<size_t> FindCrlfInBuffer(const utils::ByteBuffer &buffer,
+                                size_t start_pos) {
+  if (start_pos > buffer.size()) {
+    return Error();
   }
-
-  if (res.data_size == 0) {
-    return std::make_pair(Chunk::kReceived, res);
+  const char *begin = reinterpret_cast<const char *>(buffer.data());
+  const char *end = begin + buffer.size();
+  const char *found = FindCrlf(begin + start_pos, end);
+  if (found == end) {
+    return Error();
   }
-
-  unsigned long expect_buffer_size =
-      res.size_str.size() + kCrlf.size() + res.data_size + kCrlf.size();
-  if (buffer.size() < expect_buffer_size)
-    return std::make_pair(Chunk::kWaiting, res);
-
-  if (ValidateChunkDataFormat(res, buffer) == false)
-    return std::make_pair(Chunk::kErrorBadRequest, res);
-
-  return std::make_pair(Chunk::kReceived, res);
+  return found - begin;
 }
 
-bool IsTchar(const char c) {
-  return std::isalnum(c) || kTcharsWithoutAlnum.find(c) != std::string::npos;
+// buffer の start_pos 以降で最初に現れる CRLFCRLF の位置｡
+// ヘッダーの各行の CRLF を順に探し､次の2バイトも CRLF か調べる｡
+Result<size_t> FindHeaderBoundary(const utils::ByteBuffer &buffer,
+                                  size_t start_pos) {
+  Result<size_t> crlf_pos = FindCrlfInBuffer(buffer, start_pos);
+  while (crlf_pos.IsOk()) {
+    const size_t next_pos = crlf_pos.Ok() + kCrlf.size();
+    if (next_pos + kCrlf.size() > buffer.size()) {
+      break;
+    }
+    if (buffer[next_pos] == '\r' && buffer[next_pos + 1] == '\n') {
+      return crlf_pos.Ok();
+    }
+    crlf_pos = FindCrlfInBuffer(buffer, next_pos);
+  }
+  return Error();
 }
 
-// tcharのみの文字列か判定
-// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*"
-//         "+" / "-" / "." / "^" / "_" / "`" / "|" / "~"/ DIGIT / ALPHA
-// ヘッダ名が入ってきてコロンは含まない想定
-bool IsTcharString(const std::string &str) {
-  for (size_t i = 0; i < str.size(); i++) {
-    if (IsTchar(str[i]) == false) {
-      return false;
+// ParseHeaderFieldValue() が成功する値か｡ 文字列を作らずに検証する｡
+// DQUOTE で囲まれた部分が閉じていなければエラー｡
+// (カンマで区切られた各要素の外では is_quoting は必ず false なので､
+//  要素ごとに分けずに先頭から順に見れば良い)
+bool IsValidHeaderFieldValue(const char *str, size_t size) {
+  bool is_quoting = false;
+  for (size_t i = 0; i < size; i++) {
+    if (is_quoting) {
+      if (str[i] == '"') {
+        is_quoting = false;
+      } else if (str[i] == '\\' && i + 1 != size) {
+        i++;
+      }
+    } else if (str[i] == '"') {
+      is_quoting = true;
     }
   }
-  return true;
+  return !is_quoting;
 }
 
-// RFC7230から読み解ける仕様をできるかぎり実装
+// [begin, end) で DQUOTE で囲まれていない最初のカンマの位置｡ 無ければ end
 // DQUOTEで囲まれている文字列の内部でのみエスケープが効く
-//　エスケープされてないDQUOTEは取り除く
-// DQUOTEで囲まれていないカンマまでをreturnする。カンマはstrに残る
-// ペアの存在しないDQUOTEは文字扱いでのこる。
-Result<std::string> CutSubstrHeaderValue(std::string &str) {
+const char *FindHeaderValueEnd(const char *begin, const char *end) {
   bool is_quoting = false;
-  std::string result;
-  std::string::iterator it = str.begin();
-  for (; it != str.end(); it++) {
+  for (const char *p = begin; p != end; p++) {
     if (is_quoting) {
-      if (*it == '"') {
+      if (*p == '"') {
         is_quoting = false;
-      } else if (*it == '\\' && it + 1 != str.end()) {
-        it++;
-        result += *it;
-      } else {
-        result += *it;
+      } else if (*p == '\\' && p + 1 != end) {
+        p++;
       }
-    } else {
-      if (*it == '"') {
+    } else if (*p == '"') {
+      is_quoting = true;
+    } else if (*p == ',') {
+      return p;
+    }
+  }
+  return end;
+}
+
+// RFC7230から読み解ける仕様をできるかぎり実装
+// ヘッダの:以降の str の [0, size) を受け取り、splitしてvaluesにつめる
+//  e.g. str = If-Match: "strong", W/"weak", "oops, a \"comma\""
+//  valuesは 'strong', 'W/weak'  'oops, a "comma"'
+// DQUOTEで囲まれている文字列の内部でのみエスケープが効く
+//　エスケープされてないDQUOTEは取り除く
+// 値ごとに先に長さを調べてから1回だけ文字列を確保する｡
+void SplitHeaderFieldValue(const char *str, size_t size,
+                           std::vector<std::string> &values) {
+  const char *begin = str;
+  const char *end = str + size;
+  values.clear();
+  // 値の数はカンマの数 + 1 を超えない
+  values.reserve(CountChar(str, size, ',') + 1);
+  while (begin != end) {
+    // 残りの部分の前後の OWS を取り除く
+    while (begin != end && kOWS.find(*begin) != std::string::npos) {
+      begin++;
+    }
+    while (begin != end && kOWS.find(end[-1]) != std::string::npos) {
+      end--;
+    }
+    const char *value_end = FindHeaderValueEnd(begin, end);
+    values.push_back(std::string());
+    std::string &value = values.back();
+    value.reserve(value_end - begin);
+    bool is_quoting = false;
+    for (const char *p = begin; p != value_end; p++) {
+      if (is_quoting) {
+        if (*p == '"') {
+          is_quoting = false;
+        } else if (*p == '\\' && p + 1 != end) {
+          p++;
+          value += *p;
+        } else {
+          value += *p;
+        }
+      } else if (*p == '"') {
         is_quoting = true;
-      } else if (*it == ',') {
-        break;
       } else {
-        result += *it;
+        value += *p;
       }
     }
+    // カンマを読み飛ばす
+    begin = value_end == end ? end : value_end + 1;
   }
-  if (is_quoting) {
-    return Error();
-  }
-  str.erase(str.begin(), it);
-  return result;
 }
 
-// strにヘッダの:以降を受け取り、splitしてvecにつめる
-//  e.g. str = If-Match: "strong", W/"weak", "oops, a \"comma\""
-//  returnは 'strong', 'W/weak'  'oops, a "comma"'
-Result<std::vector<std::string> > ParseHeaderFieldValue(std::string &str) {
-  std::vector<std::string> vec;
-
-  while (!str.empty()) {
-    utils::TrimString(str, kOWS);
-    Result<std::string> result = CutSubstrHeaderValue(str);
-    if (result.IsErr()) {
-      return result.Err();
-    }
-    vec.push_back(result.Ok());
-    if (!str.empty() && str[0] == ',') {
-      str.erase(str.begin());
+bool IsCorrectHTTPVersion(const char *str, size_t size) {
+  if (size <= kExpectMajorVersion.size() ||
+      size > kExpectMajorVersion.size() + kMinorVersionDigitLimit ||
+      kExpectMajorVersion.compare(0, std::string::npos, str,
+                                  kExpectMajorVersion.size()) != 0) {
+    return false;
+  }
+  for (size_t i = kExpectMajorVersion.size(); i < size; i++) {
+    if (str[i] < '0' || '9' < str[i]) {
+      return false;
     }
   }
-  return vec;
+  return true;
 }
 
-bool IsCorrectHTTPVersion(const std::string &str) {
-  return str.size() > kExpectMajorVersion.size() &&
-         str.size() <= kExpectMajorVersion.size() + kMinorVersionDigitLimit &&
-         utils::ForwardMatch(str, kExpectMajorVersion) &&
-         utils::IsDigits(str.substr(kExpectMajorVersion.size()));
+// str の [0, size) に c がいくつあるか
+size_t CountChar(const char *str, size_t size, char c) {
+  const char *end = str + size;
+  size_t count = 0;
+  for (const char *p = str;
+       (p = static_cast<const char *>(std::memchr(p, c, end - p))) != NULL;
+       p++) {
+    count++;
+  }
+  return count;
 }
 
 }  // namespace
@@ -615,21 +783,20 @@ void HttpRequest::PrintRequestInfo() {
     printf("version_: %d\n", minor_version_);
     printf("is_chuked_: %d\n", is_chunked_);
     printf("body_size: %ld\n", body_size_);
-    for (std::map<std::string, std::vector<std::string> >::iterator it =
-             headers_.begin();
-         it != headers_.end(); it++) {
+    const HeaderMap &headers = GetHeaders();
+    for (HeaderMap::const_iterator it = headers.begin(); it != headers.end();
+         it++) {
       printf("%s: ", (*it).first.c_str());
-      for (std::vector<std::string>::iterator sit = (*it).second.begin();
+      for (std::vector<std::string>::const_iterator sit =
+               (*it).second.begin();
            sit != (*it).second.end(); sit++) {
         printf("%s, ", (*sit).c_str());
       }
       printf("\n");
     }
 
-    printf("body:\n");
-    body_.push_back('\0');
-    printf("%s\n", reinterpret_cast<const char *>(body_.data()));
-    body_.pop_back();
+    printf("body: %lu bytes%s\n", static_cast<unsigned long>(body_.size()),
+           body_.IsSpooled() ? " (spooled)" : "");
   }
   printf("=====================\n");
 }
@@ -10,11 +10,15 @@
 #include <vector>
 
 #include "config/config.hpp"
+#include "http/chunked_decoder.hpp"
+#include "http/known_header.hpp"
 #include "http/types.hpp"
 #include "http_constants.hpp"
 #include "http_status.hpp"
 #include "result/result.hpp"
+#include "utils/ByteBuffer.hpp"
 #include "utils/ByteVector.hpp"
+#include "utils/SpoolBuffer.hpp"
 #include "utils/string.hpp"
 
 namespace http {
@@ -26,15 +30,14 @@ const std::string kPost = "POST";
 const std::string kDelete = "DELETE";
 }  // namespace method_strs
 
-struct Chunk {
-  enum ChunkStatus {
-    kReceived = 200,
-    kWaiting = 0,
-    kErrorLength = PAYLOAD_TOO_LARGE,
-    kErrorBadRequest = BAD_REQUEST
-  };
-  std::string size_str;
-  unsigned long data_size;
+// HttpRequest::raw_headers_ の中のヘッダー1行分の位置
+struct HeaderSlice {
+  size_t name_pos;
+  size_t name_size;
+  size_t value_pos;
+  size_t value_size;
+  // 既知のヘッダーでなければ kKnownHeaderNum
+  KnownHeader known_header;
 };
 
 class HttpRequest {
@@ -52,12 +55,35 @@ class HttpRequest {
   std::string path_;
   std::string query_param_;
   int minor_version_;
-  HeaderMap headers_;
+  // 受信したヘッダー部分をそのまま持ち､各ヘッダーはその中の位置で持つ｡
+  // ヘッダーの値は GetHeader() で読まれた時に初めて文字列にする｡
+  // (Cookie など読まれないヘッダーは文字列にしない)
+  std::string raw_headers_;
+  std::vector<HeaderSlice> header_slices_;
+  // 既知のヘッダーの最後の行の header_slices_ での位置 + 1｡ 無ければ 0｡
+  size_t known_header_slices_[kKnownHeaderNum];
+  // 文字列にした既知のヘッダーの値と､文字列にしたか
+  mutable std::vector<std::string> known_header_values_[kKnownHeaderNum];
+  mutable bool is_known_header_loaded_[kKnownHeaderNum];
+  // 文字列にした既知でないヘッダーと､GetHeaders() で全て文字列にしたもの｡
+  // キーは大文字｡
+  mutable HeaderMap headers_;
+  // header_slices_ を全て headers_ に入れたか
+  mutable bool is_headers_loaded_;
   ParsingPhase phase_;
   HttpStatus parse_status_;
-  utils::ByteVector body_;  // HTTP リクエストのボディ
+  // HTTP リクエストのボディ｡
+  // client_body_buffer_size を超えた分は一時ファイルに書き出す｡
+  utils::SpoolBuffer body_;
   unsigned long body_size_;
   bool is_chunked_;
+  // chunked のボディの解釈の途中の状態
+  ChunkedDecoder chunked_decoder_;
+  // buffer のうち区切り文字を探し終えた位置｡
+  // データが届くたびに先頭から探し直さないように次はここから探す｡
+  size_t search_pos_;
+  // このリクエストとしてバッファから取り出したバイト数
+  size_t received_size_;
   const config::VirtualServerConf *vserver_;
   const config::LocationConf *location_;
   static const unsigned long kMaxBufferLength = 1024 * 1024;
@@ -84,39 +110,51 @@ class HttpRequest {
   void SetLocalRedirectCount(int local_redirect_count);
   int GetLocalRedirectCount() const;
 
-  void ParseRequest(utils::ByteVector &buffer, const config::Config &conf,
+  void ParseRequest(utils::ByteBuffer &buffer, const config::Config &conf,
                     const std::string &ip, const config::PortType &port);
   bool IsErrorRequest() const;
   bool IsResponsible() const;
+  // 接続のバッファが上限に達してもパースし終わらないリクエストをエラーにする｡
+  // ヘッダーの途中なら 431､ボディの途中なら 413 になる｡
+  void SetBufferLimitExceeded();
 
   void ReBindPathAndLocation(const std::string &new_path);
 
   // ========================================================================
   // Getter and Setter
   std::string GetHttpVersion() const;
-  Result<const std::vector<std::string> &> GetHeader(std::string header) const;
+  // 既知のヘッダーはヘッダー名を比較せずに取り出せる
+  Result<const std::vector<std::string> &> GetHeader(KnownHeader header) const;
+  Result<const std::vector<std::string> &> GetHeader(
+      const std::string &header) const;
   const HeaderMap &GetHeaders() const;
-  const utils::ByteVector &GetBody() const;
+  const utils::SpoolBuffer &GetBody() const;
+  size_t GetReceivedSize() const;
 
   std::string GetRequestInfoOneLine() const;
 
  private:
-  ParsingPhase ParseRequestLine(utils::ByteVector &buffer);
-  ParsingPhase ParseHeaderField(utils::ByteVector &buffer);
+  ParsingPhase ParseRequestLine(utils::ByteBuffer &buffer);
+  ParsingPhase ParseHeaderField(utils::ByteBuffer &buffer);
   ParsingPhase LoadHeader(const config::Config &conf, const std::string &ip,
                           const config::PortType &port);
-  ParsingPhase ParseBody(utils::ByteVector &buffer);
-  HttpStatus InterpretMethod(const std::string &method);
-  void DivideParamAsPath(const std::string &token);
+  ParsingPhase ParseBody(utils::ByteBuffer &buffer);
+  // リクエストラインの各トークンはバッファの中を直接指して受け取る
+  HttpStatus InterpretMethod(const char *method, size_t size);
+  void DivideParamAsPath(const char *target, size_t size);
   HttpStatus InterpretPath(const std::string &path);
-  HttpStatus InterpretVersion(const std::string &version);
-  HttpStatus InterpretHeaderField(const std::string &str);
+  HttpStatus InterpretPath(const char *target, size_t size);
+  HttpStatus InterpretVersion(const char *version, size_t size);
+  // raw_headers_ の [pos, pos + size) の1行を解釈して header_slices_ に入れる
+  HttpStatus InterpretHeaderField(size_t pos, size_t size);
+  // header_slices_[index] の値を文字列にして分割し､values に入れる
+  void CreateHeaderValue(size_t index, std::vector<std::string> &values) const;
   HttpStatus InterpretContentLength(
       const HeaderMap::mapped_type &length_header);
   HttpStatus InterpretTransferEncoding(
       const HeaderMap::mapped_type &encoding_header);
-  ParsingPhase ParsePlainBody(utils::ByteVector &buffer);
-  ParsingPhase ParseChunkedBody(utils::ByteVector &buffer);
+  ParsingPhase ParsePlainBody(utils::ByteBuffer &buffer);
+  ParsingPhase ParseChunkedBody(utils::ByteBuffer &buffer);
 
   HttpStatus DecideBodySize();
   bool LoadVirtualServer(const config::Config &conf, const std::string &ip,
@@ -1,12 +1,13 @@
 #include "http/http_response.hpp"
 
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/stat.h>
-#include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <cerrno>
 #include <ctime>
 #include <vector>
 
@@ -15,15 +16,17 @@
 #include "http/http_constants.hpp"
 #include "http/http_request.hpp"
 #include "server/epoll.hpp"
+#include "server/stats.hpp"
 #include "utils/io.hpp"
 #include "utils/path.hpp"
 #include "utils/string.hpp"
+#include "utils/time.hpp"
 
 namespace http {
 
 namespace {
-std::string GetTimeStamp();
-bool AppendBytesToFile(const std::string &path, const utils::ByteVector &bytes);
+std::string GetTimeStamp(const utils::CachedClock &clock);
+bool AppendBodyToFile(const std::string &path, const utils::SpoolBuffer &body);
 }  // namespace
 const std::string HttpResponse::kDefaultHttpVersion = "HTTP/1.1";
 
@@ -38,6 +41,8 @@ HttpResponse::HttpResponse(const config::LocationConf *location,
       headers_(),
       write_buffer_(),
       file_fd_(-1),
+      file_size_(0),
+      is_small_file_inlined_(false),
       response_type_(response_type) {
   assert(epoll_ != NULL);
 }
@@ -54,6 +59,8 @@ HttpResponse::HttpResponse(const config::LocationConf *location,
       headers_(),
       write_buffer_(),
       file_fd_(-1),
+      file_size_(0),
+      is_small_file_inlined_(false),
       response_type_(response_type) {
   assert(status >= 400);
   phase_ = MakeErrorResponse(status);
@@ -86,37 +93,71 @@ Result<void> HttpResponse::RegisterFile(const std::string &file_path) {
     file_fd_ = -1;
     return Error();
   }
-  SetHeader("Content-Length", utils::ConvertToStr(file_size.Ok()));
+  file_size_ = file_size.Ok();
+  SetHeader("Content-Length", utils::ConvertToStr(file_size_));
   return Result<void>();
 }
 
 //========================================================================
 // Writer
 
-Result<void> HttpResponse::WriteToSocket(const int fd) {
-  ssize_t write_size = write_buffer_.size() < kWriteMaxSize
-                           ? write_buffer_.size()
-                           : kWriteMaxSize;
-  if (write_size == 0)
-    return Result<void>();
-  ssize_t write_res = write(fd, write_buffer_.data(), write_size);
-  if (write_res < 0)
+Result<void> HttpResponse::WriteToSocket(utils::OutputSink &sink) {
+  return WriteChainToSocket(sink, write_buffer_);
+}
+
+Result<void> HttpResponse::WriteChainToSocket(utils::OutputSink &sink,
+                                              utils::OutputChain &chain) {
+  long syscall_num = 0;
+  long written_size = 0;
+  bool is_error = false;
+  while (!chain.empty()) {
+    // 一部しか書き込めなかった場合は書き込めたサイズだけ消費される
+    Result<size_t> write_res = chain.WriteTo(sink, kWriteMaxSize);
+    ++syscall_num;
+    if (write_res.IsErr()) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        server::IncrementStat(server::kStatWriteEagain);
+      } else {
+        is_error = true;
+      }
+      break;
+    }
+    written_size += write_res.Ok();
+  }
+  // 統計はまとめて足す (カウンターの更新はアトミック命令なので)
+  server::IncrementStat(server::kStatWriteSyscalls, syscall_num);
+  server::IncrementStat(server::kStatWriteBytes, written_size);
+  if (is_error) {
     return Error();
-  write_buffer_.EraseHead(write_size);
+  }
   return Result<void>();
 }
 
-Result<bool> HttpResponse::ReadFile() {
-  utils::Byte buf[kBytesPerRead];
-  ssize_t read_res = read(file_fd_, buf, kBytesPerRead);
-  if (read_res < 0) {
-    return Error();
-  } else if (read_res == 0) {
-    return true;
-  } else {
-    write_buffer_.AppendDataToBuffer(buf, read_res);
+bool HttpResponse::MoveWriteBufferTo(utils::OutputChain &output) {
+  if (phase_ != kComplete || IsCgiResponse() || write_buffer_.HasFile()) {
     return false;
   }
+  output.AppendChain(write_buffer_);
+  return true;
+}
+
+void HttpResponse::SetIsSmallFileInlined(bool is_small_file_inlined) {
+  is_small_file_inlined_ = is_small_file_inlined;
+}
+
+void HttpResponse::AppendFileBody() {
+  if (is_small_file_inlined_ && file_size_ <= kMaxInlineFileSize) {
+    utils::ByteVector body;
+    body.resize(file_size_);
+    ssize_t read_res =
+        file_size_ == 0 ? 0 : pread(file_fd_, &body[0], file_size_, 0);
+    // 読み込めなければ書き込む時に読み込み直してエラーにする
+    if (read_res >= 0 && static_cast<unsigned long>(read_res) == file_size_) {
+      write_buffer_.AppendBytes(body);
+      return;
+    }
+  }
+  write_buffer_.AppendFile(file_fd_, 0, file_size_);
 }
 
 //========================================================================
@@ -190,11 +231,12 @@ HttpResponse::CreateResponsePhase HttpResponse::ExecutePostRequest(
   }
   bool is_dir = is_dir_res.Ok();
   std::string target =
-      is_dir ? utils::JoinPath(request_path, GetTimeStamp()) : request_path;
+      is_dir ? utils::JoinPath(request_path, GetTimeStamp(epoll_->GetClock()))
+             : request_path;
 
   HttpStatus response_status = utils::IsFileExist(target) ? OK : CREATED;
 
-  if (AppendBytesToFile(target, request.GetBody()) == false) {
+  if (AppendBodyToFile(target, request.GetBody()) == false) {
     return MakeErrorResponse(SERVER_ERROR);
   }
 
@@ -221,8 +263,10 @@ std::string HttpResponse::CreateResourceUrl(const std::string &local_path,
   const std::string protocol = "http://";
 
   std::string host;
-  if (request.GetHeader("Host").IsOk()) {
-    host = request.GetHeader("Host").Ok()[0];
+  Result<const std::vector<std::string> &> host_res =
+      request.GetHeader(kHeaderHost);
+  if (host_res.IsOk()) {
+    host = host_res.Ok()[0];
   } else {
     host = conn_sock->GetServerIp() + ":" + conn_sock->GetServerPort();
   }
@@ -274,22 +318,20 @@ HttpResponse::CreateResponsePhase HttpResponse::ExecuteRequest(
 }
 
 Result<HttpResponse::CreateResponsePhase> HttpResponse::MakeResponseBody() {
-  if (file_fd_ < 0)
-    return kComplete;
-  Result<bool> result = ReadFile();
-  if (result.IsErr()) {
-    return result.Err();
-  } else {
-    return result.Ok() ? kComplete : kBody;
-  }
+  if (file_fd_ >= 0)
+    AppendFileBody();
+  return kComplete;
 }
 
 Result<void> HttpResponse::PrepareToWrite(server::ConnSocket *conn_sock) {
+  write_buffer_.SetUseSendfile(conn_sock->GetConfig().GetIsSendfile());
+  write_buffer_.SetUseMsgMore(conn_sock->GetConfig().GetIsTcpNopush());
   if (phase_ == kExecuteRequest) {
     phase_ = ExecuteRequest(conn_sock);
   }
   if (phase_ == kStatusAndHeader) {
-    write_buffer_.AppendDataToBuffer(SerializeStatusAndHeader());
+    utils::ByteVector header = SerializeStatusAndHeader();
+    write_buffer_.AppendBytes(header);
     phase_ = kBody;
   }
   if (phase_ == kBody) {
@@ -306,8 +348,19 @@ HttpResponse::CreateResponsePhase HttpResponse::MakeResponse(
   write_buffer_.clear();
   if (body.empty() == false)
     SetHeader("Content-Length", utils::ConvertToStr(body.size()));
-  write_buffer_.AppendDataToBuffer(SerializeStatusAndHeader());
-  write_buffer_.AppendDataToBuffer(body);
+  utils::ByteVector header = SerializeStatusAndHeader();
+  write_buffer_.AppendBytes(header);
+  write_buffer_.AppendBytes(body);
+  return kComplete;
+}
+
+HttpResponse::CreateResponsePhase HttpResponse::MakeResponse(
+    utils::SharedBlob *body) {
+  write_buffer_.clear();
+  SetHeader("Content-Length", utils::ConvertToStr(body->size()));
+  utils::ByteVector header = SerializeStatusAndHeader();
+  write_buffer_.AppendBytes(header);
+  write_buffer_.AppendShared(body);
   return kComplete;
 }
 
@@ -316,7 +369,8 @@ HttpResponse::CreateResponsePhase HttpResponse::MakeRedirectResponse() {
   SetStatus(FOUND);
   SetHeader("Content-Length", "0");
   SetHeader("Location", location_->GetRedirectUrl());
-  write_buffer_.AppendDataToBuffer(SerializeStatusAndHeader());
+  utils::ByteVector header = SerializeStatusAndHeader();
+  write_buffer_.AppendBytes(header);
   return kComplete;
 }
 
@@ -357,13 +411,13 @@ HttpResponse::CreateResponsePhase HttpResponse::MakeErrorResponse(
   SetHeader("Connection", "close");
 
   if (location_ == NULL)
-    return MakeResponse(SerializeErrorResponseBody(status));
+    return MakeResponse(GetErrorResponseBody(status));
 
   const std::map<http::HttpStatus, std::string> &error_pages =
       location_->GetErrorPages();
   if (error_pages.find(status) == error_pages.end() ||
       RegisterFile(error_pages.at(status)).IsErr()) {
-    return MakeResponse(SerializeErrorResponseBody(status));
+    return MakeResponse(GetErrorResponseBody(status));
   } else {
     SetHeader("Content-Type",
               ContentTypes::GetContentTypeFromExt(
@@ -388,6 +442,26 @@ std::string HttpResponse::SerializeErrorResponseBody(HttpStatus status) {
   return head + body + tail;
 }
 
+utils::SharedBlob *HttpResponse::GetErrorResponseBody(HttpStatus status) {
+  // 複数のスレッドから呼ばれるので mutex で守る｡
+  // 作ったボディは解放せずに使い回す｡
+  static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+  static std::map<HttpStatus, utils::SharedBlob *> bodies;
+
+  pthread_mutex_lock(&mutex);
+  std::map<HttpStatus, utils::SharedBlob *>::iterator it = bodies.find(status);
+  if (it == bodies.end()) {
+    it = bodies
+             .insert(std::make_pair(
+                 status, new utils::SharedBlob(
+                             SerializeErrorResponseBody(status))))
+             .first;
+  }
+  utils::SharedBlob *body = it->second;
+  pthread_mutex_unlock(&mutex);
+  return body;
+}
+
 //========================================================================
 // Status checker
 
@@ -395,6 +469,10 @@ bool HttpResponse::IsAllDataWritingCompleted() {
   return phase_ == kComplete && write_buffer_.empty();
 }
 
+bool HttpResponse::IsAllDataPrepared() const {
+  return phase_ == kComplete;
+}
+
 bool HttpResponse::IsWriteBufferEmpty() const {
   return write_buffer_.empty();
 }
@@ -406,6 +484,14 @@ utils::ByteVector HttpResponse::SerializeStatusAndHeader() const {
   utils::ByteVector bytes;
   utils::ByteVector status_line = SerializeStatusLine();
   bytes.insert(bytes.end(), status_line.begin(), status_line.end());
+  // CGI のヘッダーは大文字になっている
+  if (headers_.find("Date") == headers_.end() &&
+      headers_.find("DATE") == headers_.end()) {
+    // 文字列はイベントループの時計が1秒ごとに作り直したものを使う
+    const std::string date_line =
+        "Date: " + epoll_->GetClock().GetImfFixdate() + http::kCrlf;
+    bytes.insert(bytes.end(), date_line.begin(), date_line.end());
+  }
   utils::ByteVector header_lines = SerializeHeaders();
   bytes.insert(bytes.end(), header_lines.begin(), header_lines.end());
   bytes.insert(bytes.end(), kCrlf.begin(), kCrlf.end());
@@ -483,7 +569,7 @@ const std::vector<std::string> &HttpResponse::GetHeader(
 
 bool HttpResponse::IsRequestHasConnectionClose(const HttpRequest &request) {
   Result<const http::HeaderMap::mapped_type &> header_res =
-      request.GetHeader("Connection");
+      request.GetHeader(kHeaderConnection);
   if (header_res.IsErr())
     return false;
   const http::HeaderMap::mapped_type &header = header_res.Ok();
@@ -492,18 +578,22 @@ bool HttpResponse::IsRequestHasConnectionClose(const HttpRequest &request) {
 }
 
 namespace {
-std::string GetTimeStamp() {
-  std::stringstream ss;
-  struct timeval time_now;
-  gettimeofday(&time_now, NULL);
-  time_t msecs_time = (time_now.tv_sec * 1000000 + time_now.tv_usec);
+// POST でディレクトリに作成するファイルの名前
+//
+// 時刻はイベントループの時計のものを使うので同じ ms 内では同じになる｡
+// 複数のスレッドやワーカープロセスで名前が被らないように､
+// プロセス内で一意な番号と pid を付ける｡
+std::string GetTimeStamp(const utils::CachedClock &clock) {
+  static unsigned long sequence = 0;
+  unsigned long seq = __sync_fetch_and_add(&sequence, 1);
 
-  ss << msecs_time;
+  std::stringstream ss;
+  ss << clock.GetNowMs() << "-" << getpid() << "-" << seq;
   return ss.str();
 }
 
-bool AppendBytesToFile(const std::string &path,
-                       const utils::ByteVector &bytes) {
+// 一時ファイルに書き出したボディも少しずつ読み込んで書き込む
+bool AppendBodyToFile(const std::string &path, const utils::SpoolBuffer &body) {
   bool file_exist = utils::IsFileExist(path);
   bool has_error = false;
 
@@ -511,11 +601,7 @@ bool AppendBytesToFile(const std::string &path,
   has_error = fd < 0;
 
   if (has_error == false) {
-    if (bytes.empty() == false) {
-      ssize_t write_res =
-          write(fd, bytes.SubstrBeforePos(bytes.size()).c_str(), bytes.size());
-      has_error = write_res < static_cast<ssize_t>(bytes.size());
-    }
+    has_error = body.WriteAllTo(fd).IsErr();
     close(fd);
   }
   if (has_error && file_exist == false)
@@ -12,6 +12,7 @@
 #include "server/epoll.hpp"
 #include "server/socket.hpp"
 #include "utils/File.hpp"
+#include "utils/OutputChain.hpp"
 
 namespace server {
 class ConnSocket;
@@ -34,9 +35,6 @@ class HttpResponse {
     kComplete
   };
 
-  // 1回のreadで何バイト読み取るか
-  static const unsigned long kBytesPerRead = 1024;  // 1KB
-
   const config::LocationConf *location_;
   server::Epoll *epoll_;
 
@@ -46,6 +44,8 @@ class HttpResponse {
   // デフォルトのHTTPバージョン(HTTP/1.1)
   static const std::string kDefaultHttpVersion;
   static const ssize_t kWriteMaxSize = 1024 * 1024;
+  // SetIsSmallFileInlined(true) の場合にこれ以下のファイルは読み込んで繋げる
+  static const unsigned long kMaxInlineFileSize = 16 * 1024;
 
   // Status Line
   std::string http_version_;
@@ -56,12 +56,16 @@ class HttpResponse {
   HeaderMap headers_;
 
   //書き込みのバッファ
-  utils::ByteVector write_buffer_;
+  // ヘッダーやボディはコピーせずに繋げ､writev(2) でまとめて書き込む｡
+  utils::OutputChain write_buffer_;
 
   // File
   // 全てのレスポンスクラスはファイルを返せる必要がある｡
   // なぜならエラー時にファイルを扱う可能性があるからである｡
   int file_fd_;
+  unsigned long file_size_;
+  // 小さいファイルを書き込む時ではなく繋げる時に読み込むか
+  bool is_small_file_inlined_;
   EResponseType response_type_;
 
  public:
@@ -81,17 +85,40 @@ class HttpResponse {
   // すべてのデータの write が完了したか
   bool IsAllDataWritingCompleted();
 
+  // レスポンスを作り終えたか (まだ書き込んでいないデータがあっても良い)
+  bool IsAllDataPrepared() const;
+
   bool IsWriteBufferEmpty() const;
 
   bool IsCgiResponse() const;
 
   const std::vector<std::string> &GetHeader(const std::string &header);
-  Result<void> WriteToSocket(const int fd);
+
+  // write_buffer_ が空になるか EAGAIN になるまで sink に書き込む｡
+  // EAGAIN はエラーにしない｡
+  Result<void> WriteToSocket(utils::OutputSink &sink);
+
+  // chain が空になるか EAGAIN になるまで sink に書き込む｡
+  // EAGAIN はエラーにしない｡
+  static Result<void> WriteChainToSocket(utils::OutputSink &sink,
+                                         utils::OutputChain &chain);
+
+  // PrepareToWrite() の前に呼ぶ｡ true なら kMaxInlineFileSize 以下の
+  // ファイルは write_buffer_ に読み込み､MoveWriteBufferTo() で移せるようにする｡
+  void SetIsSmallFileInlined(bool is_small_file_inlined);
+
+  // レスポンスを作り終えていて write_buffer_ がファイルを参照していなければ､
+  // write_buffer_ の中身を output に移して true を返す｡
+  // (パイプライン化されたリクエストのレスポンスをまとめて書き込むため)
+  // CGI のレスポンスは移さない｡
+  bool MoveWriteBufferTo(utils::OutputChain &output);
 
  protected:
   // ファイルをopenし､Epollで監視する
   Result<void> RegisterFile(const std::string &file_path);
-  Result<bool> ReadFile();
+  // ファイル全体を write_buffer_ に繋げる｡ 読み込みは書き込む時に行う｡
+  // (is_small_file_inlined_ なら小さいファイルはここで読み込む)
+  void AppendFileBody();
 
   // ========================================================================
   // Getter and Setter
@@ -128,9 +155,12 @@ class HttpResponse {
   utils::ByteVector SerializeStatusLine() const;
   utils::ByteVector SerializeHeaders() const;
   CreateResponsePhase MakeResponse(const std::string &body);
+  CreateResponsePhase MakeResponse(utils::SharedBlob *body);
 
   CreateResponsePhase MakeRedirectResponse();
-  std::string SerializeErrorResponseBody(HttpStatus status);
+  static std::string SerializeErrorResponseBody(HttpStatus status);
+  // デフォルトのエラーページのボディ｡ ステータスごとに1度だけ作り共有する｡
+  static utils::SharedBlob *GetErrorResponseBody(HttpStatus status);
 
   CreateResponsePhase MakeAutoIndexResponse(const std::string &abs,
                                             const std::string &relative);
@@ -26,6 +26,7 @@ enum HttpStatus {
   REQUEST_TIMEOUT = 408,
   PAYLOAD_TOO_LARGE = 413,
   URI_TOO_LONG = 414,
+  REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
   SERVER_ERROR = 500,
   NOT_IMPLEMENTED = 501,
   SERVICE_UNAVAILABLE = 503,
@@ -0,0 +1,63 @@
+#include "http/known_header.hpp"
+
+#include <strings.h>
+
+#include <cassert>
+#include <cctype>
+#include <cstring>
+
+namespace http {
+
+namespace {
+
+// KnownHeader の順に並べたヘッダー名
+const char *const kKnownHeaderNames[kKnownHeaderNum] = {
+    "Host", "Connection", "Content-Length", "Content-Type",
+    "Transfer-Encoding"};
+
+// 長さと先頭の文字(小文字)の和を表の大きさで割った余りをハッシュ値にする｡
+// 既知のヘッダー名同士では衝突しない (完全ハッシュ) ように表の大きさを選ぶ｡
+// ヘッダーを追加して衝突した場合は KnownHeaderTable() の assert で分かる｡
+const size_t kTableSize = 16;
+
+size_t Hash(const char *name, size_t size) {
+  return (size + std::tolower(static_cast<unsigned char>(name[0]))) %
+         kTableSize;
+}
+
+// ハッシュ値から KnownHeader を引く表｡ 空いている所は kKnownHeaderNum｡
+struct KnownHeaderTable {
+  KnownHeader slots[kTableSize];
+
+  KnownHeaderTable() {
+    for (size_t i = 0; i < kTableSize; ++i) {
+      slots[i] = kKnownHeaderNum;
+    }
+    for (int header = 0; header < kKnownHeaderNum; ++header) {
+      const char *name = kKnownHeaderNames[header];
+      size_t hash = Hash(name, std::strlen(name));
+      assert(slots[hash] == kKnownHeaderNum);
+      slots[hash] = static_cast<KnownHeader>(header);
+    }
+  }
+};
+
+const KnownHeaderTable kTable;
+
+}  // namespace
+
+KnownHeader LookupKnownHeader(const char *name, size_t size) {
+  if (size == 0) {
+    return kKnownHeaderNum;
+  }
+  KnownHeader header = kTable.slots[Hash(name, size)];
+  // 同じハッシュ値の既知でないヘッダー名もあるので名前を比べて確かめる
+  if (header == kKnownHeaderNum ||
+      std::strlen(kKnownHeaderNames[header]) != size ||
+      strncasecmp(kKnownHeaderNames[header], name, size) != 0) {
+    return kKnownHeaderNum;
+  }
+  return header;
+}
+
+}  // namespace http
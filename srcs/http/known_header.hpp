@@ -0,0 +1,26 @@
+#ifndef HTTP_KNOWN_HEADER_HPP_
+#define HTTP_KNOWN_HEADER_HPP_
+
+#include <cstddef>
+
+namespace http {
+
+// サーバーが値を参照するリクエストヘッダー｡
+// パースする時にヘッダー名から決めておき､HttpRequest::GetHeader() で
+// ヘッダー名を比較せずに取り出せるようにする｡
+enum KnownHeader {
+  kHeaderHost,
+  kHeaderConnection,
+  kHeaderContentLength,
+  kHeaderContentType,
+  kHeaderTransferEncoding,
+  kKnownHeaderNum
+};
+
+// ヘッダー名(大文字小文字は区別しない)に対応する KnownHeader を返す｡
+// 既知のヘッダーでなければ kKnownHeaderNum を返す｡
+KnownHeader LookupKnownHeader(const char *name, size_t size);
+
+}  // namespace http
+
+#endif
@@ -0,0 +1,55 @@
+#include "http/scan.hpp"
+
+#include <cstring>
+
+#include "http/http_constants.hpp"
+
+namespace http {
+
+namespace {
+
+// kTchars.is_tchar[c] が true なら c は tchar
+struct TcharTable {
+  bool is_tchar[256];
+
+  TcharTable() {
+    for (int c = 0; c < 256; ++c) {
+      is_tchar[c] = ('0' <= c && c <= '9') || ('a' <= c && c <= 'z') ||
+                    ('A' <= c && c <= 'Z');
+    }
+    for (size_t i = 0; i < kTcharsWithoutAlnum.size(); ++i) {
+      is_tchar[static_cast<unsigned char>(kTcharsWithoutAlnum[i])] = true;
+    }
+  }
+};
+
+const TcharTable kTchars;
+
+}  // namespace
+
+const char *FindCrlf(const char *begin, const char *end) {
+  // CR は memchr(3) で探し､次のバイトが LF か確かめる
+  const char *p = begin;
+  while (end - p >= 2) {
+    const char *cr =
+        static_cast<const char *>(std::memchr(p, '\r', end - p - 1));
+    if (cr == NULL) {
+      break;
+    }
+    if (cr[1] == '\n') {
+      return cr;
+    }
+    p = cr + 1;
+  }
+  return end;
+}
+
+size_t SpanTchar(const char *str, size_t size) {
+  size_t i = 0;
+  while (i < size && kTchars.is_tchar[static_cast<unsigned char>(str[i])]) {
+    ++i;
+  }
+  return i;
+}
+
+}  // namespace http
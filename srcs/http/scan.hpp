@@ -0,0 +1,20 @@
+#ifndef HTTP_SCAN_HPP_
+#define HTTP_SCAN_HPP_
+
+#include <cstddef>
+
+namespace http {
+
+// リクエストのパースで使うバイト列の走査
+
+// [begin, end) で最初に現れる CRLF の CR の位置を返す｡ 無ければ end を返す｡
+const char *FindCrlf(const char *begin, const char *end);
+
+// str の先頭から続く tchar の数を返す｡
+// tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*"
+//         "+" / "-" / "." / "^" / "_" / "`" / "|" / "~"/ DIGIT / ALPHA
+size_t SpanTchar(const char *str, size_t size);
+
+}  // namespace http
+
+#endif
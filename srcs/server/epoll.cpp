@@ -1,8 +1,7 @@
 #include "server/epoll.hpp"
 
-#include <unistd.h>
-
 #include <cassert>
+#include <climits>
 #include <cstdio>
 #include <vector>
 
@@ -15,18 +14,24 @@ namespace server {
 
 namespace {
 
-epoll_event CalculateEpollEvent(FdEvent *fde) {
-  epoll_event epev;
-  epev.events = 0;
+uint32_t CalculateEpollEvent(FdEvent *fde, bool is_edge_triggered) {
+  uint32_t events = 0;
   if (fde->state & kFdeRead) {
-    epev.events |= EPOLLIN;
+    events |= EPOLLIN;
   }
   if (fde->state & kFdeWrite) {
-    epev.events |= EPOLLOUT;
+    events |= EPOLLOUT;
+  }
+  if (fde->is_exclusive) {
+    // EPOLLRDHUP は EPOLLEXCLUSIVE と一緒に使えない
+    events |= EPOLLEXCLUSIVE;
+  } else {
+    events |= EPOLLRDHUP;
   }
-  epev.events |= EPOLLRDHUP;
-  epev.data.fd = fde->fd;
-  return epev;
+  if (is_edge_triggered) {
+    events |= EPOLLET;
+  }
+  return events;
 }
 
 FdEventEvent CalculateFdEventEvent(FdEvent *fde, epoll_event epev) {
@@ -71,6 +76,17 @@ FdEvent *CreateFdEvent(int fd, FdFunc func, void *data) {
   fde->timeout_ms = 0;
   fde->data = data;
   fde->state = 0;
+  fde->is_exclusive = false;
+  fde->is_stream = false;
+  fde->is_in_backend = false;
+  fde->backend_state = 0;
+  fde->is_dirty = false;
+  fde->should_rearm = false;
+  fde->timer_prev = NULL;
+  fde->timer_next = NULL;
+  fde->timer_expire = 0;
+  fde->timer_level = -1;
+  fde->timer_slot = -1;
   return fde;
 }
 
@@ -78,50 +94,66 @@ void InvokeFdEvent(FdEvent *fde, unsigned int events, Epoll *epoll) {
   fde->func(fde, events, fde->data, epoll);
 }
 
-Epoll::Epoll() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {
-  if (epfd_ < 0) {
-    utils::ErrExit("Epoll constructor");
-  }
-}
+Epoll::Epoll(int max_events, bool is_edge_triggered,
+             config::Config::EventBackend backend)
+    : backend_(CreateEventBackend(backend)),
+      is_edge_triggered_(is_edge_triggered),
+      fd_events_(),
+      epoll_events_(max_events > 0 ? max_events : kDefaultMaxEvents),
+      clock_(),
+      timer_wheel_(clock_.GetNowMs()),
+      expired_fdes_(),
+      dirty_fds_() {}
 
 Epoll::~Epoll() {
-  close(epfd_);
+  delete backend_;
 }
 
-void Epoll::Register(FdEvent *fde) {
-  assert(registered_fd_events_.find(fde->fd) == registered_fd_events_.end());
-  epoll_event epev = CalculateEpollEvent(fde);
-
-  if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fde->fd, &epev) < 0) {
-    utils::ErrExit("Epoll::Register epoll_ctl");
+void Epoll::Register(FdEvent *fde, bool is_exclusive) {
+  assert(fde->fd >= 0);
+  assert(GetFdeByFd(fde->fd) == NULL);
+  fde->is_exclusive = is_exclusive;
+  fde->is_stream = false;
+  fde->is_in_backend = false;
+  fde->is_dirty = false;
+  fde->should_rearm = false;
+  if (static_cast<size_t>(fde->fd) >= fd_events_.size()) {
+    fd_events_.resize(fde->fd + 1, NULL);
   }
-  registered_fd_events_[fde->fd] = fde;
+  fd_events_[fde->fd] = fde;
+  MarkDirty(fde);
+}
+
+void Epoll::RegisterStream(FdEvent *fde) {
+  Register(fde);
+  // backend には次の WaitEvents() で登録するので､それまでに設定すれば良い
+  fde->is_stream = true;
 }
 
 void Epoll::Unregister(FdEvent *fde) {
-  if (registered_fd_events_.find(fde->fd) == registered_fd_events_.end()) {
+  if (GetFdeByFd(fde->fd) != fde) {
     return;
   }
 
-  if (epoll_ctl(epfd_, EPOLL_CTL_DEL, fde->fd, NULL) < 0) {
-    utils::ErrExit("Epoll::Unregister epoll_ctl");
+  // backend に登録する前なら何もしなくて良い
+  if (fde->is_in_backend && backend_->Remove(fde).IsErr()) {
+    utils::ErrExit("Epoll::Unregister");
   }
-  registered_fd_events_.erase(fde->fd);
+  fde->is_in_backend = false;
+  fde->is_dirty = false;
+  timer_wheel_.Disarm(fde);
+  fd_events_[fde->fd] = NULL;
 }
 
 void Epoll::Set(FdEvent *fde, unsigned int events) {
-  unsigned int previous_state = fde->state;
   fde->state = events;
-  // 前回と同じだったら epoll_ctl は実行しない
-  // kFdeTimeout が変わっても epoll を変更する必要はない
-  if ((fde->state & ~kFdeTimeout) == (previous_state & ~kFdeTimeout)) {
-    return;
-  }
-
-  epoll_event epev = CalculateEpollEvent(fde);
-  if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fde->fd, &epev) < 0) {
-    utils::ErrExit("Epoll:Set epoll_ctl");
+  if (!(fde->state & kFdeTimeout)) {
+    timer_wheel_.Disarm(fde);
   }
+  // backend に反映済みの state と同じなら反映しなくて良いが､
+  // その判定は反映する時に行う｡ (元に戻った変更を反映しないため)
+  // kFdeTimeout が変わっても backend を変更する必要はない
+  MarkDirty(fde);
 }
 
 void Epoll::Add(FdEvent *fde, unsigned int events) {
@@ -132,64 +164,169 @@ void Epoll::Del(FdEvent *fde, unsigned int events) {
   Set(fde, fde->state & ~events);
 }
 
+void Epoll::Rearm(FdEvent *fde) {
+  fde->should_rearm = true;
+  MarkDirty(fde);
+}
+
+bool Epoll::IsEdgeTriggered() const {
+  return is_edge_triggered_;
+}
+
+const utils::CachedClock &Epoll::GetClock() const {
+  return clock_;
+}
+
+const char *Epoll::GetBackendName() const {
+  return backend_->GetName();
+}
+
 void Epoll::SetTimeout(FdEvent *fde, long timeout_ms) {
   Add(fde, kFdeTimeout);
   fde->timeout_ms = timeout_ms;
-  fde->last_active = utils::GetCurrentTimeMs();
+  fde->last_active = clock_.GetNowMs();
+  timer_wheel_.Arm(fde, clock_.GetNowMs());
 }
 
-Result<std::vector<FdEventEvent> > Epoll::WaitEvents(int timeout_ms) {
-  std::vector<FdEventEvent> fdee_vec;
-  std::vector<epoll_event> epoll_events;
-  epoll_events.resize(registered_fd_events_.size());
+Result<void> Epoll::WaitEvents(std::vector<FdEventEvent> &fdees,
+                              int timeout_ms) {
+  fdees.clear();
+  ApplyDirtyFds();
 
-  int event_num =
-      epoll_wait(epfd_, epoll_events.data(), epoll_events.size(), timeout_ms);
-
-  if (event_num < 0) {
-    return Error();
+  Result<int> wait_res =
+      backend_->Wait(epoll_events_.data(), epoll_events_.size(), timeout_ms);
+  if (wait_res.IsErr()) {
+    return wait_res.Err();
   }
+  int event_num = wait_res.Ok();
+  clock_.Update();
 
   for (int i = 0; i < event_num; ++i) {
-    assert(registered_fd_events_.find(epoll_events[i].data.fd) !=
-           registered_fd_events_.end());
-    FdEvent *fde = registered_fd_events_[epoll_events[i].data.fd];
-    FdEventEvent fdee = CalculateFdEventEvent(fde, epoll_events[i]);
-    fdee_vec.push_back(fdee);
-
-    fde->last_active = utils::GetCurrentTimeMs();
-  }
-
-  return fdee_vec;
-}
-
-std::vector<FdEventEvent> Epoll::RetrieveTimeouts() {
-  std::vector<FdEventEvent> fdee_vec;
-
-  long current_time = utils::GetCurrentTimeMs();
-  for (std::map<int, FdEvent *>::const_iterator it =
-           registered_fd_events_.begin();
-       it != registered_fd_events_.end(); ++it) {
-    FdEvent *fde = it->second;
-    if (fde->state & kFdeTimeout &&
-        current_time - fde->last_active > fde->timeout_ms) {
-      FdEventEvent fdee;
-      fdee.fde = fde;
-      // TCP FIN が送信したデータより早く来る場合があり､
-      // その対策として kFdeError で接続切断をするのではなく､
-      // read(conn_fd) の返り値が0(EOF)または-1(Error)だったら切断する｡
-      fdee.events = kFdeTimeout | kFdeRead;
-      fdee_vec.push_back(fdee);
+    FdEvent *fde = reinterpret_cast<FdEvent *>(epoll_events_[i].data.ptr);
+    assert(GetFdeByFd(fde->fd) == fde);
+    fdees.push_back(CalculateFdEventEvent(fde, epoll_events_[i]));
+
+    fde->last_active = clock_.GetNowMs();
+  }
+
+  return Result<void>();
+}
+
+void Epoll::RetrieveTimeouts(std::vector<FdEventEvent> &fdees) {
+  fdees.clear();
+  expired_fdes_.clear();
+
+  clock_.Update();
+  timer_wheel_.RetrieveExpired(clock_.GetNowMs(), expired_fdes_);
+  for (std::vector<FdEvent *>::const_iterator it = expired_fdes_.begin();
+       it != expired_fdes_.end(); ++it) {
+    FdEventEvent fdee;
+    fdee.fde = *it;
+    // TCP FIN が送信したデータより早く来る場合があり､
+    // その対策として kFdeError で接続切断をするのではなく､
+    // read(conn_fd) の返り値が0(EOF)または-1(Error)だったら切断する｡
+    fdee.events = kFdeTimeout | kFdeRead;
+    fdees.push_back(fdee);
+  }
+}
+
+void Epoll::MarkDirty(FdEvent *fde) {
+  if (fde->is_dirty || GetFdeByFd(fde->fd) != fde) {
+    return;
+  }
+  fde->is_dirty = true;
+  dirty_fds_.push_back(fde->fd);
+}
+
+void Epoll::ApplyDirtyFds() {
+  for (std::vector<int>::const_iterator it = dirty_fds_.begin();
+       it != dirty_fds_.end(); ++it) {
+    // Unregister() された fd や､別の FdEvent で登録し直された fd の場合もある
+    FdEvent *fde = GetFdeByFd(*it);
+    if (fde == NULL || !fde->is_dirty) {
+      continue;
+    }
+    fde->is_dirty = false;
+
+    unsigned int state = fde->state & ~kFdeTimeout;
+    if (!fde->is_in_backend) {
+      if (backend_->Add(fde, CalculateEpollEvent(fde, is_edge_triggered_))
+              .IsErr()) {
+        utils::ErrExit("Epoll::ApplyDirtyFds");
+      }
+      fde->is_in_backend = true;
+    } else if (state != fde->backend_state || fde->should_rearm) {
+      ModifyBackend(fde);
+    }
+    fde->backend_state = state;
+    fde->should_rearm = false;
+  }
+  dirty_fds_.clear();
+}
+
+void Epoll::ModifyBackend(FdEvent *fde) {
+  uint32_t events = CalculateEpollEvent(fde, is_edge_triggered_);
+  if (fde->is_exclusive) {
+    // EPOLLEXCLUSIVE を付けた fd は EPOLL_CTL_MOD できないので登録し直す
+    if (backend_->Remove(fde).IsErr() || backend_->Add(fde, events).IsErr()) {
+      utils::ErrExit("Epoll::ModifyBackend");
     }
+    return;
+  }
+  if (backend_->Modify(fde, events).IsErr()) {
+    utils::ErrExit("Epoll::ModifyBackend");
   }
-  return fdee_vec;
+}
+
+int Epoll::GetWaitTimeoutMs() const {
+  long timeout_ms =
+      timer_wheel_.GetTimeUntilNextExpire(clock_.GetNowMs());
+  if (timeout_ms > INT_MAX) {
+    return INT_MAX;
+  }
+  return timeout_ms;
 }
 
 FdEvent *Epoll::GetFdeByFd(int fd) const {
-  if (registered_fd_events_.find(fd) == registered_fd_events_.end()) {
+  if (fd < 0 || static_cast<size_t>(fd) >= fd_events_.size()) {
     return NULL;
   }
-  return registered_fd_events_.at(fd);
+  return fd_events_[fd];
+}
+
+Result<size_t> Epoll::Read(FdEvent *fde, void *buf, size_t size) {
+  return backend_->Read(fde, buf, size);
+}
+
+Result<size_t> Epoll::Writev(FdEvent *fde, const iovec *iov, int iov_num,
+                             bool has_more) {
+  return backend_->Writev(fde, iov, iov_num, has_more);
+}
+
+Result<size_t> Epoll::SendFile(FdEvent *fde, int in_fd, off_t offset,
+                               size_t size) {
+  return backend_->SendFile(fde, in_fd, offset, size);
+}
+
+Result<void> Epoll::ShutDown(FdEvent *fde) {
+  return backend_->ShutDown(fde);
+}
+
+// ========================================================================
+// FdEventSink
+
+FdEventSink::FdEventSink(Epoll *epoll, FdEvent *fde)
+    : epoll_(epoll), fde_(fde) {}
+
+FdEventSink::~FdEventSink() {}
+
+Result<size_t> FdEventSink::Writev(const iovec *iov, int iov_num,
+                                   bool has_more) {
+  return epoll_->Writev(fde_, iov, iov_num, has_more);
+}
+
+Result<size_t> FdEventSink::SendFile(int in_fd, off_t offset, size_t size) {
+  return epoll_->SendFile(fde_, in_fd, offset, size);
 }
 
 }  // namespace server
@@ -4,10 +4,14 @@
 #include <sys/epoll.h>
 
 #include <ctime>
-#include <map>
 #include <vector>
 
+#include "config/config.hpp"
 #include "result/result.hpp"
+#include "server/event_backend.hpp"
+#include "server/timer_wheel.hpp"
+#include "utils/OutputChain.hpp"
+#include "utils/time.hpp"
 
 namespace server {
 using namespace result;
@@ -47,6 +51,26 @@ struct FdEvent {
   unsigned int state;
 
   void *data;
+
+  // EPOLLEXCLUSIVE で監視しているか
+  bool is_exclusive;
+
+  // Epoll::Read(), Epoll::Writev() などで読み書きするか
+  bool is_stream;
+
+  // Epoll で監視の変更をまとめて反映するのに利用する｡
+  // backend_state は backend に反映済みの state (kFdeTimeout は含まない)
+  bool is_in_backend;
+  unsigned int backend_state;
+  bool is_dirty;
+  bool should_rearm;
+
+  // TimerWheel で利用する｡ timer_level が -1 なら未登録｡
+  FdEvent *timer_prev;
+  FdEvent *timer_next;
+  long timer_expire;
+  int timer_level;
+  int timer_slot;
 };
 
 // FdEvent を動的確保し､引数を元に初期化を行い､それを返す｡
@@ -58,21 +82,71 @@ FdEvent *CreateFdEvent(int fd, FdFunc func, void *data);
 void InvokeFdEvent(FdEvent *fde, unsigned int events, Epoll *epoll);
 
 class Epoll {
+ public:
+  // 1回の epoll_wait で受け取るイベント数のデフォルト値
+  static const int kDefaultMaxEvents = config::Config::kDefaultEpollEvents;
+
  private:
-  const int epfd_;
+  // fd の監視に使う仕組み (epoll または io_uring)
+  EventBackend *backend_;
+
+  // true なら全ての fd を EPOLLET で監視する
+  const bool is_edge_triggered_;
+
+  // fd_events_[<fd>] = <FdEvent>
+  // 登録されていない fd は NULL
+  std::vector<FdEvent *> fd_events_;
+
+  // backend_->Wait() に渡すバッファ｡ 毎回確保しないように使い回す｡
+  // epoll_event.data.ptr には FdEvent* を入れている｡
+  std::vector<epoll_event> epoll_events_;
+
+  // イベントを待ち終わるたびに更新する時計
+  // イベントハンドラーで現在時刻が必要な場合はこれを使う｡
+  utils::CachedClock clock_;
+
+  // kFdeTimeout が設定されている FdEvent のタイマー
+  TimerWheel timer_wheel_;
 
-  // map[<fd>] = <FdEvent>
-  std::map<int, FdEvent *> registered_fd_events_;
+  // RetrieveTimeouts() で使い回すバッファ
+  std::vector<FdEvent *> expired_fdes_;
+
+  // 監視の登録･変更を backend に反映していない fd
+  // WaitEvents() でイベントを待つ前にまとめて反映する｡
+  std::vector<int> dirty_fds_;
 
  public:
-  Epoll();
+  // max_events は1回の WaitEvents() で取得する最大のイベント数
+  //
+  // is_edge_triggered が true の場合はエッジトリガーで監視する｡
+  // イベントハンドラーは EAGAIN になるまで読み書きを行う必要がある｡
+  //
+  // backend は fd の監視に使う仕組み｡ io_uring が使えない場合は epoll を使う｡
+  explicit Epoll(
+      int max_events = kDefaultMaxEvents, bool is_edge_triggered = false,
+      config::Config::EventBackend backend = config::Config::kEpollBackend);
   ~Epoll();
 
   // Epoll で監視する FdEvent を登録
-  void Register(FdEvent *fde);
+  //
+  // 監視の登録･変更(Register, Set, Add, Del, Rearm)はすぐには反映せず､
+  // 次の WaitEvents() でまとめて反映する｡
+  // 反映するまでに元に戻った変更(Add してから Del するなど)は反映しない｡
+  //
+  // is_exclusive が true なら EPOLLEXCLUSIVE で監視する｡
+  // 複数のプロセスで同じ listen socket を監視する場合に､
+  // 接続1つにつき1つのプロセスだけが起こされるようにするのに使う｡
+  void Register(FdEvent *fde, bool is_exclusive = false);
+
+  // 接続ソケットなど､Read(), Writev() などで読み書きする FdEvent を登録
+  //
+  // io_uring では監視を POLL_ADD で行う代わりに受信･送信自体を submit し､
+  // 読み書きをイベント待ちと同じ io_uring_enter(2) でまとめて行う｡
+  // 登録した fd を直接 read(2), write(2) してはいけない｡
+  void RegisterStream(FdEvent *fde);
 
   // Epoll で監視していた FdEvent を監視対象から外す
-  // fde や fde.data の delete はしない｡
+  // fde や fde.data の delete はしない｡ この後に close() できるようにすぐに反映する｡
   void Unregister(FdEvent *fde);
 
   // 監視するイベントを変更する
@@ -81,23 +155,74 @@ class Epoll {
   void Add(FdEvent *fde, unsigned int events);
   void Del(FdEvent *fde, unsigned int events);
 
+  // 監視するイベントを変えずに監視を登録し直す｡ (epoll では EPOLL_CTL_MOD)
+  // エッジトリガーでは既に読み書き可能な fd のイベントは再度通知されないので､
+  // ソケット以外の理由で処理を再開したい時にこれを呼び､イベントを通知させる｡
+  void Rearm(FdEvent *fde);
+
+  bool IsEdgeTriggered() const;
+
+  // WaitEvents(), RetrieveTimeouts() を呼んだ時点の時刻を持つ時計
+  const utils::CachedClock &GetClock() const;
+
+  // "epoll" や "io_uring" など実際に使っている backend の名前
+  const char *GetBackendName() const;
+
+  // fde->last_active から timeout_ms 経過したら kFdeTimeout を通知する｡
   void SetTimeout(FdEvent *fde, long timeout_ms);
 
-  // 利用可能なイベントをepoll_waitで取得し､FdEventEventを返す｡
+  // 利用可能なイベントを backend から取得し､fdees に FdEventEvent を格納する｡
+  // fdees は最初に clear() される｡ 呼び出し側で使い回すことを想定している｡
   //
   // timeout は ms 単位｡
   // -1を指定すると1つ以上のイベントが利用可能になるまでブロックする｡
-  Result<std::vector<FdEventEvent> > WaitEvents(int timeout_ms = 0);
+  Result<void> WaitEvents(std::vector<FdEventEvent> &fdees, int timeout_ms = 0);
 
-  // Timeoutなfd取得し､FdEventEventを返す｡
-  std::vector<FdEventEvent> RetrieveTimeouts();
+  // Timeoutなfd取得し､fdees に FdEventEvent を格納する｡
+  // fdees は最初に clear() される｡
+  // TimerWheel を使うので期限が来たタイマーしか見ない｡
+  void RetrieveTimeouts(std::vector<FdEventEvent> &fdees);
+
+  // 次にタイムアウトが来るまでの時間(ms)｡ WaitEvents() の timeout_ms に使う｡
+  // タイムアウトが設定されている FdEvent がなければ -1 を返す｡
+  int GetWaitTimeoutMs() const;
 
   FdEvent *GetFdeByFd(int fd) const;
 
+  // fde->fd の読み書き｡ EventBackend の同名のメソッドを参照｡
+  Result<size_t> Read(FdEvent *fde, void *buf, size_t size);
+  Result<size_t> Writev(FdEvent *fde, const iovec *iov, int iov_num,
+                        bool has_more);
+  Result<size_t> SendFile(FdEvent *fde, int in_fd, off_t offset, size_t size);
+  Result<void> ShutDown(FdEvent *fde);
+
  private:
   // epoll instance が片方のみでcloseされるのを防ぐためコピー操作は禁止
   Epoll(const Epoll &rhs);
   Epoll &operator=(const Epoll &rhs);
+
+  // fde を dirty_fds_ に追加する
+  void MarkDirty(FdEvent *fde);
+
+  // dirty_fds_ の FdEvent の state を backend に反映する
+  void ApplyDirtyFds();
+
+  // fde->state を backend に反映する
+  void ModifyBackend(FdEvent *fde);
+};
+
+// Epoll::Writev(), Epoll::SendFile() で fde に書き込む OutputSink
+class FdEventSink : public utils::OutputSink {
+ private:
+  Epoll *epoll_;
+  FdEvent *fde_;
+
+ public:
+  FdEventSink(Epoll *epoll, FdEvent *fde);
+  virtual ~FdEventSink();
+
+  virtual Result<size_t> Writev(const iovec *iov, int iov_num, bool has_more);
+  virtual Result<size_t> SendFile(int in_fd, off_t offset, size_t size);
 };
 
 }  // namespace server
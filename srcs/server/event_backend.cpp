@@ -0,0 +1,107 @@
+#include "server/event_backend.hpp"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "server/epoll.hpp"
+#include "server/io_uring_backend.hpp"
+#include "utils/OutputChain.hpp"
+#include "utils/error.hpp"
+#include "utils/log.hpp"
+
+namespace server {
+
+EventBackend::~EventBackend() {}
+
+Result<size_t> EventBackend::Read(FdEvent *fde, void *buf, size_t size) {
+  ssize_t read_res = read(fde->fd, buf, size);
+  if (read_res < 0) {
+    return Error();
+  }
+  return static_cast<size_t>(read_res);
+}
+
+Result<size_t> EventBackend::Writev(FdEvent *fde, const iovec *iov,
+                                    int iov_num, bool has_more) {
+  utils::FdOutputSink sink(fde->fd);
+  return sink.Writev(iov, iov_num, has_more);
+}
+
+Result<size_t> EventBackend::SendFile(FdEvent *fde, int in_fd, off_t offset,
+                                      size_t size) {
+  utils::FdOutputSink sink(fde->fd);
+  return sink.SendFile(in_fd, offset, size);
+}
+
+Result<void> EventBackend::ShutDown(FdEvent *fde) {
+  if (shutdown(fde->fd, SHUT_RDWR) < 0) {
+    return Error();
+  }
+  return Result<void>();
+}
+
+EventBackend *CreateEventBackend(config::Config::EventBackend backend) {
+  if (backend == config::Config::kIoUringBackend) {
+    EventBackend *io_uring = IoUringBackend::Create();
+    if (io_uring != NULL) {
+      return io_uring;
+    }
+    utils::PrintLog("io_uring is not available, falling back to epoll");
+  }
+  return new EpollBackend();
+}
+
+// ========================================================================
+// EpollBackend
+
+EpollBackend::EpollBackend() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {
+  if (epfd_ < 0) {
+    utils::ErrExit("EpollBackend constructor");
+  }
+}
+
+EpollBackend::~EpollBackend() {
+  close(epfd_);
+}
+
+Result<void> EpollBackend::Add(FdEvent *fde, uint32_t events) {
+  epoll_event epev;
+  epev.events = events;
+  epev.data.ptr = fde;
+  if (epoll_ctl(epfd_, EPOLL_CTL_ADD, fde->fd, &epev) < 0) {
+    return Error();
+  }
+  return Result<void>();
+}
+
+Result<void> EpollBackend::Modify(FdEvent *fde, uint32_t events) {
+  epoll_event epev;
+  epev.events = events;
+  epev.data.ptr = fde;
+  if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fde->fd, &epev) < 0) {
+    return Error();
+  }
+  return Result<void>();
+}
+
+Result<void> EpollBackend::Remove(FdEvent *fde) {
+  if (epoll_ctl(epfd_, EPOLL_CTL_DEL, fde->fd, NULL) < 0) {
+    return Error();
+  }
+  return Result<void>();
+}
+
+Result<int> EpollBackend::Wait(epoll_event *events, int max_events,
+                               int timeout_ms) {
+  int event_num = epoll_wait(epfd_, events, max_events, timeout_ms);
+  if (event_num < 0) {
+    return Error();
+  }
+  return event_num;
+}
+
+const char *EpollBackend::GetName() const {
+  return "epoll";
+}
+
+}  // namespace server
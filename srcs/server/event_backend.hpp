@@ -0,0 +1,90 @@
+#ifndef SERVER_EVENT_BACKEND_HPP_
+#define SERVER_EVENT_BACKEND_HPP_
+
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+
+#include "config/config.hpp"
+#include "result/result.hpp"
+
+namespace server {
+using namespace result;
+
+struct FdEvent;
+
+// Epoll が fd の監視に使う仕組みのインターフェース｡
+//
+// events は EPOLLIN などの epoll(7) のイベントで､EPOLLET を含むことがある｡
+// (EPOLLIN, EPOLLOUT などは poll(2) の POLLIN, POLLOUT と同じ値である)
+//
+// Read(), Writev() などは fde->is_stream な fd の読み書きに使う｡
+// デフォルトではそのままシステムコールを呼ぶが､backend によっては
+// 読み書きをイベント待ちとまとめて行う｡
+class EventBackend {
+ public:
+  virtual ~EventBackend();
+
+  // fde->fd の監視を開始する
+  virtual Result<void> Add(FdEvent *fde, uint32_t events) = 0;
+
+  // 監視するイベントを変更する｡
+  // events が前回と同じでも､既に発生しているイベントを再度通知させる｡
+  virtual Result<void> Modify(FdEvent *fde, uint32_t events) = 0;
+
+  // fde->fd の監視を終了する
+  virtual Result<void> Remove(FdEvent *fde) = 0;
+
+  // epoll_wait(2) と同様にイベントを待ち､発生したイベントの数を返す｡
+  // epoll_event.data.ptr には FdEvent* が入る｡
+  virtual Result<int> Wait(epoll_event *events, int max_events,
+                           int timeout_ms) = 0;
+
+  virtual const char *GetName() const = 0;
+
+  // read(2) と同様に読み込む｡ EOF なら0を返す｡
+  virtual Result<size_t> Read(FdEvent *fde, void *buf, size_t size);
+
+  // utils::OutputSink::Writev(), SendFile() と同様に書き込む
+  virtual Result<size_t> Writev(FdEvent *fde, const iovec *iov, int iov_num,
+                                bool has_more);
+  virtual Result<size_t> SendFile(FdEvent *fde, int in_fd, off_t offset,
+                                  size_t size);
+
+  // shutdown(2) で送受信を止める｡
+  // 書き込んだデータを送り終えていなければ送り終えてから止める｡
+  virtual Result<void> ShutDown(FdEvent *fde);
+};
+
+// backend を作成する｡
+// io_uring が使えない環境では epoll にフォールバックする｡
+EventBackend *CreateEventBackend(config::Config::EventBackend backend);
+
+// epoll(7) を使うバックエンド
+class EpollBackend : public EventBackend {
+ private:
+  const int epfd_;
+
+ public:
+  EpollBackend();
+  virtual ~EpollBackend();
+
+  virtual Result<void> Add(FdEvent *fde, uint32_t events);
+  virtual Result<void> Modify(FdEvent *fde, uint32_t events);
+  virtual Result<void> Remove(FdEvent *fde);
+  virtual Result<int> Wait(epoll_event *events, int max_events,
+                           int timeout_ms);
+  virtual const char *GetName() const;
+
+ private:
+  // epoll instance が片方のみでcloseされるのを防ぐためコピー操作は禁止
+  EpollBackend(const EpollBackend &rhs);
+  EpollBackend &operator=(const EpollBackend &rhs);
+};
+
+}  // namespace server
+
+#endif
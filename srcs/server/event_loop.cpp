@@ -1,29 +1,37 @@
 #include "server/event_loop.hpp"
 
+#include <cerrno>
+
 #include "config/config.hpp"
 #include "server/epoll.hpp"
+#include "server/stats.hpp"
 #include "utils/error.hpp"
 #include "utils/inet_sockets.hpp"
 
 namespace server {
 
 int StartEventLoop(Epoll &epoll) {
+  // ループ毎に確保しないように使い回す
+  std::vector<FdEventEvent> fdees;
+
   // イベントループ
   while (1) {
-    std::vector<FdEventEvent> timeouts = epoll.RetrieveTimeouts();
-    for (std::vector<FdEventEvent>::const_iterator it = timeouts.begin();
-         it != timeouts.end(); ++it) {
+    epoll.RetrieveTimeouts(fdees);
+    for (std::vector<FdEventEvent>::const_iterator it = fdees.begin();
+         it != fdees.end(); ++it) {
       FdEvent *fde = it->fde;
       unsigned int events = it->events;
       InvokeFdEvent(fde, events, &epoll);
     }
 
-    Result<std::vector<FdEventEvent> > result = epoll.WaitEvents(100);
-    if (result.IsErr()) {
+    // 次のタイムアウトまで待つ｡ タイムアウトがなければイベントが来るまで待つ｡
+    // シグナルで中断された場合は fdees は空になる
+    if (epoll.WaitEvents(fdees, epoll.GetWaitTimeoutMs()).IsErr() &&
+        errno != EINTR) {
       utils::ErrExit("WaitEvents");
     }
+    DumpStatsIfRequested();
 
-    std::vector<FdEventEvent> fdees = result.Ok();
     for (std::vector<FdEventEvent>::const_iterator it = fdees.begin();
          it != fdees.end(); ++it) {
       FdEvent *fde = it->fde;
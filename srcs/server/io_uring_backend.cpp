@@ -0,0 +1,910 @@
+#include "server/io_uring_backend.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "server/epoll.hpp"
+
+namespace server {
+
+namespace {
+
+int IoUringSetup(unsigned int entries, io_uring_params *params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IoUringEnter(int ring_fd, unsigned int to_submit,
+                 unsigned int min_complete, unsigned int flags, void *arg,
+                 size_t arg_size) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                 arg, arg_size);
+}
+
+int IoUringRegister(int ring_fd, unsigned int opcode, void *arg,
+                    unsigned int nr_args) {
+  return syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+// user_data の上位2ビットに SQE の種類を入れる
+const int kOpTypeShift = 62;
+const uint64_t kOpTypeMask = static_cast<uint64_t>(3) << kOpTypeShift;
+
+}  // namespace
+
+IoUringBackend::Stream::Stream(int fd)
+    : fd(fd),
+      is_recv_submitted(false),
+      is_waiting_buffer(false),
+      recv_buffer_id(-1),
+      recv_offset(0),
+      recv_size(0),
+      recv_stash(),
+      is_eof(false),
+      send_inflight(),
+      send_offset(0),
+      is_send_submitted(false),
+      send_pending(),
+      should_shutdown(false),
+      error(0),
+      is_check_scheduled(false),
+      is_orphan(false) {}
+
+IoUringBackend *IoUringBackend::Create() {
+  IoUringBackend *backend = new IoUringBackend();
+  if (!backend->Setup()) {
+    delete backend;
+    return NULL;
+  }
+  return backend;
+}
+
+IoUringBackend::IoUringBackend()
+    : ring_fd_(-1),
+      features_(0),
+      ring_(NULL),
+      ring_size_(0),
+      sqes_(NULL),
+      sqes_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      sq_array_(NULL),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cqes_(NULL),
+      recv_buffer_ring_(NULL),
+      recv_buffer_ring_size_(0),
+      recv_buffers_(NULL),
+      recv_buffer_tail_(0),
+      poll_states_(),
+      arm_fds_(),
+      check_fds_(),
+      checking_fds_(),
+      waiting_buffer_fds_(),
+      orphans_(),
+      send_timeout_(),
+      wait_round_(0) {
+  send_timeout_.tv_sec = kSendTimeoutMs / 1000;
+  send_timeout_.tv_nsec = (kSendTimeoutMs % 1000) * 1000000L;
+}
+
+IoUringBackend::~IoUringBackend() {
+  // 受信･送信中の領域を解放する前にリングを閉じて取り消させる
+  if (ring_fd_ >= 0) {
+    close(ring_fd_);
+  }
+  if (sqes_ != NULL) {
+    munmap(sqes_, sqes_size_);
+  }
+  if (ring_ != NULL) {
+    munmap(ring_, ring_size_);
+  }
+  if (recv_buffer_ring_ != NULL) {
+    munmap(recv_buffer_ring_, recv_buffer_ring_size_);
+  }
+  delete[] recv_buffers_;
+  for (std::vector<PollState>::iterator it = poll_states_.begin();
+       it != poll_states_.end(); ++it) {
+    delete it->stream;
+  }
+  for (std::set<Stream *>::iterator it = orphans_.begin();
+       it != orphans_.end(); ++it) {
+    if ((*it)->fd >= 0) {
+      close((*it)->fd);
+    }
+    delete *it;
+  }
+}
+
+bool IoUringBackend::Setup() {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = kCqEntries;
+  ring_fd_ = IoUringSetup(kSqEntries, &params);
+  if (ring_fd_ < 0) {
+    return false;
+  }
+
+  // EXT_ARG: タイムアウト付きで待つのに使う
+  // RSRC_TAGS: IORING_POLL_ADD_MULTI と同じ 5.13 で入ったので目安として使う
+  const uint32_t kRequiredFeatures = IORING_FEAT_SINGLE_MMAP |
+                                     IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG |
+                                     IORING_FEAT_RSRC_TAGS;
+  features_ = params.features;
+  if ((features_ & kRequiredFeatures) != kRequiredFeatures) {
+    return false;
+  }
+
+  size_t sq_ring_size =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  size_t cq_ring_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  ring_size_ = sq_ring_size > cq_ring_size ? sq_ring_size : cq_ring_size;
+  void *ring = mmap(NULL, ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (ring == MAP_FAILED) {
+    return false;
+  }
+  ring_ = ring;
+
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = reinterpret_cast<io_uring_sqe *>(sqes);
+
+  char *base = reinterpret_cast<char *>(ring_);
+  sq_head_ = reinterpret_cast<unsigned int *>(base + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned int *>(base + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned int *>(base + params.sq_off.ring_mask);
+  sq_entries_ =
+      *reinterpret_cast<unsigned int *>(base + params.sq_off.ring_entries);
+  sq_array_ = reinterpret_cast<unsigned int *>(base + params.sq_off.array);
+  cq_head_ = reinterpret_cast<unsigned int *>(base + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned int *>(base + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned int *>(base + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe *>(base + params.cq_off.cqes);
+
+  // provided buffer ring が使えなくても POLL_ADD で監視できる
+  SetupRecvBuffers();
+  return true;
+}
+
+bool IoUringBackend::SetupRecvBuffers() {
+  recv_buffer_ring_size_ = kRecvBufferNum * sizeof(io_uring_buf);
+  void *buffer_ring = mmap(NULL, recv_buffer_ring_size_, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (buffer_ring == MAP_FAILED) {
+    return false;
+  }
+
+  io_uring_buf_reg reg;
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr = reinterpret_cast<uint64_t>(buffer_ring);
+  reg.ring_entries = kRecvBufferNum;
+  reg.bgid = kRecvBufferGroup;
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+    munmap(buffer_ring, recv_buffer_ring_size_);
+    return false;
+  }
+  recv_buffer_ring_ = reinterpret_cast<io_uring_buf *>(buffer_ring);
+  recv_buffers_ = new utils::Byte[kRecvBufferNum * kRecvBufferSize];
+  for (unsigned int i = 0; i < kRecvBufferNum; ++i) {
+    RecycleRecvBuffer(i);
+  }
+  return true;
+}
+
+Result<void> IoUringBackend::Add(FdEvent *fde, uint32_t events) {
+  PollState &state = GetPollState(fde->fd);
+  if (state.fde != NULL) {
+    errno = EEXIST;
+    return Error();
+  }
+  state.fde = fde;
+  state.events = events;
+  state.is_armed = false;
+  ++state.generation;
+  if (fde->is_stream && recv_buffer_ring_ != NULL) {
+    state.stream = new Stream(fde->fd);
+    ScheduleCheck(fde->fd);
+  }
+  ScheduleArm(fde->fd);
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::Modify(FdEvent *fde, uint32_t events) {
+  PollState &state = GetPollState(fde->fd);
+  if (state.fde != fde) {
+    errno = ENOENT;
+    return Error();
+  }
+  if (state.stream != NULL) {
+    state.events = events;
+    // 読み込みを止めている間も provided buffer を持ち続けないようにする
+    if (!(events & EPOLLIN)) {
+      StashRecvBuffer(*state.stream);
+    }
+    // 既に読み書きできる状態なら次の Wait() で通知する
+    ScheduleArm(fde->fd);
+    ScheduleCheck(fde->fd);
+    return Result<void>();
+  }
+  if (state.is_armed && Disarm(fde->fd).IsErr()) {
+    return Error();
+  }
+  state.events = events;
+  ScheduleArm(fde->fd);
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::Remove(FdEvent *fde) {
+  PollState &state = GetPollState(fde->fd);
+  if (state.fde != fde) {
+    errno = ENOENT;
+    return Error();
+  }
+  if (state.is_armed && Disarm(fde->fd).IsErr()) {
+    return Error();
+  }
+  Stream *stream = state.stream;
+  bool is_cancel_failed = false;
+  if (stream != NULL && stream->is_recv_submitted) {
+    // RECV の CQE は generation が変わるので領域を返すだけになる
+    is_cancel_failed =
+        PushCancel(ToUserData(kRecvOp, fde->fd, state.generation)).IsErr();
+  }
+  state.fde = NULL;
+  state.events = 0;
+  state.stream = NULL;
+  ++state.generation;
+  if (stream == NULL) {
+    return Result<void>();
+  }
+
+  if (stream->recv_buffer_id >= 0) {
+    RecycleRecvBuffer(stream->recv_buffer_id);
+    stream->recv_buffer_id = -1;
+  }
+  stream->recv_stash.clear();
+  stream->is_orphan = true;
+  stream->fd = -1;
+  bool has_unsent_data =
+      !stream->send_inflight.empty() || !stream->send_pending.empty();
+  if (stream->error == 0 && has_unsent_data) {
+    // 呼び出し元がこの後 close() するので､送り終えるまで fd を複製して持つ｡
+    // (epoll で書き込んだデータが close() した後も送られるのと同じにする)
+    stream->fd = fcntl(fde->fd, F_DUPFD_CLOEXEC, 0);
+    if (stream->fd < 0) {
+      stream->error = errno;
+    }
+  }
+  orphans_.insert(stream);
+  ContinueOrphan(stream);
+  if (is_cancel_failed) {
+    return Error();
+  }
+  return Result<void>();
+}
+
+Result<int> IoUringBackend::Wait(epoll_event *events, int max_events,
+                                 int timeout_ms) {
+  ++wait_round_;
+
+  // 前回通知した fd などを登録し直し､受信･送信を submit する
+  for (std::vector<int>::const_iterator it = arm_fds_.begin();
+       it != arm_fds_.end(); ++it) {
+    PollState &state = poll_states_[*it];
+    if (state.fde == NULL) {
+      continue;
+    }
+    if (state.stream != NULL) {
+      if (SubmitStream(*it, state).IsErr()) {
+        return Error();
+      }
+    } else if (!state.is_armed) {
+      if (PushPollAdd(*it).IsErr()) {
+        return Error();
+      }
+    }
+  }
+  arm_fds_.clear();
+
+  // CQ に既にイベントがあるか､既に読み書きできる Stream があれば
+  // 待たずに submit だけする
+  bool has_cqe = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) != *cq_head_;
+  bool has_ready_stream = false;
+  for (std::vector<int>::const_iterator it = check_fds_.begin();
+       it != check_fds_.end() && !has_ready_stream; ++it) {
+    const PollState &state = poll_states_[*it];
+    has_ready_stream = state.fde != NULL && state.stream != NULL &&
+                       GetStreamEvents(state) != 0;
+  }
+  bool should_wait = !has_cqe && !has_ready_stream && timeout_ms != 0;
+  if (Enter(should_wait ? 1 : 0, timeout_ms).IsErr()) {
+    return Error();
+  }
+
+  unsigned int head = *cq_head_;
+  unsigned int tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  int event_num = 0;
+  while (head != tail && event_num < max_events) {
+    const io_uring_cqe &cqe = cqes_[head & cq_mask_];
+    ++head;
+    if (cqe.user_data == kIgnoreUserData) {
+      continue;
+    }
+    OpType op = static_cast<OpType>(cqe.user_data >> kOpTypeShift);
+    if (op == kRecvOp) {
+      CompleteRecv(cqe);
+      continue;
+    }
+    if (op == kSendOp) {
+      CompleteSend(cqe);
+      continue;
+    }
+    int fd = static_cast<int>(cqe.user_data >> 32);
+    uint32_t generation = static_cast<uint32_t>(cqe.user_data);
+    if (static_cast<size_t>(fd) >= poll_states_.size()) {
+      continue;
+    }
+    PollState &state = poll_states_[fd];
+    if (state.fde == NULL || state.generation != generation) {
+      // 監視を変更･解除する前の POLL_ADD の結果
+      continue;
+    }
+    if (!(cqe.flags & IORING_CQE_F_MORE)) {
+      // 1回だけの POLL_ADD か､multishot が終了した
+      state.is_armed = false;
+      ScheduleArm(fd);
+    }
+
+    uint32_t revents = cqe.res < 0 ? EPOLLERR : static_cast<uint32_t>(cqe.res);
+    AddEvent(state, revents, events, event_num);
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+  // CQE が来たか Modify() された Stream の状態からイベントを作る
+  checking_fds_.swap(check_fds_);
+  for (std::vector<int>::const_iterator it = checking_fds_.begin();
+       it != checking_fds_.end(); ++it) {
+    PollState &state = poll_states_[*it];
+    if (state.fde == NULL || state.stream == NULL) {
+      continue;
+    }
+    state.stream->is_check_scheduled = false;
+    uint32_t revents = GetStreamEvents(state);
+    if (revents == 0) {
+      continue;
+    }
+    if (event_num >= max_events) {
+      ScheduleCheck(*it);
+      continue;
+    }
+    AddEvent(state, revents, events, event_num);
+    // レベルトリガーでは読み書きできなくなるまで通知し続ける
+    if (!(state.events & EPOLLET)) {
+      ScheduleCheck(*it);
+    }
+  }
+  checking_fds_.clear();
+  return event_num;
+}
+
+const char *IoUringBackend::GetName() const {
+  return "io_uring";
+}
+
+Result<size_t> IoUringBackend::Read(FdEvent *fde, void *buf, size_t size) {
+  Stream *stream = GetStream(fde);
+  if (stream == NULL) {
+    return EventBackend::Read(fde, buf, size);
+  }
+
+  if (!stream->recv_stash.empty()) {
+    size_t read_size =
+        size < stream->recv_stash.size() ? size : stream->recv_stash.size();
+    memcpy(buf, stream->recv_stash.data(), read_size);
+    stream->recv_stash.EraseHead(read_size);
+    return read_size;
+  }
+  if (stream->recv_buffer_id >= 0) {
+    size_t rest = stream->recv_size - stream->recv_offset;
+    size_t read_size = size < rest ? size : rest;
+    memcpy(buf,
+           recv_buffers_ + stream->recv_buffer_id * kRecvBufferSize +
+               stream->recv_offset,
+           read_size);
+    stream->recv_offset += read_size;
+    if (stream->recv_offset == stream->recv_size) {
+      // 読み終えたので領域を返し､次の Wait() で RECV を submit する
+      RecycleRecvBuffer(stream->recv_buffer_id);
+      stream->recv_buffer_id = -1;
+      ScheduleArm(fde->fd);
+    }
+    return read_size;
+  }
+  if (stream->error != 0) {
+    errno = stream->error;
+    return Error();
+  }
+  if (stream->is_eof) {
+    return static_cast<size_t>(0);
+  }
+  errno = EAGAIN;
+  return Error();
+}
+
+Result<size_t> IoUringBackend::Writev(FdEvent *fde, const iovec *iov,
+                                      int iov_num, bool has_more) {
+  Stream *stream = GetStream(fde);
+  if (stream == NULL) {
+    return EventBackend::Writev(fde, iov, iov_num, has_more);
+  }
+
+  if (stream->error != 0) {
+    errno = stream->error;
+    return Error();
+  }
+  if (stream->should_shutdown) {
+    errno = EPIPE;
+    return Error();
+  }
+  // 送信キューにためて次の Wait() でまとめて送るので has_more は見なくて良い
+  size_t queued_size = stream->send_pending.size();
+  if (queued_size >= kMaxSendQueueSize) {
+    errno = EAGAIN;
+    return Error();
+  }
+  size_t room = kMaxSendQueueSize - queued_size;
+  size_t total = 0;
+  for (int i = 0; i < iov_num && total < room; ++i) {
+    size_t len = iov[i].iov_len < room - total ? iov[i].iov_len : room - total;
+    stream->send_pending.AppendDataToBuffer(
+        reinterpret_cast<const utils::Byte *>(iov[i].iov_base), len);
+    total += len;
+  }
+  // 送信中なら CQE が来た時に続きを送る
+  if (queued_size == 0 && !stream->is_send_submitted) {
+    ScheduleArm(fde->fd);
+  }
+  return total;
+}
+
+Result<size_t> IoUringBackend::SendFile(FdEvent *fde, int in_fd, off_t offset,
+                                        size_t size) {
+  if (GetStream(fde) == NULL) {
+    return EventBackend::SendFile(fde, in_fd, offset, size);
+  }
+  // 送信キューを通すので sendfile(2) は使えない｡
+  // 呼び出し元はファイルを読み込んでから Writev() する｡
+  errno = EINVAL;
+  return Error();
+}
+
+Result<void> IoUringBackend::ShutDown(FdEvent *fde) {
+  Stream *stream = GetStream(fde);
+  if (stream == NULL) {
+    return EventBackend::ShutDown(fde);
+  }
+  if (stream->is_send_submitted || !stream->send_inflight.empty() ||
+      !stream->send_pending.empty()) {
+    // 送信キューが空になったら shutdown(2) する
+    stream->should_shutdown = true;
+    return Result<void>();
+  }
+  return EventBackend::ShutDown(fde);
+}
+
+IoUringBackend::PollState &IoUringBackend::GetPollState(int fd) {
+  if (static_cast<size_t>(fd) >= poll_states_.size()) {
+    PollState state;
+    state.fde = NULL;
+    state.events = 0;
+    state.is_armed = false;
+    state.generation = 0;
+    state.wait_index = 0;
+    state.wait_round = 0;
+    state.stream = NULL;
+    poll_states_.resize(fd + 1, state);
+  }
+  return poll_states_[fd];
+}
+
+IoUringBackend::Stream *IoUringBackend::GetStream(FdEvent *fde) {
+  if (static_cast<size_t>(fde->fd) >= poll_states_.size()) {
+    return NULL;
+  }
+  const PollState &state = poll_states_[fde->fd];
+  return state.fde == fde ? state.stream : NULL;
+}
+
+void IoUringBackend::ScheduleArm(int fd) {
+  arm_fds_.push_back(fd);
+}
+
+Result<void> IoUringBackend::Disarm(int fd) {
+  PollState &state = poll_states_[fd];
+  if (PushPollRemove(ToUserData(kPollOp, fd, state.generation)).IsErr()) {
+    return Error();
+  }
+  state.is_armed = false;
+  ++state.generation;
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::PushPollAdd(int fd) {
+  PollState &state = poll_states_[fd];
+  io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_POLL_ADD;
+  sqe.fd = fd;
+  sqe.poll32_events = state.events & ~static_cast<uint32_t>(EPOLLET);
+  if (state.events & EPOLLET) {
+    sqe.len = IORING_POLL_ADD_MULTI;
+  }
+  sqe.user_data = ToUserData(kPollOp, fd, state.generation);
+  if (PushSqe(sqe).IsErr()) {
+    return Error();
+  }
+  state.is_armed = true;
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::PushPollRemove(uint64_t target_user_data) {
+  io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_POLL_REMOVE;
+  sqe.fd = -1;
+  sqe.addr = target_user_data;
+  sqe.user_data = kIgnoreUserData;
+  if (features_ & IORING_FEAT_CQE_SKIP) {
+    // 成功した場合は CQE を作らない
+    sqe.flags |= IOSQE_CQE_SKIP_SUCCESS;
+  }
+  return PushSqe(sqe);
+}
+
+Result<void> IoUringBackend::PushCancel(uint64_t target_user_data) {
+  io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_ASYNC_CANCEL;
+  sqe.fd = -1;
+  sqe.addr = target_user_data;
+  sqe.user_data = kIgnoreUserData;
+  if (features_ & IORING_FEAT_CQE_SKIP) {
+    sqe.flags |= IOSQE_CQE_SKIP_SUCCESS;
+  }
+  return PushSqe(sqe);
+}
+
+Result<void> IoUringBackend::SubmitStream(int fd, const PollState &state) {
+  Stream &stream = *state.stream;
+  if ((state.events & EPOLLIN) && !stream.is_recv_submitted &&
+      !stream.is_waiting_buffer && stream.recv_buffer_id < 0 &&
+      stream.recv_stash.empty() && !stream.is_eof && stream.error == 0) {
+    if (PushRecv(fd, state.generation, stream).IsErr()) {
+      return Error();
+    }
+  }
+  if (stream.is_send_submitted || stream.error != 0) {
+    return Result<void>();
+  }
+  if (!stream.send_inflight.empty() || !stream.send_pending.empty()) {
+    return PushSend(stream);
+  }
+  if (stream.should_shutdown) {
+    // 送り終えたので送受信を止める｡ 受信中の RECV は EOF で終わる｡
+    stream.should_shutdown = false;
+    if (shutdown(fd, SHUT_RDWR) < 0) {
+      stream.error = errno;
+      ScheduleCheck(fd);
+    }
+  }
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::PushRecv(int fd, uint32_t generation,
+                                      Stream &stream) {
+  io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_RECV;
+  sqe.fd = fd;
+  // 届いたデータの大きさに関係なく provided buffer の領域を1つ使う
+  sqe.flags = IOSQE_BUFFER_SELECT;
+  sqe.buf_group = kRecvBufferGroup;
+  sqe.user_data = ToUserData(kRecvOp, fd, generation);
+  if (PushSqe(sqe).IsErr()) {
+    return Error();
+  }
+  stream.is_recv_submitted = true;
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::PushSend(Stream &stream) {
+  if (stream.send_inflight.empty()) {
+    stream.send_inflight.swap(stream.send_pending);
+    stream.send_offset = 0;
+  }
+  // SEND と LINK_TIMEOUT は同じ submit に入れないといけない
+  if (ReserveSqes(2).IsErr()) {
+    return Error();
+  }
+
+  io_uring_sqe sqe;
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_SEND;
+  sqe.fd = stream.fd;
+  sqe.addr = reinterpret_cast<uint64_t>(stream.send_inflight.data() +
+                                        stream.send_offset);
+  sqe.len = stream.send_inflight.size() - stream.send_offset;
+  sqe.msg_flags = MSG_NOSIGNAL;
+  sqe.flags = IOSQE_IO_LINK;
+  sqe.user_data = ToUserData(&stream);
+  if (PushSqe(sqe).IsErr()) {
+    return Error();
+  }
+
+  memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = IORING_OP_LINK_TIMEOUT;
+  sqe.fd = -1;
+  sqe.addr = reinterpret_cast<uint64_t>(&send_timeout_);
+  sqe.len = 1;
+  sqe.user_data = kIgnoreUserData;
+  if (PushSqe(sqe).IsErr()) {
+    return Error();
+  }
+  stream.is_send_submitted = true;
+  return Result<void>();
+}
+
+void IoUringBackend::CompleteRecv(const io_uring_cqe &cqe) {
+  int fd = static_cast<int>((cqe.user_data & ~kOpTypeMask) >> 32);
+  uint32_t generation = static_cast<uint32_t>(cqe.user_data);
+  bool has_buffer = cqe.flags & IORING_CQE_F_BUFFER;
+  int buffer_id = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+
+  PollState *state = static_cast<size_t>(fd) < poll_states_.size()
+                         ? &poll_states_[fd]
+                         : NULL;
+  if (state == NULL || state->stream == NULL ||
+      state->generation != generation) {
+    // 監視を解除する前の RECV の結果｡ 領域だけ返す｡
+    if (has_buffer) {
+      RecycleRecvBuffer(buffer_id);
+    }
+    return;
+  }
+
+  Stream &stream = *state->stream;
+  stream.is_recv_submitted = false;
+  if (cqe.res > 0 && has_buffer) {
+    stream.recv_buffer_id = buffer_id;
+    stream.recv_offset = 0;
+    stream.recv_size = cqe.res;
+    if (!(state->events & EPOLLIN)) {
+      StashRecvBuffer(stream);
+    }
+  } else {
+    if (has_buffer) {
+      RecycleRecvBuffer(buffer_id);
+    }
+    if (cqe.res == 0) {
+      stream.is_eof = true;
+    } else if (cqe.res == -ENOBUFS) {
+      // 領域が返されたら submit し直す
+      stream.is_waiting_buffer = true;
+      waiting_buffer_fds_.push_back(fd);
+    } else if (cqe.res == -EINTR || cqe.res == -EAGAIN) {
+      ScheduleArm(fd);
+    } else {
+      stream.error = -cqe.res;
+    }
+  }
+  ScheduleCheck(fd);
+}
+
+void IoUringBackend::CompleteSend(const io_uring_cqe &cqe) {
+  Stream *stream = reinterpret_cast<Stream *>(
+      static_cast<uintptr_t>(cqe.user_data & ~kOpTypeMask));
+  stream->is_send_submitted = false;
+  if (cqe.res >= 0) {
+    // 一部しか送れなかった場合は残りを次の SEND で送る
+    stream->send_offset += cqe.res;
+    if (stream->send_offset >= stream->send_inflight.size()) {
+      stream->send_inflight.clear();
+      stream->send_offset = 0;
+    }
+  } else if (cqe.res != -EINTR && cqe.res != -EAGAIN) {
+    // LINK_TIMEOUT で取り消された場合は -ECANCELED になる
+    stream->error = cqe.res == -ECANCELED ? ETIMEDOUT : -cqe.res;
+    stream->send_inflight.clear();
+    stream->send_pending.clear();
+    stream->send_offset = 0;
+  }
+
+  if (stream->is_orphan) {
+    ContinueOrphan(stream);
+    return;
+  }
+  ScheduleArm(stream->fd);
+  ScheduleCheck(stream->fd);
+}
+
+void IoUringBackend::ContinueOrphan(Stream *stream) {
+  if (stream->is_send_submitted) {
+    return;
+  }
+  if (stream->error == 0 && (!stream->send_inflight.empty() ||
+                             !stream->send_pending.empty())) {
+    // dup(2) した fd はこちらで持っているのですぐに積んで良い
+    if (PushSend(*stream).IsOk()) {
+      return;
+    }
+  }
+  if (stream->fd >= 0) {
+    close(stream->fd);
+  }
+  orphans_.erase(stream);
+  delete stream;
+}
+
+uint32_t IoUringBackend::GetStreamEvents(const PollState &state) {
+  const Stream &stream = *state.stream;
+  uint32_t revents = 0;
+  if (stream.recv_buffer_id >= 0 || !stream.recv_stash.empty() ||
+      stream.is_eof) {
+    revents |= EPOLLIN;
+  }
+  if (stream.is_eof) {
+    revents |= EPOLLRDHUP;
+  }
+  if (stream.error != 0) {
+    revents |= EPOLLIN | EPOLLERR;
+  } else if (!stream.should_shutdown &&
+             stream.send_pending.size() < kMaxSendQueueSize) {
+    revents |= EPOLLOUT;
+  }
+  // epoll と同じく EPOLLERR, EPOLLHUP は常に通知する
+  return revents & (state.events | EPOLLERR | EPOLLHUP);
+}
+
+void IoUringBackend::ScheduleCheck(int fd) {
+  Stream *stream = poll_states_[fd].stream;
+  if (stream == NULL || stream->is_check_scheduled) {
+    return;
+  }
+  stream->is_check_scheduled = true;
+  check_fds_.push_back(fd);
+}
+
+void IoUringBackend::AddEvent(PollState &state, uint32_t revents,
+                              epoll_event *events, int &event_num) {
+  if (state.wait_round == wait_round_) {
+    // 同じ fd の CQE は1つのイベントにまとめる
+    events[state.wait_index].events |= revents;
+    return;
+  }
+  state.wait_round = wait_round_;
+  state.wait_index = event_num;
+  events[event_num].events = revents;
+  events[event_num].data.ptr = state.fde;
+  ++event_num;
+}
+
+void IoUringBackend::RecycleRecvBuffer(int buffer_id) {
+  io_uring_buf &buf =
+      recv_buffer_ring_[recv_buffer_tail_ & (kRecvBufferNum - 1)];
+  buf.addr = reinterpret_cast<uint64_t>(recv_buffers_ +
+                                        buffer_id * kRecvBufferSize);
+  buf.len = kRecvBufferSize;
+  buf.bid = buffer_id;
+  ++recv_buffer_tail_;
+  // リングの tail は先頭の要素の resv に重ねて置かれている
+  __atomic_store_n(&recv_buffer_ring_[0].resv, recv_buffer_tail_,
+                   __ATOMIC_RELEASE);
+
+  // 領域が足りずに RECV できなかった fd は submit し直す
+  for (std::vector<int>::const_iterator it = waiting_buffer_fds_.begin();
+       it != waiting_buffer_fds_.end(); ++it) {
+    Stream *stream = poll_states_[*it].stream;
+    if (stream != NULL && stream->is_waiting_buffer) {
+      stream->is_waiting_buffer = false;
+      ScheduleArm(*it);
+    }
+  }
+  waiting_buffer_fds_.clear();
+}
+
+void IoUringBackend::StashRecvBuffer(Stream &stream) {
+  if (stream.recv_buffer_id < 0) {
+    return;
+  }
+  stream.recv_stash.AppendDataToBuffer(
+      recv_buffers_ + stream.recv_buffer_id * kRecvBufferSize +
+          stream.recv_offset,
+      stream.recv_size - stream.recv_offset);
+  RecycleRecvBuffer(stream.recv_buffer_id);
+  stream.recv_buffer_id = -1;
+}
+
+Result<void> IoUringBackend::ReserveSqes(unsigned int n) {
+  unsigned int tail = *sq_tail_;
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + n <= sq_entries_) {
+    return Result<void>();
+  }
+  // SQ が一杯なので待たずに submit する
+  if (Enter(0, 0).IsErr()) {
+    return Error();
+  }
+  // カーネルが SQE を一部しか取り出さなかった場合は空きがないままになる
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + n > sq_entries_) {
+    errno = EBUSY;
+    return Error();
+  }
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::PushSqe(const io_uring_sqe &sqe) {
+  if (ReserveSqes(1).IsErr()) {
+    return Error();
+  }
+  unsigned int tail = *sq_tail_;
+  unsigned int index = tail & sq_mask_;
+  sqes_[index] = sqe;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  return Result<void>();
+}
+
+Result<void> IoUringBackend::Enter(unsigned int min_complete, int timeout_ms) {
+  unsigned int to_submit =
+      *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  if (to_submit == 0 && min_complete == 0) {
+    return Result<void>();
+  }
+
+  unsigned int flags = 0;
+  io_uring_getevents_arg arg;
+  __kernel_timespec ts;
+  memset(&arg, 0, sizeof(arg));
+  if (min_complete > 0) {
+    flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    if (timeout_ms >= 0) {
+      ts.tv_sec = timeout_ms / 1000;
+      ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+      arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+  }
+
+  int ret = IoUringEnter(ring_fd_, to_submit, min_complete, flags,
+                         min_complete > 0 ? &arg : NULL,
+                         min_complete > 0 ? sizeof(arg) : 0);
+  if (ret < 0 && errno != ETIME) {
+    return Error();
+  }
+  return Result<void>();
+}
+
+uint64_t IoUringBackend::ToUserData(OpType op, int fd, uint32_t generation) {
+  return (static_cast<uint64_t>(op) << kOpTypeShift) |
+         (static_cast<uint64_t>(fd) << 32) | generation;
+}
+
+uint64_t IoUringBackend::ToUserData(Stream *stream) {
+  return (static_cast<uint64_t>(kSendOp) << kOpTypeShift) |
+         reinterpret_cast<uintptr_t>(stream);
+}
+
+}  // namespace server
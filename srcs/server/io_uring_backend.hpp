@@ -0,0 +1,255 @@
+#ifndef SERVER_IO_URING_BACKEND_HPP_
+#define SERVER_IO_URING_BACKEND_HPP_
+
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <stdint.h>
+
+#include <cstddef>
+#include <set>
+#include <vector>
+
+#include "server/event_backend.hpp"
+#include "utils/ByteBuffer.hpp"
+#include "utils/ByteVector.hpp"
+
+namespace server {
+
+// io_uring(7) を使うバックエンド｡
+//
+// fd の監視は IORING_OP_POLL_ADD で行い､監視の登録･変更･解除の SQE は
+// Wait() でイベント待ちと一緒に1回の io_uring_enter(2) でまとめて submit する｡
+// そのため epoll と違い､監視の変更ごとにシステムコールを呼ばない｡
+//
+// レベルトリガーでは1回だけ通知する POLL_ADD を使い､通知した fd は
+// 次の Wait() で登録し直す｡ (登録時に既に発生しているイベントは通知されるので
+// epoll のレベルトリガーと同じように振る舞う)
+// エッジトリガー(EPOLLET)では IORING_POLL_ADD_MULTI を使い､登録し直さない｡
+//
+// fde->is_stream な fd (接続ソケット) は POLL_ADD ではなく受信･送信自体を
+// submit し､Read(), Writev() はシステムコールを呼ばずに結果をやり取りする｡
+//   受信: provided buffer ring から領域を選ばせる IORING_OP_RECV を
+//         読み込みを監視している間1つ submit しておき､届いたデータを
+//         Read() でコピーしたら領域をリングに返す｡
+//   送信: Writev() でデータを送信キューにコピーし､Wait() で IORING_OP_SEND
+//         を submit する｡ 送信中に書き込まれたデータは次の SEND でまとめて送る｡
+//         SEND には IORING_OP_LINK_TIMEOUT を繋げ､送れないまま
+//         kSendTimeoutMs 経過したらエラーにする｡
+// 読み込み可能(受信したデータがある)･書き込み可能(送信キューに空きがある)の
+// 状態から EPOLLIN, EPOLLOUT を作って返す｡ レベルトリガーでは通知した fd の
+// 状態を次の Wait() でも確かめ､エッジトリガーでは CQE が来た時と
+// Modify() された時だけ確かめる｡
+// provided buffer ring が使えないカーネルでは接続ソケットも POLL_ADD で
+// 監視する｡
+//
+// liburing は使わず､システムコールを直接呼ぶ｡
+class IoUringBackend : public EventBackend {
+ private:
+  // 1回の submit でまとめられる SQE の数
+  static const unsigned int kSqEntries = 256;
+  // CQ のサイズ｡ あふれても IORING_FEAT_NODROP でカーネルが保持する｡
+  static const unsigned int kCqEntries = 4096;
+  // POLL_REMOVE など結果を見ない SQE の user_data
+  static const uint64_t kIgnoreUserData = ~static_cast<uint64_t>(0);
+
+  // 受信に使う領域の数とサイズ (provided buffer ring の要素数は2の冪)
+  static const unsigned int kRecvBufferNum = 256;
+  static const size_t kRecvBufferSize = 16 * 1024;
+  static const uint16_t kRecvBufferGroup = 0;
+  // fd ごとの送信キューの上限｡ これ以上は Writev() が EAGAIN を返す｡
+  static const size_t kMaxSendQueueSize = 256 * 1024;
+  // 1回の SEND が完了するまでの時間の上限
+  static const long kSendTimeoutMs = 30 * 1000;
+
+  // user_data の上位2ビットに入れる SQE の種類
+  enum OpType { kPollOp = 0, kRecvOp = 1, kSendOp = 2 };
+
+  // fde->is_stream な fd の受信･送信の状態
+  struct Stream {
+    // 監視を解除した後も送信を続ける場合は dup(2) した fd
+    int fd;
+
+    // RECV を submit 済みか
+    bool is_recv_submitted;
+    // 領域が足りずに RECV が失敗した｡ 領域が返されたら submit し直す｡
+    bool is_waiting_buffer;
+    // 受信したデータがある provided buffer の id (なければ -1)
+    int recv_buffer_id;
+    size_t recv_offset;
+    size_t recv_size;
+    // 読み込みの監視を止めた時に provided buffer から移したデータ
+    utils::ByteBuffer recv_stash;
+    bool is_eof;
+
+    // 送信中のデータと送信済みのバイト数
+    utils::ByteVector send_inflight;
+    size_t send_offset;
+    bool is_send_submitted;
+    // 次の SEND で送るデータ
+    utils::ByteVector send_pending;
+    // 送信キューが空になったら shutdown(2) する
+    bool should_shutdown;
+
+    // 受信･送信で起きたエラーの errno (なければ0)
+    int error;
+
+    // 次の Wait() で状態を確かめる fd に入っているか
+    bool is_check_scheduled;
+    // 監視を解除された後､残りのデータを送っている
+    bool is_orphan;
+
+    explicit Stream(int fd);
+  };
+
+  // fd ごとの監視の状態
+  struct PollState {
+    FdEvent *fde;
+    // 監視するイベント (EPOLLET を含む)
+    uint32_t events;
+    // POLL_ADD 済みか
+    bool is_armed;
+    // 登録し直すたびに増やす｡ user_data に入れ､古い CQE を無視するのに使う｡
+    uint32_t generation;
+    // Wait() で返すイベントの何番目に入れたか｡ (同じ fd の CQE をまとめる)
+    int wait_index;
+    unsigned int wait_round;
+    // fde->is_stream なら受信･送信の状態｡ それ以外は NULL｡
+    Stream *stream;
+  };
+
+  int ring_fd_;
+  uint32_t features_;
+
+  // mmap した SQ/CQ のリング (IORING_FEAT_SINGLE_MMAP で1つにまとめている)
+  void *ring_;
+  size_t ring_size_;
+  io_uring_sqe *sqes_;
+  size_t sqes_size_;
+
+  unsigned int *sq_head_;
+  unsigned int *sq_tail_;
+  unsigned int sq_mask_;
+  unsigned int sq_entries_;
+  unsigned int *sq_array_;
+  unsigned int *cq_head_;
+  unsigned int *cq_tail_;
+  unsigned int cq_mask_;
+  io_uring_cqe *cqes_;
+
+  // 受信に使う provided buffer ring と領域｡ 使えない場合は NULL｡
+  io_uring_buf *recv_buffer_ring_;
+  size_t recv_buffer_ring_size_;
+  utils::Byte *recv_buffers_;
+  uint16_t recv_buffer_tail_;
+
+  // poll_states_[<fd>]
+  std::vector<PollState> poll_states_;
+
+  // 次の Wait() で POLL_ADD する fd や､RECV, SEND を submit する fd
+  std::vector<int> arm_fds_;
+
+  // 次の Wait() で Stream の状態を確かめてイベントを返す fd
+  std::vector<int> check_fds_;
+  std::vector<int> checking_fds_;
+
+  // provided buffer が返されるのを待っている fd
+  std::vector<int> waiting_buffer_fds_;
+
+  // 監視を解除された後､残りのデータを送っている Stream
+  std::set<Stream *> orphans_;
+
+  // LINK_TIMEOUT に渡す時間｡ submit されるまで有効でないといけない｡
+  __kernel_timespec send_timeout_;
+
+  unsigned int wait_round_;
+
+ public:
+  // io_uring を使えない場合は NULL を返す
+  static IoUringBackend *Create();
+
+  virtual ~IoUringBackend();
+
+  virtual Result<void> Add(FdEvent *fde, uint32_t events);
+  virtual Result<void> Modify(FdEvent *fde, uint32_t events);
+  virtual Result<void> Remove(FdEvent *fde);
+  virtual Result<int> Wait(epoll_event *events, int max_events,
+                           int timeout_ms);
+  virtual const char *GetName() const;
+
+  virtual Result<size_t> Read(FdEvent *fde, void *buf, size_t size);
+  virtual Result<size_t> Writev(FdEvent *fde, const iovec *iov, int iov_num,
+                                bool has_more);
+  virtual Result<size_t> SendFile(FdEvent *fde, int in_fd, off_t offset,
+                                  size_t size);
+  virtual Result<void> ShutDown(FdEvent *fde);
+
+ private:
+  IoUringBackend();
+  IoUringBackend(const IoUringBackend &rhs);
+  IoUringBackend &operator=(const IoUringBackend &rhs);
+
+  bool Setup();
+
+  // provided buffer ring を登録する｡ 使えなければ false を返す｡
+  bool SetupRecvBuffers();
+
+  PollState &GetPollState(int fd);
+
+  // fde が Stream として登録されていれば返す
+  Stream *GetStream(FdEvent *fde);
+
+  // 次の Wait() で POLL_ADD するか､RECV, SEND を submit するようにする
+  void ScheduleArm(int fd);
+
+  // 登録済みの POLL_ADD を取り消す
+  Result<void> Disarm(int fd);
+
+  Result<void> PushPollAdd(int fd);
+  Result<void> PushPollRemove(uint64_t target_user_data);
+  Result<void> PushCancel(uint64_t target_user_data);
+
+  // 必要なら state.stream の RECV, SEND を submit する
+  Result<void> SubmitStream(int fd, const PollState &state);
+  Result<void> PushRecv(int fd, uint32_t generation, Stream &stream);
+  Result<void> PushSend(Stream &stream);
+
+  // CQE の結果を Stream に反映する
+  void CompleteRecv(const io_uring_cqe &cqe);
+  void CompleteSend(const io_uring_cqe &cqe);
+  // 監視を解除された Stream の残りのデータを送る｡
+  // 送り終えたか送信に失敗したら fd を閉じて delete する｡
+  void ContinueOrphan(Stream *stream);
+
+  // Stream が今通知するイベント
+  static uint32_t GetStreamEvents(const PollState &state);
+
+  // 次の Wait() で Stream の状態を確かめるようにする
+  void ScheduleCheck(int fd);
+
+  // Wait() で返すイベントに追加する｡ 同じ fd のイベントは1つにまとめる｡
+  void AddEvent(PollState &state, uint32_t revents, epoll_event *events,
+                int &event_num);
+
+  // provided buffer の領域をリングに返す
+  void RecycleRecvBuffer(int buffer_id);
+  // 受信したデータを provided buffer から recv_stash に移して領域を返す
+  void StashRecvBuffer(Stream &stream);
+
+  // SQ に n 個の空きを作る｡ SQ が一杯なら先に submit し､それでも空きが
+  // なければエラーを返す｡
+  Result<void> ReserveSqes(unsigned int n);
+
+  // sqe を SQ に積む｡ SQ が一杯なら先に submit し､それでも空きがなければ
+  // エラーを返す｡
+  Result<void> PushSqe(const io_uring_sqe &sqe);
+
+  // SQE を submit し､min_complete 個の CQE が来るか timeout_ms 経過するまで待つ
+  Result<void> Enter(unsigned int min_complete, int timeout_ms);
+
+  static uint64_t ToUserData(OpType op, int fd, uint32_t generation);
+  static uint64_t ToUserData(Stream *stream);
+};
+
+}  // namespace server
+
+#endif
@@ -0,0 +1,159 @@
+#include "server/loop_thread.hpp"
+
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "server/event_loop.hpp"
+#include "server/socket.hpp"
+#include "server/socket_event_handler.hpp"
+#include "utils/error.hpp"
+
+namespace server {
+
+// ========================================================================
+// LoopThread
+
+__thread LoopThread *LoopThread::current_ = NULL;
+
+LoopThread::LoopThread(int max_events, bool is_edge_triggered,
+                       config::Config::EventBackend backend)
+    : epoll_(max_events, is_edge_triggered, backend),
+      event_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      event_fde_(NULL),
+      queue_(),
+      received_(),
+      conn_num_(0),
+      thread_() {
+  if (event_fd_ < 0) {
+    utils::ErrExit("LoopThread eventfd");
+  }
+  pthread_mutex_init(&queue_mutex_, NULL);
+  event_fde_ = CreateFdEvent(event_fd_, HandleEventFd, this);
+  epoll_.Register(event_fde_);
+  epoll_.Add(event_fde_, kFdeRead);
+}
+
+LoopThread::~LoopThread() {
+  epoll_.Unregister(event_fde_);
+  delete event_fde_;
+  close(event_fd_);
+  pthread_mutex_destroy(&queue_mutex_);
+}
+
+Epoll &LoopThread::GetEpoll() {
+  return epoll_;
+}
+
+Result<void> LoopThread::Start() {
+  if (pthread_create(&thread_, NULL, ThreadMain, this) != 0) {
+    return Error("pthread_create");
+  }
+  pthread_detach(thread_);
+  return Result<void>();
+}
+
+void LoopThread::Run() {
+  current_ = this;
+  StartEventLoop(epoll_);
+}
+
+void LoopThread::Post(ConnSocket *conn_sock) {
+  pthread_mutex_lock(&queue_mutex_);
+  // キューが空でなければ既に通知済みなので eventfd に書き込まなくて良い
+  bool should_notify = queue_.empty();
+  queue_.push_back(conn_sock);
+  pthread_mutex_unlock(&queue_mutex_);
+
+  if (should_notify) {
+    uint64_t value = 1;
+    if (write(event_fd_, &value, sizeof(value)) < 0) {
+      utils::ErrExit("LoopThread::Post write");
+    }
+  }
+}
+
+long LoopThread::GetConnNum() const {
+  return __sync_fetch_and_add(const_cast<long *>(&conn_num_), 0);
+}
+
+void LoopThread::IncrementConnNum() {
+  __sync_fetch_and_add(&conn_num_, 1);
+}
+
+void LoopThread::DecrementConnNum() {
+  __sync_fetch_and_sub(&conn_num_, 1);
+}
+
+LoopThread *LoopThread::Current() {
+  return current_;
+}
+
+void *LoopThread::ThreadMain(void *arg) {
+  LoopThread *loop = reinterpret_cast<LoopThread *>(arg);
+  loop->Run();
+  return NULL;
+}
+
+void LoopThread::HandleEventFd(FdEvent *fde, unsigned int events, void *data,
+                               Epoll *epoll) {
+  LoopThread *loop = reinterpret_cast<LoopThread *>(data);
+  if (!(events & kFdeRead)) {
+    return;
+  }
+
+  // eventfd のカウンタを0に戻してからキューを取り出す｡
+  // 取り出した後に Post() されたものは再度通知される｡
+  uint64_t value;
+  if (read(fde->fd, &value, sizeof(value)) < 0) {
+    return;
+  }
+  pthread_mutex_lock(&loop->queue_mutex_);
+  loop->received_.swap(loop->queue_);
+  pthread_mutex_unlock(&loop->queue_mutex_);
+
+  for (std::vector<ConnSocket *>::const_iterator it = loop->received_.begin();
+       it != loop->received_.end(); ++it) {
+    RegisterConnSocket(*it, epoll);
+  }
+  loop->received_.clear();
+}
+
+// ========================================================================
+// ConnDispatcher
+
+ConnDispatcher::ConnDispatcher(const std::vector<LoopThread *> &loops,
+                               config::Config::ThreadBalancing balancing)
+    : loops_(loops), balancing_(balancing), next_(0) {}
+
+ConnDispatcher::~ConnDispatcher() {}
+
+void ConnDispatcher::Dispatch(ConnSocket *conn_sock, Epoll *epoll) {
+  LoopThread *loop = SelectLoop();
+  loop->IncrementConnNum();
+  if (&loop->GetEpoll() == epoll) {
+    RegisterConnSocket(conn_sock, epoll);
+  } else {
+    loop->Post(conn_sock);
+  }
+}
+
+LoopThread *ConnDispatcher::SelectLoop() {
+  if (balancing_ == config::Config::kLeastConnections) {
+    LoopThread *least = loops_[0];
+    long least_num = least->GetConnNum();
+    for (size_t i = 1; i < loops_.size(); ++i) {
+      long conn_num = loops_[i]->GetConnNum();
+      if (conn_num < least_num) {
+        least = loops_[i];
+        least_num = conn_num;
+      }
+    }
+    return least;
+  }
+  LoopThread *loop = loops_[next_];
+  next_ = (next_ + 1) % loops_.size();
+  return loop;
+}
+
+}  // namespace server
@@ -0,0 +1,109 @@
+#ifndef SERVER_LOOP_THREAD_HPP_
+#define SERVER_LOOP_THREAD_HPP_
+
+#include <pthread.h>
+
+#include <vector>
+
+#include "config/config.hpp"
+#include "result/result.hpp"
+#include "server/epoll.hpp"
+
+namespace server {
+using namespace result;
+
+class ConnSocket;
+
+// 1つのスレッドで Epoll を回すイベントループ｡
+//
+// Epoll とそれに登録されている FdEvent, ConnSocket などは
+// このループを回すスレッドだけが触る｡ (スレッド間で共有しない)
+// 他のスレッドで accept した ConnSocket は Post() でキューに入れ､
+// eventfd でループを起こしてこのスレッドの Epoll に登録する｡
+class LoopThread {
+ private:
+  Epoll epoll_;
+
+  // Post() されたことを通知する eventfd
+  int event_fd_;
+  FdEvent *event_fde_;
+
+  // 他のスレッドから渡された ConnSocket のキュー
+  pthread_mutex_t queue_mutex_;
+  std::vector<ConnSocket *> queue_;
+
+  // queue_ と入れ替えて使う｡ ループを回すスレッドだけが触る｡
+  std::vector<ConnSocket *> received_;
+
+  // このループが持っている接続の数｡ __sync_* で読み書きする｡
+  long conn_num_;
+
+  pthread_t thread_;
+
+  // 現在のスレッドで回っている LoopThread
+  static __thread LoopThread *current_;
+
+ public:
+  LoopThread(int max_events, bool is_edge_triggered,
+             config::Config::EventBackend backend);
+  ~LoopThread();
+
+  Epoll &GetEpoll();
+
+  // 新しいスレッドを作成し､そのスレッドでイベントループを回す
+  Result<void> Start();
+
+  // 呼び出したスレッドでイベントループを回す｡ 戻らない｡
+  void Run();
+
+  // conn_sock の所有権をこのループに移す｡ どのスレッドから呼んでも良い｡
+  void Post(ConnSocket *conn_sock);
+
+  long GetConnNum() const;
+  void IncrementConnNum();
+  void DecrementConnNum();
+
+  // 呼び出したスレッドで回っている LoopThread を返す｡
+  // LoopThread を使っていない場合は NULL
+  static LoopThread *Current();
+
+ private:
+  LoopThread(const LoopThread &rhs);
+  LoopThread &operator=(const LoopThread &rhs);
+
+  static void *ThreadMain(void *arg);
+
+  // eventfd のイベントハンドラー｡ キューの ConnSocket を Epoll に登録する｡
+  static void HandleEventFd(FdEvent *fde, unsigned int events, void *data,
+                            Epoll *epoll);
+};
+
+// ListenSocket で accept した ConnSocket を LoopThread に振り分ける｡
+// Dispatch() は listen socket を持つスレッドからのみ呼ばれる｡
+class ConnDispatcher {
+ private:
+  std::vector<LoopThread *> loops_;
+  config::Config::ThreadBalancing balancing_;
+
+  // ラウンドロビンで次に振り分けるループ
+  size_t next_;
+
+ public:
+  ConnDispatcher(const std::vector<LoopThread *> &loops,
+                 config::Config::ThreadBalancing balancing);
+  ~ConnDispatcher();
+
+  // conn_sock をいずれかのループに渡す｡
+  // 選ばれたループが epoll のループなら直接登録する｡
+  void Dispatch(ConnSocket *conn_sock, Epoll *epoll);
+
+ private:
+  ConnDispatcher(const ConnDispatcher &rhs);
+  ConnDispatcher &operator=(const ConnDispatcher &rhs);
+
+  LoopThread *SelectLoop();
+};
+
+}  // namespace server
+
+#endif
@@ -7,7 +7,9 @@
 #include "server/setup.hpp"
 #include "server/socket.hpp"
 #include "server/socket_event_handler.hpp"
+#include "server/stats.hpp"
 #include "server/types.hpp"
+#include "server/worker.hpp"
 #include "utils/error.hpp"
 #include "utils/inet_sockets.hpp"
 #include "utils/log.hpp"
@@ -51,16 +53,18 @@ int main(int argc, char const *argv[]) {
     utils::PrintLog("set_signal error!!");
     exit(EXIT_FAILURE);
   }
-
-  // epoll インスタンス作成
-  server::Epoll epoll;
-
-  // listen socket を作成
-  if (RegisterListenSockets(epoll, config).IsErr()) {
-    utils::ErrExit("server::RegisterListenSockets()");
+  // SIGUSR1 でカウンターを出力する｡ ワーカーにも引き継がれる｡
+  if (utils::set_signal_handler(SIGUSR1, server::RequestStatsDump, 0) ==
+      false) {
+    utils::PrintLog("set_signal error!!");
+    exit(EXIT_FAILURE);
   }
 
-  server::StartEventLoop(epoll);
+  if (config.GetWorkerProcesses() > 1) {
+    // マスタープロセスがワーカープロセスを起動して監視する
+    return server::RunMaster(config);
+  }
+  server::RunWorker(config);
 
   return 0;
 }
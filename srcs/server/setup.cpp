@@ -17,15 +17,18 @@
 namespace server {
 
 namespace {
-// fdsのすべての要素に対してcloseシステムコールを実行する｡
-void CloseAllFds(const std::vector<int> &listen_fds);
+// listen_socks のすべての ListenSocket を delete する｡ (fd も close される)
+void DeleteAllListenSockets(std::vector<ListenSocket *> &listen_socks);
 }  // namespace
 
-Result<void> RegisterListenSockets(Epoll &epoll, const config::Config &config) {
+Result<void> OpenListenSockets(const config::Config &config,
+                               std::vector<ListenSocket *> &listen_socks) {
   std::set<config::PortType> used_ip_ports;
-  std::vector<int> fds;
   const config::Config::VirtualServerConfVector &virtual_servers =
       config.GetVirtualServerConfs();
+  // ワーカープロセスごとに listen socket を作る場合は同じポートで listen する
+  bool reuse_port =
+      config.GetWorkerProcesses() > 1 && config.GetIsReusePort();
   for (config::Config::VirtualServerConfVector::const_iterator it =
            virtual_servers.begin();
        it != virtual_servers.end(); ++it) {
@@ -38,31 +41,42 @@ Result<void> RegisterListenSockets(Epoll &epoll, const config::Config &config) {
     }
 
     SocketAddress socket_address;
-    Result<int> listen_res = utils::InetListen(
-        it->GetListenIp(), it->GetListenPort(), SOMAXCONN, &socket_address);
+    Result<int> listen_res =
+        utils::InetListen(it->GetListenIp(), it->GetListenPort(), SOMAXCONN,
+                          &socket_address, reuse_port);
     if (listen_res.IsErr()) {
-      CloseAllFds(fds);
-      return Error("RegisterListenSockets");
+      DeleteAllListenSockets(listen_socks);
+      return Error("OpenListenSockets");
     }
-    int fd = listen_res.Ok();
-
-    ListenSocket *listen_sock = new ListenSocket(fd, socket_address, config);
-    FdEvent *fde = CreateFdEvent(fd, HandleListenSocketEvent, listen_sock);
-    epoll.Register(fde);
-    epoll.Add(fde, kFdeRead);
+    listen_socks.push_back(
+        new ListenSocket(listen_res.Ok(), socket_address, config));
 
     used_ip_ports.insert(ip_port);
-    fds.push_back(fd);
   }
   return Result<void>();
 }
 
+void RegisterListenSockets(Epoll &epoll,
+                           const std::vector<ListenSocket *> &listen_socks,
+                           ConnDispatcher *dispatcher, bool is_exclusive) {
+  for (std::vector<ListenSocket *>::const_iterator it = listen_socks.begin();
+       it != listen_socks.end(); ++it) {
+    ListenSocket *listen_sock = *it;
+    listen_sock->SetDispatcher(dispatcher);
+    FdEvent *fde = CreateFdEvent(listen_sock->GetFd(), HandleListenSocketEvent,
+                                 listen_sock);
+    epoll.Register(fde, is_exclusive);
+    epoll.Add(fde, kFdeRead);
+  }
+}
+
 namespace {
-void CloseAllFds(const std::vector<int> &listen_fds) {
-  for (std::vector<int>::const_iterator it = listen_fds.begin();
-       it != listen_fds.end(); ++it) {
-    close(*it);
+void DeleteAllListenSockets(std::vector<ListenSocket *> &listen_socks) {
+  for (std::vector<ListenSocket *>::const_iterator it = listen_socks.begin();
+       it != listen_socks.end(); ++it) {
+    delete *it;
   }
+  listen_socks.clear();
 }
 }  // namespace
 
@@ -11,7 +11,21 @@
 namespace server {
 using namespace result;
 
-Result<void> RegisterListenSockets(Epoll &epoll, const config::Config &config);
+class ConnDispatcher;
+class ListenSocket;
+
+// config の listen socket を作成し､listen_socks に追加する｡ (Epoll には登録しない)
+// worker_processes が2以上で reuse_port が on なら SO_REUSEPORT を付ける｡
+Result<void> OpenListenSockets(const config::Config &config,
+                               std::vector<ListenSocket *> &listen_socks);
+
+// listen_socks を epoll に登録する｡
+// dispatcher が NULL でなければ accept した接続は dispatcher で振り分ける｡
+// is_exclusive が true なら EPOLLEXCLUSIVE で監視する｡
+// (listen socket を他のプロセスと共有している場合)
+void RegisterListenSockets(Epoll &epoll,
+                           const std::vector<ListenSocket *> &listen_socks,
+                           ConnDispatcher *dispatcher, bool is_exclusive);
 
 }  // namespace server
 #endif
@@ -1,10 +1,12 @@
 #include "server/socket.hpp"
 
 #include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 
 #include <cassert>
-#include <deque>
+#include <list>
 
 #include "utils/inet_sockets.hpp"
 #include "utils/log.hpp"
@@ -50,6 +52,9 @@ ConnSocket::ConnSocket(int fd, const SocketAddress &server_addr,
     : Socket(fd, server_addr, config),
       client_addr_(client_addr),
       response_(NULL),
+      parsed_size_(0),
+      is_read_paused_(false),
+      read_size_(kMinReadSize),
       is_shutdown_(false) {}
 
 ConnSocket::~ConnSocket() {
@@ -58,10 +63,20 @@ ConnSocket::~ConnSocket() {
   }
 }
 
-std::deque<http::HttpRequest> &ConnSocket::GetRequests() {
+std::list<http::HttpRequest> &ConnSocket::GetRequests() {
   return requests_;
 }
 
+void ConnSocket::AddParsedRequest(const http::HttpRequest &request) {
+  parsed_size_ += request.GetReceivedSize();
+}
+
+void ConnSocket::PopRequest() {
+  assert(parsed_size_ >= requests_.front().GetReceivedSize());
+  parsed_size_ -= requests_.front().GetReceivedSize();
+  requests_.pop_front();
+}
+
 std::string ConnSocket::GetRemoteIp() const {
   return client_addr_.GetIp();
 }
@@ -74,9 +89,12 @@ bool ConnSocket::HasParsedRequest() {
   return !requests_.empty() && requests_.front().IsResponsible();
 }
 
-void ConnSocket::ShutDown() {
-  shutdown(fd_, SHUT_RDWR);
-  SetIsShutdown(true);
+bool ConnSocket::HasPipelinedRequest() {
+  if (requests_.empty()) {
+    return false;
+  }
+  std::list<http::HttpRequest>::const_iterator next = ++requests_.begin();
+  return next != requests_.end() && next->IsResponsible();
 }
 
 http::HttpResponse *ConnSocket::GetResponse() {
@@ -87,10 +105,54 @@ void ConnSocket::SetResponse(http::HttpResponse *response) {
   response_ = response;
 }
 
-utils::ByteVector &ConnSocket::GetBuffer() {
+utils::ByteBuffer &ConnSocket::GetBuffer() {
   return buffer_;
 }
 
+utils::OutputChain &ConnSocket::GetOutput() {
+  return output_;
+}
+
+size_t ConnSocket::GetReadSize() const {
+  return read_size_;
+}
+
+void ConnSocket::UpdateReadSize(size_t read_bytes) {
+  if (read_bytes >= read_size_) {
+    // まだ読み込めるデータがあるかもしれないので次はもっと読む
+    if (read_size_ < kMaxReadSize) {
+      read_size_ *= 2;
+    }
+  } else if (read_bytes < read_size_ / 2 && read_size_ > kMinReadSize) {
+    read_size_ /= 2;
+  }
+}
+
+size_t ConnSocket::GetBufferedSize() const {
+  return parsed_size_ + buffer_.size();
+}
+
+bool ConnSocket::IsBufferFull() const {
+  return GetBufferedSize() >= config_.GetConnectionBufferLimit();
+}
+
+bool ConnSocket::IsReadPaused() const {
+  return is_read_paused_;
+}
+
+void ConnSocket::SetIsReadPaused(bool is_read_paused) {
+  is_read_paused_ = is_read_paused;
+}
+
+void ConnSocket::ShrinkIfIdle() {
+  if (!requests_.empty() || response_ != NULL) {
+    return;
+  }
+  buffer_.ReleaseIfEmpty();
+  // 次のリクエストも小さいことが多いので一番小さいサイズから読み始める
+  read_size_ = kMinReadSize;
+}
+
 bool ConnSocket::IsShutdown() {
   return is_shutdown_;
 }
@@ -103,12 +165,21 @@ void ConnSocket::SetIsShutdown(bool is_shutdown) {
 // ListenSocket
 
 ListenSocket::ListenSocket(int fd, const SocketAddress &server_addr,
-                           const config::Config &config)
-    : Socket(fd, server_addr, config) {
+                           const config::Config &config,
+                           ConnDispatcher *dispatcher)
+    : Socket(fd, server_addr, config), dispatcher_(dispatcher) {
   std::cout << "Listen at " << GetServerIp() << ":" << GetServerPort()
             << std::endl;
 }
 
+ConnDispatcher *ListenSocket::GetDispatcher() const {
+  return dispatcher_;
+}
+
+void ListenSocket::SetDispatcher(ConnDispatcher *dispatcher) {
+  dispatcher_ = dispatcher;
+}
+
 Result<ConnSocket *> ListenSocket::AcceptNewConnection() {
   struct sockaddr_storage client_addr;
   socklen_t addrlen = sizeof(struct sockaddr_storage);
@@ -118,7 +189,17 @@ Result<ConnSocket *> ListenSocket::AcceptNewConnection() {
     return Error("accept");
   }
 
+  if (config_.GetIsTcpNodelay()) {
+    // 小さいレスポンスがクライアントの遅延 ACK を待たずに送られるようにする｡
+    // 失敗しても送信が遅れるだけなので接続はそのまま使う｡
+    int optval = 1;
+    setsockopt(conn_fd, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof(optval));
+  }
+
+#ifdef DEBUG
+  // getnameinfo(3) は遅いのでデバッグ時のみ出力する
   utils::LogConnectionInfoToStdout(client_addr);
+#endif
 
   ConnSocket *conn_sock = new ConnSocket(
       conn_fd, server_addr_,
@@ -1,7 +1,7 @@
 #ifndef SERVER_SOCKET_HPP_
 #define SERVER_SOCKET_HPP_
 
-#include <deque>
+#include <list>
 #include <string>
 #include <vector>
 
@@ -10,7 +10,8 @@
 #include "http/http_response.hpp"
 #include "result/result.hpp"
 #include "server/socket_address.hpp"
-#include "utils/ByteVector.hpp"
+#include "utils/ByteBuffer.hpp"
+#include "utils/OutputChain.hpp"
 
 namespace http {
 class HttpResponse;
@@ -19,6 +20,8 @@ class HttpResponse;
 namespace server {
 using namespace result;
 
+class ConnDispatcher;
+
 // listen_fd の情報などを持たせたい｡
 // CGI でリクエスト元IPなど色々情報が必要になってくるので,
 // それらの情報をもたせるようにしたい｡
@@ -56,9 +59,25 @@ class ConnSocket : public Socket {
  private:
   const SocketAddress client_addr_;
 
-  std::deque<http::HttpRequest> requests_;
+  // 空の std::deque は要素の領域を確保したままなので､待機中の接続が
+  // 何も確保しないように std::list を使う｡
+  std::list<http::HttpRequest> requests_;
   http::HttpResponse *response_;
-  utils::ByteVector buffer_;
+  utils::ByteBuffer buffer_;
+
+  // パイプライン化されたリクエストのレスポンスのうち､
+  // まとめて書き込むためにためているもの｡ response_ より先に書き込む｡
+  utils::OutputChain output_;
+
+  // requests_ のうちパースし終えたリクエストのバイト数の合計
+  size_t parsed_size_;
+
+  // GetBufferedSize() が上限を超えたので読み込みを止めているか
+  bool is_read_paused_;
+
+  // 次の read() で読み込むサイズ
+  // 読み込みでいっぱいになれば大きくし､少ししか読めなければ小さくする｡
+  size_t read_size_;
 
   // shutdown したかどうか
   // サーバーから切る場合は shutdown() して FIN を送ったか
@@ -72,6 +91,10 @@ class ConnSocket : public Socket {
   //   切断するのでそれに合わせる｡
   static const long kDefaultTimeoutMs = 5 * 1000;
 
+  // read_size_ の範囲
+  static const size_t kMinReadSize = 4 * 1024;
+  static const size_t kMaxReadSize = 64 * 1024;
+
   ConnSocket(int fd, const SocketAddress &server_addr,
              const SocketAddress &client_addr, const config::Config &config);
   virtual ~ConnSocket();
@@ -79,17 +102,43 @@ class ConnSocket : public Socket {
   std::string GetRemoteIp() const;
   std::string GetRemoteName() const;
 
-  std::deque<http::HttpRequest> &GetRequests();
+  std::list<http::HttpRequest> &GetRequests();
+  // パースし終えたリクエストを数える｡ PopRequest() で同じリクエストを
+  // 取り除くと差し引かれる｡
+  void AddParsedRequest(const http::HttpRequest &request);
+  // 先頭のリクエストを取り除く
+  void PopRequest();
 
   bool HasParsedRequest();
-  void ShutDown();
+  // 先頭の次のリクエストもパースし終えているか
+  bool HasPipelinedRequest();
 
   http::HttpResponse *GetResponse();
   void SetResponse(http::HttpResponse *response);
   bool IsShutdown();
   void SetIsShutdown(bool is_shutdown);
 
-  utils::ByteVector &GetBuffer();
+  utils::ByteBuffer &GetBuffer();
+  utils::OutputChain &GetOutput();
+
+  size_t GetReadSize() const;
+
+  // read() で読み込んだバイト数を元に read_size_ を調整する
+  void UpdateReadSize(size_t read_bytes);
+
+  // 受信してまだレスポンスを返していないバイト数｡
+  // パースし終えたリクエストと未パースのデータの合計｡
+  // (パース中のリクエストのボディは client_max_body_size で制限される)
+  size_t GetBufferedSize() const;
+  // GetBufferedSize() が connection_buffer_limit 以上か
+  bool IsBufferFull() const;
+
+  bool IsReadPaused() const;
+  void SetIsReadPaused(bool is_read_paused);
+
+  // レスポンスを返し終えて次のリクエストを待っている場合は､
+  // 次のリクエストが届くまで使わない領域を返す｡
+  void ShrinkIfIdle();
 
  private:
   ConnSocket();
@@ -97,9 +146,18 @@ class ConnSocket : public Socket {
 };
 
 class ListenSocket : public Socket {
+ private:
+  // accept した接続を他のスレッドに振り分ける｡
+  // NULL なら accept したスレッドで処理する｡
+  ConnDispatcher *dispatcher_;
+
  public:
   ListenSocket(int fd, const SocketAddress &server_addr,
-               const config::Config &config);
+               const config::Config &config,
+               ConnDispatcher *dispatcher = NULL);
+
+  ConnDispatcher *GetDispatcher() const;
+  void SetDispatcher(ConnDispatcher *dispatcher);
 
   // 現在の Socket に来た接続要求を accept する｡
   // 返り値の Socket* はヒープ領域に存在しており､
@@ -1,14 +1,16 @@
 #include "server/socket_event_handler.hpp"
 
-#include <unistd.h>
-
-#include <deque>
+#include <cerrno>
+#include <cstring>
+#include <list>
 
 #include "http/http_cgi_response.hpp"
 #include "http/http_response.hpp"
 #include "result/result.hpp"
 #include "server/epoll.hpp"
+#include "server/loop_thread.hpp"
 #include "server/socket.hpp"
+#include "server/stats.hpp"
 #include "utils/error.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
@@ -22,10 +24,26 @@ http::HttpResponse *AllocateResponseObj(const http::HttpRequest &request,
                                         Epoll *epoll, ConnSocket *socket);
 
 // 呼び出し元でソケットを閉じる必要がある場合は true を返す
-bool ProcessRequest(ConnSocket *socket);
+// エッジトリガーの場合は EAGAIN になるまで読み込む｡
+bool ProcessRequest(ConnSocket *socket, FdEvent *fde, Epoll *epoll);
+
+// socket のバッファからパースできるだけリクエストをパースする
+void ParseRequests(ConnSocket *socket);
+
+// バッファが connection_buffer_limit に達していれば true を返し､
+// レスポンスを返してバッファが減るまで読み込みを止める｡
+// 返せるリクエストがなければバッファが減ることはないので､パース中の
+// リクエストをエラーにする｡ (エラーレスポンスを返した後に接続を切る)
+bool StopReadingIfBufferFull(ConnSocket *socket);
 
 // 呼び出し元でソケットを閉じる必要がある場合は true を返す
-bool ProcessResponse(ConnSocket *socket, Epoll *epoll);
+// 書き込めなくなるかレスポンスを返せるリクエストがなくなるまで続けて処理する｡
+// パイプライン化されたリクエストのうちすぐに返せるレスポンスは
+// socket->GetOutput() にためて､1回の writev(2) でまとめて書き込む｡
+bool ProcessResponse(ConnSocket *socket, FdEvent *fde, Epoll *epoll);
+
+// GetOutput() にためたレスポンスがこれ以上になったら書き込む
+const size_t kMaxBatchedOutputSize = 256 * 1024;
 
 // HTTPレスポンスのヘッダーに "Connection: close" が含まれているか
 //
@@ -33,63 +51,105 @@ bool ProcessResponse(ConnSocket *socket, Epoll *epoll);
 // HttpResponse.GetHeader() が const メソッドじゃないから
 bool ResponseHeaderHasConnectionClose(http::HttpResponse &response);
 
+// accept が EMFILE, ENFILE で失敗した場合に accept を止める時間
+const long kAcceptBackoffMs = 100;
+
+// EAGAIN になるか accept_batch 個 accept するまで接続を accept する
+void AcceptConnections(FdEvent *fde, ListenSocket *listen_sock, Epoll *epoll);
+
 }  // namespace
 
 void HandleConnSocketEvent(FdEvent *fde, unsigned int events, void *data,
                            Epoll *epoll) {
   ConnSocket *conn_sock = reinterpret_cast<ConnSocket *>(data);
   bool should_close_conn = false;
+  bool is_edge_triggered = epoll->IsEdgeTriggered();
 
   if (events & kFdeRead) {
-    should_close_conn |= ProcessRequest(conn_sock);
+    should_close_conn |= ProcessRequest(conn_sock, fde, epoll);
   }
-  if (events & kFdeWrite) {
-    should_close_conn |= ProcessResponse(conn_sock, epoll);
+  // エッジトリガーでは書き込み可能になった時しか kFdeWrite が通知されないので､
+  // 書き込みイベントを待たずにレスポンスを書き込む｡
+  if ((events & kFdeWrite) || is_edge_triggered) {
+    should_close_conn |= ProcessResponse(conn_sock, fde, epoll);
   }
 
   // buffer が なければ、write イベント を 無視
   // cgi は cgi から read イベントで読み込んだ時、write
   // イベントを監視するようにした。
   // 通常ファイルの時問題ないか確認する。
-  const http::HttpResponse *response = conn_sock->GetResponse();
-  bool is_cgi_buffer_empty =
-      response && response->IsCgiResponse() && response->IsWriteBufferEmpty();
+  //
+  // エッジトリガーでは書き込みイベントは常に監視したままにする｡
+  // (CGI の出力は CgiProcess が Epoll::Rearm() で通知する)
+  if (!is_edge_triggered) {
+    const http::HttpResponse *response = conn_sock->GetResponse();
+    bool is_cgi_buffer_empty = response && response->IsCgiResponse() &&
+                               response->IsWriteBufferEmpty();
 
-  if (conn_sock->HasParsedRequest() && !is_cgi_buffer_empty) {
-    epoll->Add(fde, kFdeWrite);
-  } else {
-    epoll->Del(fde, kFdeWrite);
+    if ((conn_sock->HasParsedRequest() && !is_cgi_buffer_empty) ||
+        !conn_sock->GetOutput().empty()) {
+      epoll->Add(fde, kFdeWrite);
+    } else {
+      epoll->Del(fde, kFdeWrite);
+    }
   }
 
+  // バッファが上限を超えて読み込みを止めていた接続は､
+  // レスポンスを返して減ったら読み込みを再開する｡
+  if (conn_sock->IsReadPaused()) {
+    if (!conn_sock->IsBufferFull()) {
+      conn_sock->SetIsReadPaused(false);
+      if (is_edge_triggered) {
+        // 止めている間に届いたデータは通知されないので再度通知させる
+        epoll->Rearm(fde);
+      } else {
+        epoll->Add(fde, kFdeRead);
+      }
+    } else if (!is_edge_triggered) {
+      epoll->Del(fde, kFdeRead);
+    }
+  }
+  conn_sock->ShrinkIfIdle();
+
   if ((should_close_conn && conn_sock->IsShutdown()) ||
       (events & kFdeTimeout)) {
     utils::PrintDebugLog("Connection close");
+    LoopThread *loop = LoopThread::Current();
+    if (loop != NULL) {
+      loop->DecrementConnNum();
+    }
     epoll->Unregister(fde);
     // conn_sock->fd の close は Socket のデストラクタで行うので不要｡
     delete conn_sock;
     delete fde;
   } else if (should_close_conn && !conn_sock->IsShutdown()) {
-    conn_sock->ShutDown();
+    // 書き込んだレスポンスを送り終えてから送受信を止める
+    epoll->ShutDown(fde);
+    conn_sock->SetIsShutdown(true);
   }
 }
 
+void RegisterConnSocket(ConnSocket *conn_sock, Epoll *epoll) {
+  FdEvent *conn_fde =
+      CreateFdEvent(conn_sock->GetFd(), HandleConnSocketEvent, conn_sock);
+  epoll->RegisterStream(conn_fde);
+  // エッジトリガーでは書き込みイベントも常に監視する
+  epoll->Add(conn_fde,
+             epoll->IsEdgeTriggered() ? kFdeRead | kFdeWrite : kFdeRead);
+  epoll->SetTimeout(conn_fde, ConnSocket::kDefaultTimeoutMs);
+}
+
 void HandleListenSocketEvent(FdEvent *fde, unsigned int events, void *data,
                              Epoll *epoll) {
-  (void)fde;
   ListenSocket *listen_sock = reinterpret_cast<ListenSocket *>(data);
 
+  if (events & kFdeTimeout) {
+    // fd が足りずに止めていた accept を再開する
+    epoll->Set(fde, kFdeRead);
+  }
+
   if (events & kFdeRead) {
-    Result<ConnSocket *> result = listen_sock->AcceptNewConnection();
-    if (result.IsErr()) {
-      // 本当はログ出力とかがあると良い｡
-      return;
-    }
-    ConnSocket *conn_sock = result.Ok();
-    FdEvent *conn_fde =
-        CreateFdEvent(conn_sock->GetFd(), HandleConnSocketEvent, conn_sock);
-    epoll->Register(conn_fde);
-    epoll->Add(conn_fde, kFdeRead);
-    epoll->SetTimeout(conn_fde, ConnSocket::kDefaultTimeoutMs);
+    AcceptConnections(fde, listen_sock, epoll);
   }
 
   if (events & kFdeError) {
@@ -100,40 +160,117 @@ void HandleListenSocketEvent(FdEvent *fde, unsigned int events, void *data,
 }
 
 namespace {
-const int BUF_SIZE = 1024;
-
-bool ProcessRequest(ConnSocket *socket) {
-  unsigned char buf[BUF_SIZE];
-  int conn_fd = socket->GetFd();
-  int n = read(conn_fd, buf, sizeof(buf) - 1);
-  if (n <= 0) {  // EOF(TCP flag FIN) or Error
-    utils::PrintDebugLog("Connection end");
-    socket->SetIsShutdown(true);
-    return true;
-  } else {
-    utils::ByteVector &buffer = socket->GetBuffer();
-    buffer.AppendDataToBuffer(buf, n);
-
-    while (1) {
-      std::deque<http::HttpRequest> &requests = socket->GetRequests();
-      if (requests.empty() || requests.back().IsResponsible()) {
-        requests.push_back(http::HttpRequest());
+void AcceptConnections(FdEvent *fde, ListenSocket *listen_sock, Epoll *epoll) {
+  int accept_batch = listen_sock->GetConfig().GetAcceptBatch();
+  for (int i = 0; i < accept_batch; ++i) {
+    Result<ConnSocket *> result = listen_sock->AcceptNewConnection();
+    if (result.IsErr()) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
       }
-      requests.back().ParseRequest(buffer, socket->GetConfig(),
-                                   socket->GetServerIp(),
-                                   socket->GetServerPort());
-      if (requests.back().IsErrorRequest()) {
-        buffer.clear();
-        break;
-      }
-      if (buffer.empty() || requests.back().IsResponsible() == false) {
-        break;
+      if (errno == EMFILE || errno == ENFILE) {
+        // 接続が accept されずに残るので､レベルトリガーでは
+        // 監視を続けるとイベントが通知され続けてしまう｡
+        // しばらく監視を止め､fd が空くのを待ってから再開する｡
+        IncrementStat(kStatAcceptFdExhausted);
+        utils::PrintLog("accept: %s, pausing for %ldms", strerror(errno),
+                        kAcceptBackoffMs);
+        epoll->Del(fde, kFdeRead);
+        epoll->SetTimeout(fde, kAcceptBackoffMs);
+        return;
       }
+      // ECONNABORTED などはその接続だけの問題なので次の接続を accept する
+      IncrementStat(kStatAcceptRefused);
+      continue;
     }
+    IncrementStat(kStatAccepted);
+
+    ConnSocket *conn_sock = result.Ok();
+    ConnDispatcher *dispatcher = listen_sock->GetDispatcher();
+    if (dispatcher != NULL) {
+      dispatcher->Dispatch(conn_sock, epoll);
+    } else {
+      RegisterConnSocket(conn_sock, epoll);
+    }
+  }
+  // エッジトリガーでは残りの接続が通知されないので再度通知させる
+  if (epoll->IsEdgeTriggered()) {
+    epoll->Rearm(fde);
   }
+}
+
+bool ProcessRequest(ConnSocket *socket, FdEvent *fde, Epoll *epoll) {
+  utils::ByteBuffer &buffer = socket->GetBuffer();
+  do {
+    if (StopReadingIfBufferFull(socket)) {
+      break;
+    }
+    // 一旦別のバッファに読み込んでコピーするのではなく､
+    // バッファの末尾の空き領域に直接読み込む｡
+    size_t read_size = socket->GetReadSize();
+    Result<size_t> read_res =
+        epoll->Read(fde, buffer.PrepareWrite(read_size), read_size);
+    if (read_res.IsErr() && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // 読み込めるデータがなくなった｡ 次のデータが届くまで領域を返しておく｡
+      buffer.ReleaseIfEmpty();
+      break;
+    }
+    if (read_res.IsErr() || read_res.Ok() == 0) {  // EOF(TCP flag FIN) or Error
+      utils::PrintDebugLog("Connection end");
+      socket->SetIsShutdown(true);
+      return true;
+    }
+    buffer.CommitWrite(read_res.Ok());
+    socket->UpdateReadSize(read_res.Ok());
+    ParseRequests(socket);
+  } while (epoll->IsEdgeTriggered());
+  // 最後に読み込んだデータで上限に達した場合は次の読み込みイベントが
+  // 来ないこともあるので､ここでも調べる
+  StopReadingIfBufferFull(socket);
   return false;
 }
 
+void ParseRequests(ConnSocket *socket) {
+  utils::ByteBuffer &buffer = socket->GetBuffer();
+  while (1) {
+    std::list<http::HttpRequest> &requests = socket->GetRequests();
+    if (requests.empty() || requests.back().IsResponsible()) {
+      requests.push_back(http::HttpRequest());
+    }
+    requests.back().ParseRequest(buffer, socket->GetConfig(),
+                                 socket->GetServerIp(),
+                                 socket->GetServerPort());
+    if (requests.back().IsResponsible()) {
+      socket->AddParsedRequest(requests.back());
+    }
+    if (requests.back().IsErrorRequest()) {
+      buffer.clear();
+      break;
+    }
+    if (buffer.empty() || requests.back().IsResponsible() == false) {
+      break;
+    }
+  }
+}
+
+bool StopReadingIfBufferFull(ConnSocket *socket) {
+  if (!socket->IsBufferFull()) {
+    return false;
+  }
+  if (!socket->HasParsedRequest()) {
+    std::list<http::HttpRequest> &requests = socket->GetRequests();
+    if (requests.empty()) {
+      requests.push_back(http::HttpRequest());
+    }
+    requests.back().SetBufferLimitExceeded();
+    socket->AddParsedRequest(requests.back());
+    // ParseRequests() でエラーになった時と同じく残りのデータは捨てる
+    socket->GetBuffer().clear();
+  }
+  socket->SetIsReadPaused(true);
+  return true;
+}
+
 bool ResponseHeaderHasConnectionClose(http::HttpResponse &response) {
   const std::vector<std::string> &connection_header =
       response.GetHeader("Connection");
@@ -146,28 +283,58 @@ bool ResponseHeaderHasConnectionClose(http::HttpResponse &response) {
   return false;
 }
 
-bool ProcessResponse(ConnSocket *socket, Epoll *epoll) {
-  int conn_fd = socket->GetFd();
-  std::deque<http::HttpRequest> &requests = socket->GetRequests();
+bool ProcessResponse(ConnSocket *socket, FdEvent *fde, Epoll *epoll) {
+  FdEventSink sink(epoll, fde);
+  std::list<http::HttpRequest> &requests = socket->GetRequests();
+  utils::OutputChain &output = socket->GetOutput();
   bool should_close_conn = false;
 
-  if (socket->HasParsedRequest()) {
+  while (!should_close_conn && socket->HasParsedRequest()) {
     http::HttpRequest &request = requests.front();
+    // 後ろにパースし終えたリクエストが続いているか､前のレスポンスを
+    // ためている場合はまとめて書き込む
+    const bool is_batched = socket->HasPipelinedRequest() || !output.empty();
 
     if (socket->GetResponse() == NULL) {
       // レスポンスオブジェクトがまだない
-      utils::PrintLog("%s %s", utils::GetDateStr().c_str(),
+      utils::PrintLog("%s %s", epoll->GetClock().GetLogDate().c_str(),
                       request.GetRequestInfoOneLine().c_str());
       http::HttpResponse *response =
           AllocateResponseObj(request, epoll, socket);
+      // まとめて書き込めるように小さいファイルは先に読み込んでおく
+      response->SetIsSmallFileInlined(is_batched);
       socket->SetResponse(response);
     }
 
     http::HttpResponse *response = socket->GetResponse();
     should_close_conn |= response->PrepareToWrite(socket).IsErr();
+    // "Connection: close" のレスポンスは書き込んだ後に接続を切るので
+    // まとめない｡ (作り終える前に GetHeader() を呼ぶとヘッダーが増える)
+    if (!should_close_conn && is_batched && response->IsAllDataPrepared() &&
+        !ResponseHeaderHasConnectionClose(*response) &&
+        response->MoveWriteBufferTo(output)) {
+      IncrementStat(kStatBatchedResponses);
+      delete response;
+      socket->SetResponse(NULL);
+      socket->PopRequest();
+      if (output.size() < kMaxBatchedOutputSize) {
+        continue;
+      }
+    }
+    if (!should_close_conn && !output.empty()) {
+      // ためていたレスポンスを先に書き込む
+      should_close_conn |=
+          http::HttpResponse::WriteChainToSocket(sink, output).IsErr();
+      if (should_close_conn || !output.empty()) {
+        break;
+      }
+      if (socket->GetResponse() == NULL) {
+        continue;
+      }
+    }
     if (!should_close_conn && response->IsAllDataWritingCompleted() == false) {
       // 書き込むデータが存在する
-      should_close_conn |= response->WriteToSocket(conn_fd).IsErr();
+      should_close_conn |= response->WriteToSocket(sink).IsErr();
     }
     if (!should_close_conn && response->IsAllDataWritingCompleted()) {
       // "Connection: close"
@@ -175,10 +342,17 @@ bool ProcessResponse(ConnSocket *socket, Epoll *epoll) {
       should_close_conn |= ResponseHeaderHasConnectionClose(*response);
       delete response;
       socket->SetResponse(NULL);
-      requests.pop_front();
+      socket->PopRequest();
+    } else if (!response->IsWriteBufferEmpty() || response->IsCgiResponse()) {
+      // 書き込めなくなったか CGI の出力待ち
+      break;
     }
   }
 
+  if (!should_close_conn && !output.empty()) {
+    should_close_conn |=
+        http::HttpResponse::WriteChainToSocket(sink, output).IsErr();
+  }
   return should_close_conn;
 }
 
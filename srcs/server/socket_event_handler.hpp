@@ -8,10 +8,16 @@ namespace server {
 
 using namespace result;
 
+class ConnSocket;
+
 // ConnectionSocketのイベントハンドラー
 void HandleConnSocketEvent(FdEvent *fde, unsigned int events, void *data,
                            Epoll *epoll);
 
+// conn_sock を epoll に登録し､HandleConnSocketEvent で処理するようにする｡
+// 登録した後は epoll を回すスレッドが conn_sock を所有する｡
+void RegisterConnSocket(ConnSocket *conn_sock, Epoll *epoll);
+
 // ListenSocketのイベントハンドラー
 void HandleListenSocketEvent(FdEvent *fde, unsigned int events, void *data,
                              Epoll *epoll);
@@ -0,0 +1,59 @@
+#include "server/stats.hpp"
+
+#include <unistd.h>
+
+#include <csignal>
+
+#include "utils/log.hpp"
+
+namespace server {
+
+namespace {
+
+// stats[<EStatCounter>]
+// 複数のスレッドから更新されるので __sync_* で読み書きする｡
+long stats[kStatCounterNum];
+
+const char *const kStatNames[kStatCounterNum] = {
+    "accepted",       "accept_refused", "accept_fd_exhausted",
+    "write_syscalls", "write_bytes",    "write_eagain",
+    "batched_responses"};
+
+volatile sig_atomic_t is_dump_requested = 0;
+
+}  // namespace
+
+void IncrementStat(EStatCounter counter, long value) {
+  __sync_fetch_and_add(&stats[counter], value);
+}
+
+long GetStat(EStatCounter counter) {
+  return __sync_fetch_and_add(&stats[counter], 0);
+}
+
+void DumpStats() {
+  for (int i = 0; i < kStatCounterNum; ++i) {
+    utils::PrintLog("[%d] stats %s: %ld", getpid(), kStatNames[i],
+                    GetStat(static_cast<EStatCounter>(i)));
+  }
+  long write_syscalls = GetStat(kStatWriteSyscalls);
+  if (write_syscalls > 0) {
+    utils::PrintLog("[%d] stats write_bytes_per_syscall: %ld", getpid(),
+                    GetStat(kStatWriteBytes) / write_syscalls);
+  }
+}
+
+void RequestStatsDump(int signal) {
+  (void)signal;
+  is_dump_requested = 1;
+}
+
+void DumpStatsIfRequested() {
+  if (!is_dump_requested) {
+    return;
+  }
+  is_dump_requested = 0;
+  DumpStats();
+}
+
+}  // namespace server
@@ -0,0 +1,43 @@
+#ifndef SERVER_STATS_HPP_
+#define SERVER_STATS_HPP_
+
+namespace server {
+
+// プロセス全体で集計するカウンター
+enum EStatCounter {
+  // accept した接続の数
+  kStatAccepted,
+  // ECONNABORTED などで accept に失敗した数
+  kStatAcceptRefused,
+  // fd が足りずに accept に失敗した数 (EMFILE, ENFILE)
+  kStatAcceptFdExhausted,
+  // レスポンスの書き込みで呼んだシステムコール (writev, sendfile) の数
+  // (io_uring では接続ソケットの送信キューに書き込んだ回数)
+  kStatWriteSyscalls,
+  // レスポンスとして書き込んだバイト数
+  kStatWriteBytes,
+  // レスポンスの書き込みが EAGAIN で止まった数
+  kStatWriteEagain,
+  // パイプライン化されたリクエストの続きとまとめて書き込んだレスポンスの数
+  kStatBatchedResponses,
+  kStatCounterNum
+};
+
+// カウンターに value を足す｡ どのスレッドから呼んでも良い｡
+void IncrementStat(EStatCounter counter, long value = 1);
+
+long GetStat(EStatCounter counter);
+
+// 全てのカウンターと1回の書き込みあたりのバイト数を標準エラー出力に出力する
+void DumpStats();
+
+// SIGUSR1 のシグナルハンドラー｡ DumpStats() の実行を予約する｡
+void RequestStatsDump(int signal);
+
+// RequestStatsDump() が呼ばれていれば DumpStats() を呼ぶ｡
+// イベントループから呼ばれる｡
+void DumpStatsIfRequested();
+
+}  // namespace server
+
+#endif
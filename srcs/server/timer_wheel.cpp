@@ -0,0 +1,207 @@
+#include "server/timer_wheel.hpp"
+
+#include <cassert>
+
+#include "server/epoll.hpp"
+
+namespace server {
+
+TimerWheel::TimerWheel(long now_ms) : current_ms_(now_ms), size_(0) {
+  for (int level = 0; level < kLevels; ++level) {
+    for (int slot = 0; slot < kSlots; ++slot) {
+      slots_[level][slot] = NULL;
+    }
+  }
+}
+
+TimerWheel::~TimerWheel() {}
+
+void TimerWheel::Arm(FdEvent *fde, long now_ms) {
+  if (size_ == 0 && current_ms_ < now_ms) {
+    // 空の間は RetrieveExpired() が呼ばれず tick が古いままのことがある｡
+    // 古い tick を基準に繋ぐと階層を間違えるので､先に now_ms まで進める｡
+    current_ms_ = now_ms;
+  }
+  if (IsArmed(fde)) {
+    Unlink(fde);
+  } else {
+    ++size_;
+  }
+  fde->timer_expire = ExpireOf(fde);
+  Link(fde);
+}
+
+void TimerWheel::Disarm(FdEvent *fde) {
+  if (!IsArmed(fde)) {
+    return;
+  }
+  Unlink(fde);
+  --size_;
+}
+
+bool TimerWheel::IsArmed(const FdEvent *fde) const {
+  return fde->timer_level >= 0;
+}
+
+void TimerWheel::RetrieveExpired(long now_ms, std::vector<FdEvent *> &expired) {
+  if (size_ == 0) {
+    // 何も登録されていなければ tick を進めるだけで良い
+    if (current_ms_ <= now_ms) {
+      current_ms_ = now_ms + 1;
+    }
+    return;
+  }
+
+  while (current_ms_ <= now_ms) {
+    // 空のスロットは 1ms ずつ進めずに飛ばす
+    long next_tick = GetNextTick();
+    if (next_tick < 0 || next_tick > now_ms) {
+      current_ms_ = now_ms + 1;
+      break;
+    }
+    current_ms_ = next_tick;
+
+    int index = current_ms_ & kSlotMask;
+    if (index == 0) {
+      // 下位の階層が一周したので上位の階層のスロットを振り分け直す
+      for (int level = 1; level < kLevels; ++level) {
+        int level_index =
+            (current_ms_ >> (kSlotBits * level)) & static_cast<int>(kSlotMask);
+        if (Cascade(level, level_index) != 0) {
+          break;
+        }
+      }
+    }
+
+    FdEvent *fde = slots_[0][index];
+    slots_[0][index] = NULL;
+    while (fde != NULL) {
+      FdEvent *next = fde->timer_next;
+      long expire = ExpireOf(fde);
+      if (expire > current_ms_) {
+        // 登録後にアクティビティがあったので期限を延長する
+        fde->timer_expire = expire;
+      } else {
+        expired.push_back(fde);
+        fde->timer_expire = now_ms + 1;
+      }
+      Link(fde);
+      fde = next;
+    }
+    ++current_ms_;
+  }
+}
+
+long TimerWheel::GetTimeUntilNextExpire(long now_ms) const {
+  long next_tick = GetNextTick();
+  if (next_tick < 0) {
+    return -1;
+  }
+  if (next_tick <= now_ms) {
+    return 0;
+  }
+  return next_tick - now_ms;
+}
+
+size_t TimerWheel::Size() const {
+  return size_;
+}
+
+void TimerWheel::Link(FdEvent *fde) {
+  long expire = fde->timer_expire;
+  long delta = expire - current_ms_;
+  int level = 0;
+  int index;
+
+  if (delta < 0) {
+    // 既に期限が過ぎているので次に処理する tick のスロットに入れる
+    index = current_ms_ & kSlotMask;
+  } else {
+    if (delta > kMaxDuration) {
+      // 表現できない期限は最大値で登録し､期限が来たら登録し直す
+      expire = current_ms_ + kMaxDuration;
+      delta = kMaxDuration;
+    }
+    while (level + 1 < kLevels && delta >= (1L << (kSlotBits * (level + 1)))) {
+      ++level;
+    }
+    index = (expire >> (kSlotBits * level)) & kSlotMask;
+  }
+
+  FdEvent *head = slots_[level][index];
+  fde->timer_prev = NULL;
+  fde->timer_next = head;
+  if (head != NULL) {
+    head->timer_prev = fde;
+  }
+  slots_[level][index] = fde;
+  fde->timer_level = level;
+  fde->timer_slot = index;
+}
+
+void TimerWheel::Unlink(FdEvent *fde) {
+  assert(IsArmed(fde));
+  if (fde->timer_prev != NULL) {
+    fde->timer_prev->timer_next = fde->timer_next;
+  } else {
+    slots_[fde->timer_level][fde->timer_slot] = fde->timer_next;
+  }
+  if (fde->timer_next != NULL) {
+    fde->timer_next->timer_prev = fde->timer_prev;
+  }
+  fde->timer_prev = NULL;
+  fde->timer_next = NULL;
+  fde->timer_level = -1;
+  fde->timer_slot = -1;
+}
+
+long TimerWheel::GetNextTick() const {
+  if (size_ == 0) {
+    return -1;
+  }
+
+  long next_tick = -1;
+  // level0 はスロットが 1ms 単位なので､最初に見つかったスロットが期限になる
+  for (long tick = current_ms_; tick < current_ms_ + kSlots; ++tick) {
+    if (slots_[0][tick & kSlotMask] != NULL) {
+      next_tick = tick;
+      break;
+    }
+  }
+  // 上位の階層は振り分け直す時刻が期限の下限になる
+  for (int level = 1; level < kLevels; ++level) {
+    int shift = kSlotBits * level;
+    long period = current_ms_ >> shift;
+    // current_ms_ が区切りならその tick の振り分けがまだ済んでいない
+    long first = (period << shift) == current_ms_ ? 0 : 1;
+    for (long i = first; i < first + kSlots; ++i) {
+      long cascade_ms = (period + i) << shift;
+      if (next_tick >= 0 && cascade_ms >= next_tick) {
+        break;
+      }
+      if (slots_[level][(period + i) & kSlotMask] != NULL) {
+        next_tick = cascade_ms;
+        break;
+      }
+    }
+  }
+  return next_tick;
+}
+
+int TimerWheel::Cascade(int level, int index) {
+  FdEvent *fde = slots_[level][index];
+  slots_[level][index] = NULL;
+  while (fde != NULL) {
+    FdEvent *next = fde->timer_next;
+    Link(fde);
+    fde = next;
+  }
+  return index;
+}
+
+// last_active から timeout_ms を超えたら期限切れ
+long TimerWheel::ExpireOf(const FdEvent *fde) {
+  return fde->last_active + fde->timeout_ms + 1;
+}
+
+}  // namespace server
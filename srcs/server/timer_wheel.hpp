@@ -0,0 +1,95 @@
+#ifndef SERVER_TIMER_WHEEL_HPP_
+#define SERVER_TIMER_WHEEL_HPP_
+
+#include <cstddef>
+#include <vector>
+
+namespace server {
+
+struct FdEvent;
+
+// FdEvent のタイムアウトを管理する階層型タイミングホイール｡
+//
+// 1tick = 1ms で､各階層は64スロットを持つ｡
+//   level0:  64ms までのタイマー (1ms 単位)
+//   level1:  約4秒までのタイマー (64ms 単位)
+//   level2:  約4分までのタイマー (約4秒単位)
+//   level3:  約4.6時間までのタイマー (約4分単位)
+// 上位の階層のスロットは時間が来たら下位の階層に振り分け直す(cascade)｡
+//
+// 登録･解除は O(1) であり､RetrieveExpired() は期限が来たスロットしか見ない｡
+// 空のスロットは飛ばすので､長い間呼ばれなくてもコストは経過時間に比例しない｡
+// そのため登録されているタイマーの数に関わらず1回あたりのコストはほぼ一定になる｡
+//
+// fde->last_active の更新(アクティビティによるタイマーの延長)は
+// ホイールを操作せずに行える｡ 期限が来たスロットを処理する際に
+// last_active を確認し､延長されていれば新しい期限で登録し直す｡
+class TimerWheel {
+ private:
+  static const int kLevels = 4;
+  static const int kSlotBits = 6;
+  static const int kSlots = 1 << kSlotBits;
+  static const long kSlotMask = kSlots - 1;
+  // ホイールで表現できる最大の期限(ms)
+  static const long kMaxDuration = (1L << (kSlotBits * kLevels)) - 1;
+
+  // 次に処理する tick (ms)
+  long current_ms_;
+
+  // slots_[<level>][<slot>] はそのスロットに属する FdEvent の双方向リストの先頭
+  FdEvent *slots_[kLevels][kSlots];
+
+  size_t size_;
+
+ public:
+  explicit TimerWheel(long now_ms);
+  ~TimerWheel();
+
+  // fde->last_active + fde->timeout_ms を過ぎたら期限切れになるように登録する｡
+  // 既に登録されている場合は登録し直す｡
+  // now_ms は現在時刻で､ホイールが空の間に進まなかった tick を合わせるのに使う｡
+  void Arm(FdEvent *fde, long now_ms);
+
+  // fde をホイールから外す｡ 登録されていない場合は何もしない｡
+  void Disarm(FdEvent *fde);
+
+  bool IsArmed(const FdEvent *fde) const;
+
+  // now_ms までに期限切れになった FdEvent を expired に追加する｡
+  //
+  // 期限切れになった FdEvent は次の tick で再度期限切れになるように登録し直す｡
+  // (Disarm() されるまで毎回通知される)
+  void RetrieveExpired(long now_ms, std::vector<FdEvent *> &expired);
+
+  // now_ms から次にタイマーの期限が来るまでの時間(ms)を返す｡
+  // 登録されているタイマーがなければ -1 を返す｡
+  //
+  // 上位の階層のタイマーは正確な期限ではなく､下位の階層に振り分け直す時刻を
+  // 期限とみなす｡ そのため実際の期限より早い時間を返すことはあるが､遅い時間は返さない｡
+  long GetTimeUntilNextExpire(long now_ms) const;
+
+  // 登録されている FdEvent の数
+  size_t Size() const;
+
+ private:
+  TimerWheel(const TimerWheel &rhs);
+  TimerWheel &operator=(const TimerWheel &rhs);
+
+  // fde->timer_expire を元に適切なスロットに繋ぐ
+  void Link(FdEvent *fde);
+  void Unlink(FdEvent *fde);
+
+  // 次に処理が必要な tick を返す｡ 登録されているタイマーがなければ -1 を返す｡
+  // 上位の階層は振り分け直す tick を返す｡ その間の tick のスロットは空である｡
+  long GetNextTick() const;
+
+  // 上位階層のスロットのタイマーを下位の階層に振り分け直す｡
+  // 振り分けたスロットのインデックスを返す｡
+  int Cascade(int level, int index);
+
+  static long ExpireOf(const FdEvent *fde);
+};
+
+}  // namespace server
+
+#endif
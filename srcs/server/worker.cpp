@@ -0,0 +1,257 @@
+#include "server/worker.hpp"
+
+#include <sys/prctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+
+#include "server/epoll.hpp"
+#include "server/event_loop.hpp"
+#include "server/loop_thread.hpp"
+#include "server/setup.hpp"
+#include "server/socket.hpp"
+#include "utils/log.hpp"
+#include "utils/signal.hpp"
+#include "utils/time.hpp"
+
+namespace server {
+
+namespace {
+
+// SIGCHLD を sigwait() で受け取るために何もしないハンドラーを設定する
+void HandleSigchld(int signal) {
+  (void)signal;
+}
+
+}  // namespace
+
+void RunWorker(const config::Config &config,
+               const std::vector<ListenSocket *> &shared_listen_socks) {
+  // listen socket を作成
+  std::vector<ListenSocket *> listen_socks = shared_listen_socks;
+  bool is_shared = !shared_listen_socks.empty();
+  if (!is_shared && OpenListenSockets(config, listen_socks).IsErr()) {
+    utils::PrintLog("[%d] server::OpenListenSockets() failed", getpid());
+    exit(kWorkerSetupFailureStatus);
+  }
+
+  if (config.GetWorkerThreads() > 1) {
+    RunLoopThreads(config, listen_socks, is_shared);
+  }
+
+  Epoll epoll(config.GetEpollEvents(), config.GetIsEdgeTriggered(),
+              config.GetEventBackend());
+  utils::PrintLog("[%d] event backend: %s", getpid(), epoll.GetBackendName());
+  RegisterListenSockets(epoll, listen_socks, NULL, is_shared);
+
+  StartEventLoop(epoll);
+  exit(EXIT_SUCCESS);
+}
+
+void RunLoopThreads(const config::Config &config,
+                    const std::vector<ListenSocket *> &listen_socks,
+                    bool is_shared) {
+  std::vector<LoopThread *> loops;
+  for (int i = 0; i < config.GetWorkerThreads(); ++i) {
+    loops.push_back(new LoopThread(config.GetEpollEvents(),
+                                   config.GetIsEdgeTriggered(),
+                                   config.GetEventBackend()));
+  }
+  utils::PrintLog("[%d] event backend: %s", getpid(),
+                  loops[0]->GetEpoll().GetBackendName());
+  ConnDispatcher dispatcher(loops, config.GetThreadBalancing());
+
+  // listen socket はメインスレッドのループに登録する
+  RegisterListenSockets(loops[0]->GetEpoll(), listen_socks, &dispatcher,
+                        is_shared);
+  for (size_t i = 1; i < loops.size(); ++i) {
+    if (loops[i]->Start().IsErr()) {
+      utils::PrintLog("[%d] failed to start loop thread", getpid());
+      exit(kWorkerSetupFailureStatus);
+    }
+  }
+
+  loops[0]->Run();
+  exit(EXIT_SUCCESS);
+}
+
+int RunMaster(const config::Config &config) {
+  Master master(config);
+  return master.Run();
+}
+
+Master::Master(const config::Config &config)
+    : config_(config),
+      workers_(config.GetWorkerProcesses(), -1),
+      spawned_at_(config.GetWorkerProcesses(), 0),
+      master_pid_(getpid()),
+      listen_socks_() {
+  sigemptyset(&signals_);
+  sigaddset(&signals_, SIGCHLD);
+  sigaddset(&signals_, SIGTERM);
+  sigaddset(&signals_, SIGINT);
+  sigaddset(&signals_, SIGUSR1);
+  sigemptyset(&old_mask_);
+}
+
+Master::~Master() {
+  for (std::vector<ListenSocket *>::const_iterator it = listen_socks_.begin();
+       it != listen_socks_.end(); ++it) {
+    delete *it;
+  }
+}
+
+int Master::Run() {
+  if (!utils::set_signal_handler(SIGCHLD, HandleSigchld, 0) ||
+      sigprocmask(SIG_BLOCK, &signals_, &old_mask_) < 0) {
+    utils::PrintLog("master: failed to set up signals");
+    return EXIT_FAILURE;
+  }
+
+  // listen socket を共有する場合はワーカーを起動する前に作成する
+  if (!config_.GetIsReusePort() &&
+      OpenListenSockets(config_, listen_socks_).IsErr()) {
+    utils::PrintLog("master: server::OpenListenSockets() failed");
+    return EXIT_FAILURE;
+  }
+
+  utils::PrintLog("master process %d starts %d workers", master_pid_,
+                  static_cast<int>(workers_.size()));
+  int status = EXIT_SUCCESS;
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (!SpawnWorker(i)) {
+      status = EXIT_FAILURE;
+      break;
+    }
+  }
+
+  while (status == EXIT_SUCCESS) {
+    int signal;
+    if (sigwait(&signals_, &signal) != 0) {
+      continue;
+    }
+    if (signal == SIGUSR1) {
+      KillWorkers(SIGUSR1);
+      continue;
+    }
+    if (signal != SIGCHLD) {
+      utils::PrintLog("master: received signal %d, shutting down", signal);
+      break;
+    }
+    if (!ReapWorkers()) {
+      status = EXIT_FAILURE;
+      break;
+    }
+    // 終了したワーカーを起動し直す
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      if (workers_[i] != -1) {
+        continue;
+      }
+      long elapsed = utils::GetCurrentTimeMs() - spawned_at_[i];
+      if (elapsed < kRespawnIntervalMs) {
+        // 起動直後に落ち続ける場合に fork し続けないようにする
+        usleep((kRespawnIntervalMs - elapsed) * 1000);
+      }
+      if (!SpawnWorker(i)) {
+        status = EXIT_FAILURE;
+        break;
+      }
+    }
+  }
+
+  KillWorkers(SIGTERM);
+  WaitWorkers();
+  return status;
+}
+
+bool Master::SpawnWorker(size_t worker_id) {
+  pid_t pid = fork();
+  if (pid < 0) {
+    utils::PrintLog("master: failed to fork worker %d",
+                    static_cast<int>(worker_id));
+    return false;
+  }
+  if (pid == 0) {
+    // マスターが終了したらワーカーも終了する
+    if (prctl(PR_SET_PDEATHSIG, SIGTERM) < 0 || getppid() != master_pid_) {
+      exit(EXIT_FAILURE);
+    }
+    utils::set_signal_handler(SIGCHLD, SIG_DFL, 0);
+    sigprocmask(SIG_SETMASK, &old_mask_, NULL);
+    RunWorker(config_, listen_socks_);
+  }
+  workers_[worker_id] = pid;
+  spawned_at_[worker_id] = utils::GetCurrentTimeMs();
+  utils::PrintLog("master: worker %d started (pid %d)",
+                  static_cast<int>(worker_id), pid);
+  return true;
+}
+
+bool Master::ReapWorkers() {
+  bool should_respawn = true;
+  int wstatus;
+  pid_t pid;
+  while ((pid = waitpid(-1, &wstatus, WNOHANG)) > 0) {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      if (workers_[i] != pid) {
+        continue;
+      }
+      workers_[i] = -1;
+      if (WIFEXITED(wstatus) &&
+          WEXITSTATUS(wstatus) == kWorkerSetupFailureStatus) {
+        utils::PrintLog("master: worker %d (pid %d) failed to set up",
+                        static_cast<int>(i), pid);
+        should_respawn = false;
+      } else if (WIFSIGNALED(wstatus)) {
+        utils::PrintLog("master: worker %d (pid %d) killed by signal %d",
+                        static_cast<int>(i), pid, WTERMSIG(wstatus));
+      } else {
+        utils::PrintLog("master: worker %d (pid %d) exited with status %d",
+                        static_cast<int>(i), pid, WEXITSTATUS(wstatus));
+      }
+    }
+  }
+  return should_respawn;
+}
+
+void Master::KillWorkers(int signal) {
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i] != -1) {
+      kill(workers_[i], signal);
+    }
+  }
+}
+
+void Master::WaitWorkers() {
+  while (CountAliveWorkers() > 0) {
+    int wstatus;
+    pid_t pid = waitpid(-1, &wstatus, 0);
+    if (pid < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      if (workers_[i] == pid) {
+        workers_[i] = -1;
+      }
+    }
+  }
+}
+
+size_t Master::CountAliveWorkers() const {
+  size_t count = 0;
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    if (workers_[i] != -1) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+}  // namespace server
@@ -0,0 +1,100 @@
+#ifndef SERVER_WORKER_HPP_
+#define SERVER_WORKER_HPP_
+
+#include <sys/types.h>
+
+#include <csignal>
+#include <vector>
+
+#include "config/config.hpp"
+
+namespace server {
+
+class ListenSocket;
+
+// ワーカーが listen socket の作成などの準備に失敗した場合の終了ステータス｡
+// 起動し直しても失敗するだけなので､マスターはワーカーを起動し直さずに終了する｡
+const int kWorkerSetupFailureStatus = 2;
+
+// Epoll を作成して listen socket を登録し､イベントループを回す｡
+// worker_processes が1の場合はこれを直接呼ぶ｡ 戻らない｡
+//
+// shared_listen_socks はマスターが作成し､他のワーカーと共有する listen socket｡
+// 空の場合はワーカーが listen socket を作成する｡
+void RunWorker(const config::Config &config,
+               const std::vector<ListenSocket *> &shared_listen_socks =
+                   std::vector<ListenSocket *>());
+
+// config.GetWorkerThreads() の数だけ LoopThread を作成し､
+// それぞれのスレッドでイベントループを回す｡
+// listen socket はメインスレッドのループが持ち､
+// accept した接続は ConnDispatcher で各スレッドに振り分ける｡ 戻らない｡
+//
+// is_shared が true なら listen_socks を EPOLLEXCLUSIVE で監視する｡
+void RunLoopThreads(const config::Config &config,
+                    const std::vector<ListenSocket *> &listen_socks,
+                    bool is_shared);
+
+// config.GetWorkerProcesses() の数だけワーカープロセスを起動して監視する｡
+//
+// 異常終了したワーカーは起動し直す｡
+// SIGTERM, SIGINT を受け取るとワーカーに SIGTERM を送り､
+// 全てのワーカーの終了を待ってから返る｡
+// SIGUSR1 はワーカーに転送する｡
+// 返り値はプロセスの終了ステータス｡
+int RunMaster(const config::Config &config);
+
+class Master {
+ private:
+  // 短い間隔で異常終了を繰り返すワーカーを起動し直す前に待つ時間
+  static const long kRespawnIntervalMs = 1000;
+
+  const config::Config &config_;
+
+  // workers_[<worker_id>] = <pid>
+  // 終了したワーカーは -1
+  std::vector<pid_t> workers_;
+
+  // ワーカーを起動した時刻(ms)
+  std::vector<long> spawned_at_;
+
+  // マスターが sigwait() で受け取るシグナル
+  sigset_t signals_;
+
+  // Run() を呼ぶ前のシグナルマスク｡ ワーカーではこれに戻す｡
+  sigset_t old_mask_;
+
+  pid_t master_pid_;
+
+  // reuse_port が off の場合にワーカーで共有する listen socket
+  std::vector<ListenSocket *> listen_socks_;
+
+ public:
+  explicit Master(const config::Config &config);
+  ~Master();
+
+  int Run();
+
+ private:
+  Master(const Master &rhs);
+  Master &operator=(const Master &rhs);
+
+  // worker_id のワーカーを起動する
+  bool SpawnWorker(size_t worker_id);
+
+  // 終了したワーカーを回収する｡
+  // 起動し直すべきでないワーカーがいた場合は false を返す｡
+  bool ReapWorkers();
+
+  // 全てのワーカーに signal を送る
+  void KillWorkers(int signal);
+
+  // 全てのワーカーの終了を待つ
+  void WaitWorkers();
+
+  size_t CountAliveWorkers() const;
+};
+
+}  // namespace server
+
+#endif
@@ -0,0 +1,72 @@
+#include "utils/BufferPool.hpp"
+
+namespace utils {
+
+namespace {
+
+// フリーリストの要素｡ 解放された領域の先頭に置く｡
+struct FreeNode {
+  FreeNode *next;
+};
+
+// free_lists[<区分>]
+__thread FreeNode *free_lists[BufferPool::kClassNum];
+__thread size_t free_nums[BufferPool::kClassNum];
+
+}  // namespace
+
+const size_t BufferPool::kMaxFreeNum[BufferPool::kClassNum] = {256, 64, 16};
+
+Byte *BufferPool::Allocate(size_t size, size_t *capacity) {
+  int cls = GetClass(size);
+  if (cls == kClassNum) {
+    *capacity = size;
+    return new Byte[size];
+  }
+  *capacity = kMinClassSize << (2 * cls);
+  FreeNode *node = free_lists[cls];
+  if (node == NULL) {
+    return new Byte[*capacity];
+  }
+  free_lists[cls] = node->next;
+  --free_nums[cls];
+  return reinterpret_cast<Byte *>(node);
+}
+
+void BufferPool::Free(Byte *buf, size_t capacity) {
+  if (buf == NULL) {
+    return;
+  }
+  int cls = GetClass(capacity);
+  if (cls == kClassNum || (kMinClassSize << (2 * cls)) != capacity ||
+      free_nums[cls] >= kMaxFreeNum[cls]) {
+    delete[] buf;
+    return;
+  }
+  // new Byte[] で確保した領域はポインタを置けるようにアラインされている
+  FreeNode *node = reinterpret_cast<FreeNode *>(buf);
+  node->next = free_lists[cls];
+  free_lists[cls] = node;
+  ++free_nums[cls];
+}
+
+size_t BufferPool::GetFreeNum(size_t capacity) {
+  int cls = GetClass(capacity);
+  if (cls == kClassNum) {
+    return 0;
+  }
+  return free_nums[cls];
+}
+
+int BufferPool::GetClass(size_t size) {
+  size_t class_size = kMinClassSize;
+  for (int cls = 0; cls < kClassNum; ++cls) {
+    if (size <= class_size) {
+      return cls;
+    }
+    class_size <<= 2;
+  }
+  return kClassNum;
+}
+
+}  // namespace utils
@@ -0,0 +1,45 @@
+#ifndef BUFFERPOOL_HPP_
+#define BUFFERPOOL_HPP_
+
+#include <cstddef>
+
+#include "utils/ByteVector.hpp"
+
+namespace utils {
+
+// I/O バッファ用の領域をサイズ区分(4KB, 16KB, 64KB)ごとに使い回す｡
+//
+// 解放された領域はスレッドごとのフリーリストに入れておき､次に同じ区分の
+// 領域が必要になった時に返す｡ フリーリストはスレッドローカルなのでロックは
+// 取らない｡ 別のスレッドで解放された領域はそのスレッドのフリーリストに入る｡
+// 一番大きい区分より大きい領域は使い回さずにそのまま new/delete する｡
+class BufferPool {
+ public:
+  // 区分の数と一番小さい区分のサイズ｡ 区分は4倍ずつ大きくなる｡
+  static const int kClassNum = 3;
+  static const size_t kMinClassSize = 4 * 1024;
+  static const size_t kMaxClassSize = kMinClassSize << (2 * (kClassNum - 1));
+
+  // size バイト以上の領域を返す｡ 実際に確保したサイズを *capacity に入れる｡
+  static Byte *Allocate(size_t size, size_t *capacity);
+  // Allocate() で確保した領域を返却する｡ capacity は Allocate() で
+  // 受け取ったサイズ｡
+  static void Free(Byte *buf, size_t capacity);
+
+  // このスレッドのフリーリストに入っている領域の数
+  static size_t GetFreeNum(size_t capacity);
+
+ private:
+  // 区分ごとにフリーリストに入れておく領域の最大数｡
+  // 1スレッドあたり最大 4KB*256 + 16KB*64 + 64KB*16 = 3MB を保持する｡
+  static const size_t kMaxFreeNum[kClassNum];
+
+  // size が入る一番小さい区分を返す｡ 入らない場合は kClassNum｡
+  static int GetClass(size_t size);
+
+  BufferPool();
+};
+
+}  // namespace utils
+
+#endif
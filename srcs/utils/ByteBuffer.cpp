@@ -0,0 +1,177 @@
+#include "utils/ByteBuffer.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace utils {
+
+ByteBuffer::ByteBuffer()
+    : data_(NULL), capacity_(0), read_pos_(0), write_pos_(0) {}
+
+ByteBuffer::ByteBuffer(const std::string &s)
+    : data_(NULL), capacity_(0), read_pos_(0), write_pos_(0) {
+  AppendDataToBuffer(s);
+}
+
+ByteBuffer::ByteBuffer(const ByteBuffer &src)
+    : data_(NULL), capacity_(0), read_pos_(0), write_pos_(0) {
+  *this = src;
+}
+
+ByteBuffer::~ByteBuffer() {
+  BufferPool::Free(data_, capacity_);
+}
+
+ByteBuffer &ByteBuffer::operator=(const ByteBuffer &rhs) {
+  if (this != &rhs) {
+    clear();
+    AppendDataToBuffer(rhs.data(), rhs.size());
+  }
+  return *this;
+}
+
+size_t ByteBuffer::size() const {
+  return write_pos_ - read_pos_;
+}
+
+bool ByteBuffer::empty() const {
+  return write_pos_ == read_pos_;
+}
+
+const Byte *ByteBuffer::data() const {
+  return data_ + read_pos_;
+}
+
+const Byte *ByteBuffer::begin() const {
+  return data_ + read_pos_;
+}
+
+const Byte *ByteBuffer::end() const {
+  return data_ + write_pos_;
+}
+
+const Byte &ByteBuffer::operator[](size_t pos) const {
+  assert(pos < size());
+  return data_[read_pos_ + pos];
+}
+
+void ByteBuffer::clear() {
+  BufferPool::Free(data_, capacity_);
+  data_ = NULL;
+  capacity_ = 0;
+  read_pos_ = 0;
+  write_pos_ = 0;
+}
+
+void ByteBuffer::ReleaseIfEmpty() {
+  if (empty()) {
+    clear();
+  }
+}
+
+size_t ByteBuffer::GetWritableSize() const {
+  return capacity_ - write_pos_;
+}
+
+Byte *ByteBuffer::PrepareWrite(size_t size) {
+  if (GetWritableSize() < size) {
+    Reserve(size);
+  }
+  return data_ + write_pos_;
+}
+
+void ByteBuffer::CommitWrite(size_t size) {
+  assert(size <= GetWritableSize());
+  write_pos_ += size;
+}
+
+void ByteBuffer::EraseHead(size_t size) {
+  assert(size <= this->size());
+  read_pos_ += size;
+  if (read_pos_ == write_pos_) {
+    // 空になったら領域を返す
+    clear();
+  }
+}
+
+bool ByteBuffer::CompareHead(const std::string &str) const {
+  if (size() < str.size())
+    return false;
+  return std::memcmp(data(), str.data(), str.size()) == 0;
+}
+
+Result<size_t> ByteBuffer::FindString(const std::string &str,
+                                      size_t start_pos) const {
+  if (start_pos > size() || str.size() > size() - start_pos) {
+    return Error();
+  }
+  const void *found = memmem(data() + start_pos, size() - start_pos,
+                             str.data(), str.size());
+  if (found == NULL) {
+    return Error();
+  }
+  return static_cast<const Byte *>(found) - data();
+}
+
+size_t ByteBuffer::GetResumePos(const std::string &str) const {
+  if (str.empty() || size() < str.size()) {
+    return 0;
+  }
+  return size() - str.size() + 1;
+}
+
+std::string ByteBuffer::CutSubstrBeforePos(size_t pos) {
+  std::string res = SubstrBeforePos(pos);
+  EraseHead(pos);
+  return res;
+}
+
+std::string ByteBuffer::SubstrBeforePos(size_t pos) const {
+  assert(pos <= size());
+  return std::string(begin(), begin() + pos);
+}
+
+void ByteBuffer::AppendDataToBuffer(const Byte *buf, size_t size) {
+  if (size == 0)
+    return;
+  std::memcpy(PrepareWrite(size), buf, size);
+  CommitWrite(size);
+}
+
+void ByteBuffer::AppendDataToBuffer(const ByteVector &vec) {
+  AppendDataToBuffer(vec.data(), vec.size());
+}
+
+void ByteBuffer::AppendDataToBuffer(const std::string &str) {
+  AppendDataToBuffer(reinterpret_cast<const Byte *>(str.data()), str.size());
+}
+
+void ByteBuffer::Reserve(size_t size) {
+  const size_t data_size = this->size();
+  // 未読のデータが半分以下なら詰めるだけで済ませる｡
+  // 詰めた後は半分以上空いているので memmove は償却 O(1) になる｡
+  if (data_size + size <= capacity_ && data_size <= capacity_ / 2) {
+    std::memmove(data_, data_ + read_pos_, data_size);
+    read_pos_ = 0;
+    write_pos_ = data_size;
+    return;
+  }
+
+  // 確保し直した後も未読のデータが半分以下になるようにする
+  size_t new_capacity = kMinCapacity;
+  while (new_capacity < data_size + size || new_capacity / 2 < data_size) {
+    new_capacity *= 2;
+  }
+  // 区分のサイズに切り上げられるので new_capacity より大きくなることがある
+  Byte *new_data = BufferPool::Allocate(new_capacity, &new_capacity);
+  if (data_size > 0) {
+    std::memcpy(new_data, data_ + read_pos_, data_size);
+  }
+  BufferPool::Free(data_, capacity_);
+  data_ = new_data;
+  capacity_ = new_capacity;
+  read_pos_ = 0;
+  write_pos_ = data_size;
+}
+
+}  // namespace utils
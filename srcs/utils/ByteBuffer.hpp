@@ -0,0 +1,89 @@
+#ifndef BYTEBUFFER_HPP_
+#define BYTEBUFFER_HPP_
+
+#include <cstddef>
+#include <string>
+
+#include "result/result.hpp"
+#include "utils/BufferPool.hpp"
+#include "utils/ByteVector.hpp"
+
+namespace utils {
+
+using namespace result;
+
+// 先頭から読み込んで消費していくバッファ｡
+//
+// 読み込み位置(read_pos_)と書き込み位置(write_pos_)を持ち､
+// EraseHead() は read_pos_ を進めるだけなので O(1) で消費できる｡
+// (ByteVector::EraseHead() は残りのデータを全て memmove する)
+// 消費済みの領域は末尾に書き込む領域が足りなくなった時にまとめて詰める｡
+//
+// PrepareWrite() で末尾の空き領域を確保し､そこに read(2) などで直接書き込んで
+// CommitWrite() で書き込んだサイズを確定させる｡
+//
+// 領域は BufferPool から借り､空になったら返す｡ (待機中の keep-alive 接続が
+// 空のバッファを持ち続けないようにする)
+class ByteBuffer {
+ private:
+  Byte *data_;
+  size_t capacity_;
+  size_t read_pos_;
+  size_t write_pos_;
+
+  // 最初に確保するサイズ
+  static const size_t kMinCapacity = BufferPool::kMinClassSize;
+
+ public:
+  ByteBuffer();
+  ByteBuffer(const std::string &s);
+  ByteBuffer(const ByteBuffer &src);
+  ~ByteBuffer();
+
+  ByteBuffer &operator=(const ByteBuffer &rhs);
+
+  // 未読のデータ
+  size_t size() const;
+  bool empty() const;
+  const Byte *data() const;
+  const Byte *begin() const;
+  const Byte *end() const;
+  const Byte &operator[](size_t pos) const;
+  // データを捨てて領域を BufferPool に返す
+  void clear();
+  // 空の場合は領域を BufferPool に返す｡
+  // PrepareWrite() した後に何も書き込まなかった場合に使う｡
+  void ReleaseIfEmpty();
+
+  // 未読のデータの後ろに書き込める空き領域のサイズ
+  size_t GetWritableSize() const;
+
+  // 末尾に size バイト以上の空き領域を確保し､その先頭を返す｡
+  // 返したポインタは次に書き込み系の関数を呼ぶまで有効｡
+  Byte *PrepareWrite(size_t size);
+  // PrepareWrite() で確保した領域に size バイト書き込んだことにする
+  void CommitWrite(size_t size);
+
+  void EraseHead(size_t size);
+  bool CompareHead(const std::string &str) const;
+  // start_pos 以降で最初に str が現れる位置を返す
+  Result<size_t> FindString(const std::string &str,
+                            size_t start_pos = 0) const;
+  // str が見つからなかった後､次に FindString() を始める位置を返す｡
+  // 末尾に str の一部だけが届いている場合があるので､その分だけ戻す｡
+  size_t GetResumePos(const std::string &str) const;
+  std::string CutSubstrBeforePos(size_t pos);
+  std::string SubstrBeforePos(size_t pos) const;
+  void AppendDataToBuffer(const Byte *buf, size_t size);
+  void AppendDataToBuffer(const ByteVector &vec);
+  void AppendDataToBuffer(const std::string &str);
+
+ private:
+  // 末尾に size バイトの空き領域を作る｡
+  // 消費済みの領域を詰めるだけで足りる場合は確保し直さない｡
+  void Reserve(size_t size);
+};
+
+}  // namespace utils
+
+#endif
@@ -4,9 +4,7 @@
 
 namespace utils {
 
-ByteVector::ByteVector() {
-  reserve(kReserveSize_);
-}
+ByteVector::ByteVector() {}
 ByteVector::ByteVector(ByteVector::const_iterator start,
                        ByteVector::const_iterator end)
     : std::vector<Byte>(start, end) {}
@@ -35,19 +33,17 @@ bool ByteVector::CompareHead(const std::string& str) const {
   return std::strncmp(GetReinterpretedData(), str.c_str(), str.size()) == 0;
 }
 
-Result<size_t> ByteVector::FindString(const std::string& str) const {
-  if (str.size() > size()) {
+Result<size_t> ByteVector::FindString(const std::string& str,
+                                      size_t start_pos) const {
+  if (start_pos > size() || str.size() > size() - start_pos) {
     return Error();
   }
-  for (size_t i = 0; i < (size() - str.size() + 1); i++) {
-    for (size_t j = 0; j < str.size(); j++) {
-      if (str[j] != this->at(i + j))
-        break;
-      if (j + 1 == str.size())
-        return i;
-    }
+  const void* found = memmem(data() + start_pos, size() - start_pos,
+                             str.data(), str.size());
+  if (found == NULL) {
+    return Error();
   }
-  return Error();
+  return static_cast<const Byte*>(found) - data();
 }
 
 std::string ByteVector::CutSubstrBeforePos(size_t pos) {
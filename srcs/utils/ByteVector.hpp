@@ -25,15 +25,15 @@ class ByteVector : public std::vector<Byte> {
 
   void EraseHead(size_t size);
   bool CompareHead(const std::string& str) const;
-  Result<unsigned long> FindString(const std::string& str) const;
+  // start_pos 以降で最初に str が現れる位置を返す
+  Result<unsigned long> FindString(const std::string& str,
+                                   size_t start_pos = 0) const;
   std::string CutSubstrBeforePos(size_t pos);
   std::string SubstrBeforePos(size_t pos) const;
   void AppendDataToBuffer(const Byte* buf, size_t size);
   void AppendDataToBuffer(const ByteVector& vec);
 
  private:
-  static const size_type kReserveSize_ = 2 * 1024;  // 2KB
-
   const char* GetReinterpretedData() const;
 };
 
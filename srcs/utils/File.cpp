@@ -111,13 +111,13 @@ std::string File::GetFileSizeStr() const {
 
 std::string File::GetDateStr(const std::string fmt) const {
   char buf[256];
-  struct tm* tm;
+  struct tm tm;
 
   assert(file_type_ != kNotExist);
 
-  // tm = gmtime(&stat_.st_atime);
-  tm = gmtime(&stat_.st_mtime);
-  strftime(buf, 256, fmt.c_str(), tm);
+  // 複数のスレッドから呼ばれるので gmtime_r を使う
+  gmtime_r(&stat_.st_mtime, &tm);
+  strftime(buf, 256, fmt.c_str(), &tm);
   return std::string(buf);
 }
 
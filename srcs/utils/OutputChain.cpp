@@ -0,0 +1,349 @@
+#include "utils/OutputChain.hpp"
+
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+
+namespace utils {
+
+namespace {
+// これより小さいバイト列は末尾の owned セグメントにコピーして繋げる｡
+// (CGI の出力などで小さいセグメントが大量にできないようにする)
+const size_t kCoalesceSize = 4 * 1024;
+}  // namespace
+
+// ========================================================================
+// SharedBlob
+
+SharedBlob::SharedBlob(const std::string &data) : data_(data), ref_count_(1) {}
+
+SharedBlob::~SharedBlob() {}
+
+const Byte *SharedBlob::data() const {
+  return reinterpret_cast<const Byte *>(data_.data());
+}
+
+size_t SharedBlob::size() const {
+  return data_.size();
+}
+
+void SharedBlob::Ref() {
+  __sync_fetch_and_add(&ref_count_, 1);
+}
+
+void SharedBlob::Unref() {
+  if (__sync_sub_and_fetch(&ref_count_, 1) == 0) {
+    delete this;
+  }
+}
+
+// ========================================================================
+// OutputSink
+
+OutputSink::~OutputSink() {}
+
+// ========================================================================
+// FdOutputSink
+
+FdOutputSink::FdOutputSink(int fd) : fd_(fd) {}
+
+FdOutputSink::~FdOutputSink() {}
+
+Result<size_t> FdOutputSink::Writev(const iovec *iov, int iov_num,
+                                    bool has_more) {
+  ssize_t write_res;
+  if (has_more) {
+    msghdr msg = msghdr();
+    msg.msg_iov = const_cast<iovec *>(iov);
+    msg.msg_iovlen = iov_num;
+    write_res = sendmsg(fd_, &msg, MSG_MORE);
+  } else {
+    write_res = writev(fd_, iov, iov_num);
+  }
+  if (write_res < 0) {
+    return Error();
+  }
+  return static_cast<size_t>(write_res);
+}
+
+Result<size_t> FdOutputSink::SendFile(int in_fd, off_t offset, size_t size) {
+  ssize_t send_res = sendfile(fd_, in_fd, &offset, size);
+  if (send_res < 0) {
+    return Error();
+  }
+  return static_cast<size_t>(send_res);
+}
+
+// ========================================================================
+// OutputChain
+
+OutputChain::OutputChain()
+    : segments_(),
+      size_(0),
+      file_buffer_(),
+      use_sendfile_(false),
+      is_sendfile_failed_(false),
+      use_msg_more_(false) {}
+
+OutputChain::~OutputChain() {
+  clear();
+}
+
+void OutputChain::SetUseSendfile(bool use_sendfile) {
+  use_sendfile_ = use_sendfile;
+}
+
+void OutputChain::SetUseMsgMore(bool use_msg_more) {
+  use_msg_more_ = use_msg_more;
+}
+
+size_t OutputChain::size() const {
+  return size_;
+}
+
+bool OutputChain::empty() const {
+  return size_ == 0;
+}
+
+void OutputChain::clear() {
+  while (!segments_.empty()) {
+    PopFront();
+  }
+  file_buffer_.clear();
+  size_ = 0;
+}
+
+void OutputChain::AppendBytes(ByteVector &bytes) {
+  if (bytes.empty()) {
+    return;
+  }
+  size_ += bytes.size();
+  if (!segments_.empty() && segments_.back().type == kOwned &&
+      bytes.size() < kCoalesceSize) {
+    Segment &tail = segments_.back();
+    tail.owned->AppendDataToBuffer(bytes);
+    tail.size += bytes.size();
+  } else {
+    Segment segment;
+    segment.type = kOwned;
+    segment.owned = new ByteVector();
+    segment.owned->swap(bytes);
+    segment.shared = NULL;
+    segment.fd = -1;
+    segment.offset = 0;
+    segment.size = segment.owned->size();
+    segments_.push_back(segment);
+  }
+  bytes.clear();
+}
+
+void OutputChain::AppendBytes(const std::string &str) {
+  ByteVector bytes(str);
+  AppendBytes(bytes);
+}
+
+void OutputChain::AppendShared(SharedBlob *blob) {
+  if (blob->size() == 0) {
+    return;
+  }
+  blob->Ref();
+  Segment segment;
+  segment.type = kShared;
+  segment.owned = NULL;
+  segment.shared = blob;
+  segment.fd = -1;
+  segment.offset = 0;
+  segment.size = blob->size();
+  segments_.push_back(segment);
+  size_ += segment.size;
+}
+
+void OutputChain::AppendFile(int fd, off_t offset, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  Segment segment;
+  segment.type = kFile;
+  segment.owned = NULL;
+  segment.shared = NULL;
+  segment.fd = fd;
+  segment.offset = offset;
+  segment.size = size;
+  segments_.push_back(segment);
+  size_ += size;
+}
+
+void OutputChain::AppendChain(OutputChain &chain) {
+  assert(!chain.HasFile());
+  while (!chain.segments_.empty()) {
+    Segment &segment = chain.segments_.front();
+    if (segment.type == kOwned) {
+      // 書き込み済みの部分は移さない
+      if (segment.offset > 0) {
+        segment.owned->EraseHead(segment.offset);
+        segment.offset = 0;
+      }
+      AppendBytes(*segment.owned);
+    } else {
+      // 参照カウントはそのまま移す
+      segments_.push_back(segment);
+      size_ += segment.size;
+      segment.shared = NULL;
+    }
+    chain.size_ -= segment.size;
+    segment.size = 0;
+    chain.PopFront();
+  }
+}
+
+bool OutputChain::HasFile() const {
+  for (std::deque<Segment>::const_iterator it = segments_.begin();
+       it != segments_.end(); ++it) {
+    if (it->type == kFile) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Result<size_t> OutputChain::WriteTo(int fd, size_t max_size) {
+  FdOutputSink sink(fd);
+  return WriteTo(sink, max_size);
+}
+
+Result<size_t> OutputChain::WriteTo(OutputSink &sink, size_t max_size) {
+  iovec iov[kMaxIovecs];
+  int iov_num = 0;
+  size_t total = 0;
+  bool is_followed_by_sendfile = false;
+  for (std::deque<Segment>::const_iterator it = segments_.begin();
+       it != segments_.end() && iov_num < kMaxIovecs && total < max_size;
+       ++it) {
+    if (it->type == kFile && use_sendfile_ && !is_sendfile_failed_ &&
+        file_buffer_.empty()) {
+      // 前にあるセグメントを書き込み終わってから sendfile する
+      if (iov_num > 0) {
+        is_followed_by_sendfile = true;
+        break;
+      }
+      return SendFile(sink, max_size);
+    }
+    const Byte *base;
+    size_t len;
+    if (it->type == kOwned) {
+      base = it->owned->data() + it->offset;
+      len = it->size;
+    } else if (it->type == kShared) {
+      base = it->shared->data() + it->offset;
+      len = it->size;
+    } else {
+      if (file_buffer_.empty() && FillFileBuffer(*it).IsErr()) {
+        return Error();
+      }
+      base = file_buffer_.data();
+      len = file_buffer_.size();
+    }
+    if (len > max_size - total) {
+      len = max_size - total;
+    }
+    iov[iov_num].iov_base = const_cast<Byte *>(base);
+    iov[iov_num].iov_len = len;
+    ++iov_num;
+    total += len;
+    // file_buffer_ には先頭の file セグメントのデータしか入らない
+    if (it->type == kFile) {
+      break;
+    }
+  }
+  if (iov_num == 0) {
+    return 0;
+  }
+
+  // すぐ後に sendfile で送るデータがあるので小さいセグメントで送らせない
+  Result<size_t> write_res =
+      sink.Writev(iov, iov_num, is_followed_by_sendfile && use_msg_more_);
+  if (write_res.IsErr()) {
+    return Error();
+  }
+  Consume(write_res.Ok());
+  return write_res.Ok();
+}
+
+Result<size_t> OutputChain::SendFile(OutputSink &sink, size_t max_size) {
+  const Segment &segment = segments_.front();
+  size_t send_size = segment.size < max_size ? segment.size : max_size;
+  Result<size_t> send_res =
+      sink.SendFile(segment.fd, segment.offset, send_size);
+  if (send_res.IsErr()) {
+    if (errno == EINVAL || errno == ENOSYS) {
+      // sendfile に対応していないファイルか sink なので読み込んで書き込む
+      is_sendfile_failed_ = true;
+      return WriteTo(sink, max_size);
+    }
+    return Error();
+  }
+  if (send_res.Ok() == 0) {
+    // 繋げた後にファイルが小さくなった
+    errno = EIO;
+    return Error("file is truncated");
+  }
+  Consume(send_res.Ok());
+  return send_res.Ok();
+}
+
+Result<void> OutputChain::FillFileBuffer(const Segment &segment) {
+  size_t read_size =
+      segment.size < kFileReadSize ? segment.size : kFileReadSize;
+  ssize_t read_res = pread(segment.fd, file_buffer_.PrepareWrite(read_size),
+                           read_size, segment.offset);
+  if (read_res < 0) {
+    return Error();
+  }
+  if (read_res == 0) {
+    // 繋げた後にファイルが小さくなった
+    errno = EIO;
+    return Error("file is truncated");
+  }
+  file_buffer_.CommitWrite(read_res);
+  return Result<void>();
+}
+
+void OutputChain::Consume(size_t size) {
+  while (size > 0) {
+    assert(!segments_.empty());
+    Segment &segment = segments_.front();
+    size_t consumed = size < segment.size ? size : segment.size;
+    // sendfile で送った場合は file_buffer_ は空
+    if (segment.type == kFile && !file_buffer_.empty()) {
+      file_buffer_.EraseHead(consumed);
+    }
+    segment.offset += consumed;
+    segment.size -= consumed;
+    size_ -= consumed;
+    size -= consumed;
+    if (segment.size == 0) {
+      PopFront();
+    }
+  }
+}
+
+void OutputChain::PopFront() {
+  Segment &segment = segments_.front();
+  if (segment.type == kOwned) {
+    delete segment.owned;
+  } else if (segment.type == kShared) {
+    // AppendChain() で移した場合は NULL
+    if (segment.shared != NULL) {
+      segment.shared->Unref();
+    }
+  } else {
+    file_buffer_.clear();
+  }
+  size_ -= segment.size;
+  segments_.pop_front();
+}
+
+}  // namespace utils
@@ -0,0 +1,173 @@
+#ifndef OUTPUTCHAIN_HPP_
+#define OUTPUTCHAIN_HPP_
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+#include "result/result.hpp"
+#include "utils/ByteBuffer.hpp"
+#include "utils/ByteVector.hpp"
+
+namespace utils {
+
+using namespace result;
+
+// 複数の OutputChain から共有される変更されないバイト列｡
+// 参照カウントは __sync_* で操作するので別のスレッドから共有しても良い｡
+class SharedBlob {
+ private:
+  const std::string data_;
+  long ref_count_;
+
+ public:
+  // 参照カウント1で作成する
+  explicit SharedBlob(const std::string &data);
+
+  const Byte *data() const;
+  size_t size() const;
+
+  void Ref();
+  // 参照カウントが0になったら delete する
+  void Unref();
+
+ private:
+  ~SharedBlob();
+  SharedBlob();
+  SharedBlob(const SharedBlob &rhs);
+  SharedBlob &operator=(const SharedBlob &rhs);
+};
+
+// OutputChain の書き込み先
+class OutputSink {
+ public:
+  virtual ~OutputSink();
+
+  // writev(2) と同様に書き込み､書き込めたバイト数を返す｡
+  // has_more が true なら続けて書き込むデータがあるので､
+  // ソケットでは MSG_MORE を付けて小さいセグメントで送らせない｡
+  virtual Result<size_t> Writev(const iovec *iov, int iov_num,
+                                bool has_more) = 0;
+
+  // sendfile(2) と同様に in_fd の [offset, offset + size) を書き込む｡
+  // 対応していない場合は errno を EINVAL にしてエラーを返す｡
+  virtual Result<size_t> SendFile(int in_fd, off_t offset, size_t size) = 0;
+};
+
+// fd に直接書き込む OutputSink
+class FdOutputSink : public OutputSink {
+ private:
+  const int fd_;
+
+ public:
+  explicit FdOutputSink(int fd);
+  virtual ~FdOutputSink();
+
+  virtual Result<size_t> Writev(const iovec *iov, int iov_num, bool has_more);
+  virtual Result<size_t> SendFile(int in_fd, off_t offset, size_t size);
+};
+
+// ソケットに書き込むデータを順番に保持する｡
+//
+// データはコピーせずに以下のセグメントとして繋げていき､
+// WriteTo() で writev(2) を使ってまとめて書き込む｡
+//   owned:  OutputChain が所有するバイト列 (swap で受け取る)
+//   shared: SharedBlob への参照
+//   file:   ファイルの範囲｡ fd は所有しない｡
+//
+// file のセグメントは sendfile(2) で送る｡ sendfile を使わない場合や
+// 使えないファイルの場合は書き込む直前に kFileReadSize ずつ読み込み､
+// 前にあるセグメントと一緒に writev する｡
+// SetUseMsgMore(true) の場合､sendfile の前のセグメントは MSG_MORE を付けて
+// sendmsg(2) で書き込み､ファイルの先頭と同じ TCP セグメントで送らせる｡
+class OutputChain {
+ private:
+  enum ESegmentType { kOwned, kShared, kFile };
+
+  struct Segment {
+    ESegmentType type;
+    ByteVector *owned;
+    SharedBlob *shared;
+    int fd;
+    // owned, shared では書き込み済みのバイト数､
+    // file ではまだ書き込んでいない部分の先頭のファイルオフセット
+    off_t offset;
+    // まだ書き込んでいないバイト数
+    size_t size;
+  };
+
+  std::deque<Segment> segments_;
+  size_t size_;
+
+  // 先頭の file セグメントから読み込んだデータ
+  ByteBuffer file_buffer_;
+
+  // file セグメントを sendfile(2) で送るか
+  bool use_sendfile_;
+  // sendfile(2) が使えなかったか｡ 以降は読み込んでから書き込む｡
+  bool is_sendfile_failed_;
+
+  // sendfile(2) の前のセグメントを MSG_MORE を付けて書き込むか｡
+  // fd がソケットの場合のみ使える｡
+  bool use_msg_more_;
+
+  // 1回の writev(2) で使う iovec の最大数
+  static const int kMaxIovecs = 64;
+
+ public:
+  // file セグメントを1回に読み込むサイズ
+  static const size_t kFileReadSize = 64 * 1024;
+
+  OutputChain();
+  ~OutputChain();
+
+  void SetUseSendfile(bool use_sendfile);
+  void SetUseMsgMore(bool use_msg_more);
+
+  // まだ書き込んでいないバイト数
+  size_t size() const;
+  bool empty() const;
+  void clear();
+
+  // bytes の中身を swap で受け取る｡ bytes は空になる｡
+  void AppendBytes(ByteVector &bytes);
+  void AppendBytes(const std::string &str);
+  // 参照カウントを増やして blob を繋げる
+  void AppendShared(SharedBlob *blob);
+  // fd の [offset, offset + size) を繋げる｡ fd は書き込みが終わるまで閉じない｡
+  void AppendFile(int fd, off_t offset, size_t size);
+  // chain のまだ書き込んでいないデータを末尾に移す｡ chain は空になる｡
+  // 小さい owned セグメントは末尾の owned セグメントにコピーして繋げる｡
+  // file セグメントを含む chain は渡せない｡ (HasFile() で確かめる)
+  void AppendChain(OutputChain &chain);
+
+  // file セグメントを含むか
+  bool HasFile() const;
+
+  // 最大 max_size バイトを1回の writev(2) か sendfile(2) で fd に書き込み､
+  // 書き込めたバイト数を返す｡ 書き込みに失敗した場合は errno が設定される｡
+  Result<size_t> WriteTo(int fd, size_t max_size);
+  // sink の Writev() か SendFile() を1回呼んで書き込む
+  Result<size_t> WriteTo(OutputSink &sink, size_t max_size);
+
+ private:
+  OutputChain(const OutputChain &rhs);
+  OutputChain &operator=(const OutputChain &rhs);
+
+  // 先頭の file セグメントを sendfile(2) で送る
+  Result<size_t> SendFile(OutputSink &sink, size_t max_size);
+
+  // 先頭の file セグメントのデータを file_buffer_ に読み込む
+  Result<void> FillFileBuffer(const Segment &segment);
+
+  // 先頭から size バイトを書き込み済みにする
+  void Consume(size_t size);
+  void PopFront();
+};
+
+}  // namespace utils
+
+#endif
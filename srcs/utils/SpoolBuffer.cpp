@@ -0,0 +1,170 @@
+#include "utils/SpoolBuffer.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+const char *const SpoolBuffer::kTempFileTemplate = "/tmp/webserv_body.XXXXXX";
+
+namespace {
+
+// 書き込めなくなるまで繰り返して size バイトを書き込む
+Result<void> WriteAll(int fd, const Byte *buf, size_t size) {
+  while (size > 0) {
+    ssize_t write_res = write(fd, buf, size);
+    if (write_res <= 0) {
+      return Error();
+    }
+    buf += write_res;
+    size -= write_res;
+  }
+  return Result<void>();
+}
+
+}  // namespace
+
+SpoolBuffer::SpoolBuffer()
+    : memory_(),
+      fd_(-1),
+      is_spooled_(false),
+      size_(0),
+      memory_limit_(kDefaultMemoryLimit) {}
+
+SpoolBuffer::SpoolBuffer(const SpoolBuffer &rhs)
+    : memory_(),
+      fd_(-1),
+      is_spooled_(false),
+      size_(0),
+      memory_limit_(kDefaultMemoryLimit) {
+  *this = rhs;
+}
+
+SpoolBuffer::~SpoolBuffer() {
+  Close();
+}
+
+SpoolBuffer &SpoolBuffer::operator=(const SpoolBuffer &rhs) {
+  if (this != &rhs) {
+    Close();
+    memory_ = rhs.memory_;
+    fd_ = rhs.fd_ >= 0 ? fcntl(rhs.fd_, F_DUPFD_CLOEXEC, 0) : -1;
+    is_spooled_ = rhs.is_spooled_;
+    size_ = rhs.size_;
+    memory_limit_ = rhs.memory_limit_;
+  }
+  return *this;
+}
+
+void SpoolBuffer::SetMemoryLimit(size_t memory_limit) {
+  memory_limit_ = memory_limit;
+}
+
+size_t SpoolBuffer::size() const {
+  return size_;
+}
+
+bool SpoolBuffer::empty() const {
+  return size_ == 0;
+}
+
+bool SpoolBuffer::IsSpooled() const {
+  return is_spooled_;
+}
+
+void SpoolBuffer::clear() {
+  Close();
+  ByteVector().swap(memory_);
+  is_spooled_ = false;
+  size_ = 0;
+}
+
+Result<void> SpoolBuffer::Append(const Byte *buf, size_t size) {
+  if (size == 0) {
+    return Result<void>();
+  }
+  if (!is_spooled_ && memory_.size() + size <= memory_limit_) {
+    memory_.AppendDataToBuffer(buf, size);
+    size_ += size;
+    return Result<void>();
+  }
+  if (!is_spooled_ && Spool().IsErr()) {
+    return Error();
+  }
+  if (fd_ < 0 || WriteAll(fd_, buf, size).IsErr()) {
+    return Error();
+  }
+  size_ += size;
+  return Result<void>();
+}
+
+Result<size_t> SpoolBuffer::Read(size_t offset, Byte *buf, size_t size) const {
+  if (offset >= size_) {
+    return 0;
+  }
+  size = std::min(size, size_ - offset);
+  if (!is_spooled_) {
+    std::memcpy(buf, memory_.data() + offset, size);
+    return size;
+  }
+  if (fd_ < 0) {
+    return Error();
+  }
+  ssize_t read_res = pread(fd_, buf, size, offset);
+  if (read_res < 0) {
+    return Error();
+  }
+  return static_cast<size_t>(read_res);
+}
+
+Result<void> SpoolBuffer::WriteAllTo(int fd) const {
+  if (!is_spooled_) {
+    return WriteAll(fd, memory_.data(), memory_.size());
+  }
+  std::vector<Byte> buf(size_ < kCopySize ? size_ : kCopySize);
+  for (size_t offset = 0; offset < size_;) {
+    Result<size_t> read_res = Read(offset, buf.data(), buf.size());
+    if (read_res.IsErr() || read_res.Ok() == 0) {
+      return Error();
+    }
+    if (WriteAll(fd, buf.data(), read_res.Ok()).IsErr()) {
+      return Error();
+    }
+    offset += read_res.Ok();
+  }
+  return Result<void>();
+}
+
+Result<void> SpoolBuffer::Spool() {
+  // mkostemp(3) はテンプレートを書き換えるのでコピーを渡す
+  // CGI の子プロセスに一時ファイルを引き継がないように O_CLOEXEC を付ける｡
+  std::string path(kTempFileTemplate);
+  int fd = mkostemp(&path[0], O_CLOEXEC);
+  if (fd < 0) {
+    return Error();
+  }
+  unlink(path.c_str());
+  if (WriteAll(fd, memory_.data(), memory_.size()).IsErr()) {
+    close(fd);
+    return Error();
+  }
+  fd_ = fd;
+  is_spooled_ = true;
+  ByteVector().swap(memory_);
+  return Result<void>();
+}
+
+void SpoolBuffer::Close() {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+}  // namespace utils
@@ -0,0 +1,76 @@
+#ifndef SPOOLBUFFER_HPP_
+#define SPOOLBUFFER_HPP_
+
+#include <cstddef>
+
+#include "result/result.hpp"
+#include "utils/ByteVector.hpp"
+
+namespace utils {
+
+using namespace result;
+
+// 受信したリクエストのボディを保持する｡
+//
+// memory_limit バイトまではメモリに持ち､超えたら一時ファイルに移して
+// 以降のデータはファイルに追記する｡ 一時ファイルは作成してすぐに
+// unlink(2) するので､閉じれば消える｡
+// 読み出す側は Read() や WriteAllTo() で少しずつ取り出すので､
+// ボディが大きくてもメモリに全体を持つことはない｡
+//
+// コピーは fd を dup(2) して同じ一時ファイルを共有する｡
+// オフセットを指定して読み書きするのでコピー同士で読み出しは干渉しないが､
+// コピーした後に Append() してはいけない｡
+// (ボディを受信し終えたリクエストをコピーする時だけ使う想定)
+//
+// fd は全て FD_CLOEXEC を付けて開くので､CGI の子プロセスには引き継がれない｡
+class SpoolBuffer {
+ private:
+  ByteVector memory_;
+  // 一時ファイルの fd｡ 一時ファイルに移していなければ -1
+  int fd_;
+  // 一時ファイルに移したか｡
+  // コピーで dup(2) に失敗した場合は fd_ が -1 のまま true になる｡
+  bool is_spooled_;
+  size_t size_;
+  size_t memory_limit_;
+
+  static const char *const kTempFileTemplate;
+
+ public:
+  static const size_t kDefaultMemoryLimit = 16 * 1024;
+  // WriteAllTo() で一時ファイルから1回に読み込むサイズ
+  static const size_t kCopySize = 64 * 1024;
+
+  SpoolBuffer();
+  SpoolBuffer(const SpoolBuffer &rhs);
+  ~SpoolBuffer();
+
+  SpoolBuffer &operator=(const SpoolBuffer &rhs);
+
+  // 既に一時ファイルに移している場合は何もしない
+  void SetMemoryLimit(size_t memory_limit);
+
+  size_t size() const;
+  bool empty() const;
+  bool IsSpooled() const;
+  // データを捨ててメモリに持つ状態に戻す
+  void clear();
+
+  Result<void> Append(const Byte *buf, size_t size);
+
+  // offset から最大 size バイトを buf に読み込み､読み込んだバイト数を返す
+  Result<size_t> Read(size_t offset, Byte *buf, size_t size) const;
+
+  // 全てのデータを fd に書き込む｡ fd はブロッキングの想定｡
+  Result<void> WriteAllTo(int fd) const;
+
+ private:
+  // memory_ のデータを一時ファイルに移す
+  Result<void> Spool();
+  void Close();
+};
+
+}  // namespace utils
+
+#endif
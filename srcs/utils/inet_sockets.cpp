@@ -61,7 +61,7 @@ int InetConnect(const std::string &host, const std::string &service, int type) {
 /* Public interfaces: InetBind() and InetListen() */
 static int InetPassiveSocket(const char *host, const char *service, int type,
                              server::SocketAddress *sockaddr, bool doListen,
-                             int backlog) {
+                             int backlog, bool reusePort) {
   struct addrinfo hints;
   struct addrinfo *result, *rp;
   int sfd, optval, s;
@@ -95,6 +95,15 @@ static int InetPassiveSocket(const char *host, const char *service, int type,
         return -1;
       }
     }
+    if (reusePort) {
+      /* Allow each worker process to bind its own socket to the same port */
+      if (setsockopt(sfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) ==
+          -1) {
+        close(sfd);
+        freeaddrinfo(result);
+        return -1;
+      }
+    }
 
     if (bind(sfd, rp->ai_addr, rp->ai_addrlen) == 0)
       break; /* Success */
@@ -117,10 +126,11 @@ static int InetPassiveSocket(const char *host, const char *service, int type,
 }
 
 Result<int> InetListen(const std::string &host, const std::string &service,
-                       int backlog, server::SocketAddress *sockaddr) {
+                       int backlog, server::SocketAddress *sockaddr,
+                       bool reuse_port) {
   const char *host_cstr = host.empty() ? NULL : host.c_str();
   int fd = InetPassiveSocket(host_cstr, service.c_str(), SOCK_STREAM, sockaddr,
-                             true, backlog);
+                             true, backlog, reuse_port);
   if (fd < 0) {
     return Error();
   }
@@ -131,7 +141,8 @@ Result<int> InetBind(const std::string &host, const std::string &service,
                      int type, server::SocketAddress *sockaddr) {
   const char *host_cstr = host.empty() ? NULL : host.c_str();
   int fd =
-      InetPassiveSocket(host_cstr, service.c_str(), type, sockaddr, false, 0);
+      InetPassiveSocket(host_cstr, service.c_str(), type, sockaddr, false, 0,
+                        false);
   if (fd < 0) {
     return Error();
   }
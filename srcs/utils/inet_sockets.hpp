@@ -37,12 +37,15 @@ int InetConnect(const std::string &host, const std::string &service, int type);
  *   backlog: 許容する保留コネクション数(listen()の引数と一緒)｡
  *   addrlen: 作成したソケットに対応する
  *            ソケットアドレス構造体のサイズを表す変数へのポインタ｡
+ *   reuse_port: true なら SO_REUSEPORT を設定する｡
+ *               複数のプロセスが同じポートでそれぞれlistenできるようになる｡
  *
  * Return:
  *   ファイルディスクリプタ。 エラーの場合は-1を返す。
  */
 Result<int> InetListen(const std::string &host, const std::string &service,
-                       int backlog, server::SocketAddress *sockaddr);
+                       int backlog, server::SocketAddress *sockaddr,
+                       bool reuse_port = false);
 
 /* typeに指定されたソケットを作成し、service､typeに指定されたポートのワイルドカードアドレスへバインドする｡
  * この関数はソケットを特定のアドレスへバインドするUDPサーバ､UDPクライアント用です｡
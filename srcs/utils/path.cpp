@@ -1,5 +1,6 @@
 #include "utils/path.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -56,31 +57,62 @@ bool IsValidPath(const std::string &path) {
 }
 
 Result<std::string> NormalizePath(const std::string &path) {
+  std::string normalized = path;
+  if (NormalizePathInPlace(normalized).IsErr()) {
+    return Error();
+  }
+  return normalized;
+}
+
+// "/" で区切った要素を前から順に見て､path の先頭に詰めて書いていく｡
+// 正規化したパスは元より長くならないので､書き込む位置が読む位置を
+// 追い越すことはない｡
+Result<void> NormalizePathInPlace(std::string &path) {
   if (path.empty()) {
-    return std::string("");
+    return Result<void>();
   }
-  std::vector<std::string> vec = SplitPath(path);
-  std::vector<std::string> normalize;
+  const bool is_abs_path = path[0] == '/';
+  // path の [0, normalized_size) が正規化済みの部分
+  size_t normalized_size = is_abs_path ? 1 : 0;
+  // 正規化済みの部分の要素数｡ 絶対パスの先頭の "/" も1つと数える｡
+  size_t element_num = is_abs_path ? 1 : 0;
+  // 最後の要素が "", ".", ".." なら "/" で終わるようにする
+  bool is_last_slash = false;
 
-  for (std::vector<std::string>::const_iterator it = vec.begin();
-       it != vec.end(); it++) {
-    if (*it == "" || *it == ".") {
-      continue;
+  for (size_t pos = 0; pos <= path.size();) {
+    size_t end = path.find('/', pos);
+    if (end == std::string::npos) {
+      end = path.size();
     }
-    if (*it == "..") {
-      if (normalize.size() <= 1) {
+    const size_t len = end - pos;
+    const bool is_dot = len == 1 && path[pos] == '.';
+    const bool is_dot_dot =
+        len == 2 && path[pos] == '.' && path[pos + 1] == '.';
+    is_last_slash = len == 0 || is_dot || is_dot_dot;
+
+    if (is_dot_dot) {
+      if (element_num <= 1) {
         return Error();
       }
-      normalize.pop_back();
-    } else {
-      normalize.push_back(*it);
+      const size_t slash_pos = path.rfind('/', normalized_size - 1);
+      normalized_size = slash_pos == 0 ? 1 : slash_pos;
+      element_num--;
+    } else if (!is_last_slash) {
+      if (normalized_size > 0 && path[normalized_size - 1] != '/') {
+        path[normalized_size++] = '/';
+      }
+      std::memmove(&path[normalized_size], &path[pos], len);
+      normalized_size += len;
+      element_num++;
     }
+    pos = end + 1;
   }
-  if (vec.size() != 0 &&
-      (vec.back() == "" || vec.back() == "." || vec.back() == "..")) {
-    normalize.push_back("");
+  if (is_last_slash && normalized_size > 0 &&
+      path[normalized_size - 1] != '/') {
+    path[normalized_size++] = '/';
   }
-  return (JoinPath(normalize));
+  path.resize(normalized_size);
+  return Result<void>();
 }
 
 bool IsAbsolutePath(const std::string &path) {
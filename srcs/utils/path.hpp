@@ -21,6 +21,9 @@ std::string JoinPath(const std::string &s1, const std::string &s2);
 // "/hoge/fuga/../../.." -> Error
 bool IsValidPath(const std::string &path);
 Result<std::string> NormalizePath(const std::string &path);
+// path をその場で正規化する｡ 新しい文字列は作らない｡
+// 失敗した時の path の中身は不定｡
+Result<void> NormalizePathInPlace(std::string &path);
 
 // 絶対パスかどうか
 bool IsAbsolutePath(const std::string &path);
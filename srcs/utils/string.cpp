@@ -101,28 +101,46 @@ std::string PercentEncode(const utils::ByteVector &to_encode) {
 }
 
 Result<std::string> PercentDecode(const utils::ByteVector &to_decode) {
-  std::string decoded;
-  char c;
+  std::string decoded(to_decode.begin(), to_decode.end());
+  if (PercentDecodeInPlace(decoded).IsErr()) {
+    return Error();
+  }
+  return decoded;
+}
 
-  for (utils::ByteVector::const_iterator it = to_decode.begin();
-       it != to_decode.end(); it++) {
-    if (*it == '%') {
-      if (std::distance(it, to_decode.end()) < 3) {
+// 16進数の1文字を数値にする｡ 16進数でなければ -1
+static int HexCharToInt(char c) {
+  if ('0' <= c && c <= '9') {
+    return c - '0';
+  } else if ('a' <= c && c <= 'f') {
+    return c - 'a' + 10;
+  } else if ('A' <= c && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+Result<void> PercentDecodeInPlace(std::string &str) {
+  // デコードした文字列は元より長くならないので前から詰めて書いていく
+  size_t decoded_size = 0;
+  for (size_t i = 0; i < str.size(); i++) {
+    char c = str[i];
+    if (c == '%') {
+      if (str.size() - i < 3) {
         return Error();
       }
-      std::string hex = std::string(it + 1, it + 3);
-      Result<unsigned long> res = Stoul(hex, kHexadecimal);
-      if (res.IsErr() || res.Ok() == 0) {
+      const int high = HexCharToInt(str[i + 1]);
+      const int low = HexCharToInt(str[i + 2]);
+      if (high < 0 || low < 0 || (high == 0 && low == 0)) {
         return Error();
       }
-      c = static_cast<char>(res.Ok());
-      it += 2;
-    } else {
-      c = static_cast<char>(*it);
+      c = static_cast<char>(high * 16 + low);
+      i += 2;
     }
-    decoded.push_back(c);
+    str[decoded_size++] = c;
   }
-  return decoded;
+  str.resize(decoded_size);
+  return Result<void>();
 }
 
 std::vector<std::string> SplitString(const std::string &str,
@@ -54,6 +54,10 @@ std::string PercentEncode(const utils::ByteVector &to_encode);
 
 Result<std::string> PercentDecode(const utils::ByteVector &to_encode);
 
+// str をその場でパーセントデコードする｡ 新しい文字列は作らない｡
+// 失敗した時の str の中身は不定｡
+Result<void> PercentDecodeInPlace(std::string &str);
+
 // str を delim で区切った文字列vectorを返す｡
 // e.g. SplitString("a,bc,,d", ",") return ["a", "bc", ,"", "d"]
 std::vector<std::string> SplitString(const std::string &str,
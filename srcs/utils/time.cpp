@@ -19,8 +19,13 @@ long GetCurrentTimeMs() {
 
 // [2021/08/03 10:11:20]
 std::string GetDateStr() {
-  std::time_t t = time(NULL);
-  std::tm* now = std::localtime(&t);
+  return FormatLogDate(time(NULL));
+}
+
+std::string FormatLogDate(std::time_t t) {
+  // 複数のスレッドから呼ばれるので localtime_r を使う
+  std::tm tm;
+  std::tm* now = localtime_r(&t, &tm);
 
   std::stringstream s;
   s << "[";
@@ -36,4 +41,73 @@ std::string GetDateStr() {
   return s.str();
 }
 
+std::string FormatImfFixdate(std::time_t t) {
+  // strftime の %a, %b はロケールに依存するので自分で変換する
+  static const char* const kDays[] = {"Sun", "Mon", "Tue", "Wed",
+                                      "Thu", "Fri", "Sat"};
+  static const char* const kMonths[] = {"Jan", "Feb", "Mar", "Apr",
+                                        "May", "Jun", "Jul", "Aug",
+                                        "Sep", "Oct", "Nov", "Dec"};
+  std::tm tm;
+  gmtime_r(&t, &tm);
+
+  std::stringstream s;
+  s << kDays[tm.tm_wday] << ", ";
+  s << std::setw(2) << std::setfill('0') << tm.tm_mday << " ";
+  s << kMonths[tm.tm_mon] << " ";
+  s << std::setw(4) << std::setfill('0') << (tm.tm_year + 1900) << " ";
+  s << std::setw(2) << std::setfill('0') << tm.tm_hour << ":";
+  s << std::setw(2) << std::setfill('0') << tm.tm_min << ":";
+  s << std::setw(2) << std::setfill('0') << tm.tm_sec << " GMT";
+
+  return s.str();
+}
+
+// ========================================================================
+// CachedClock
+
+CachedClock::CachedClock()
+    : now_ms_(0), now_sec_(-1), imf_fixdate_(), log_date_() {
+  Update();
+}
+
+CachedClock::CachedClock(const CachedClock& rhs) {
+  *this = rhs;
+}
+
+CachedClock& CachedClock::operator=(const CachedClock& rhs) {
+  if (this != &rhs) {
+    now_ms_ = rhs.now_ms_;
+    now_sec_ = rhs.now_sec_;
+    imf_fixdate_ = rhs.imf_fixdate_;
+    log_date_ = rhs.log_date_;
+  }
+  return *this;
+}
+
+CachedClock::~CachedClock() {}
+
+void CachedClock::Update() {
+  now_ms_ = GetCurrentTimeMs();
+  std::time_t now_sec = now_ms_ / 1000;
+  if (now_sec == now_sec_) {
+    return;
+  }
+  now_sec_ = now_sec;
+  imf_fixdate_ = FormatImfFixdate(now_sec_);
+  log_date_ = FormatLogDate(now_sec_);
+}
+
+long CachedClock::GetNowMs() const {
+  return now_ms_;
+}
+
+const std::string& CachedClock::GetImfFixdate() const {
+  return imf_fixdate_;
+}
+
+const std::string& CachedClock::GetLogDate() const {
+  return log_date_;
+}
+
 }  // namespace utils
@@ -1,7 +1,9 @@
 #ifndef UTILS_TIME_HPP_
 #define UTILS_TIME_HPP_
 
+#include <ctime>
 #include <iostream>
+#include <string>
 
 namespace utils {
 
@@ -10,6 +12,43 @@ long GetCurrentTimeMs();
 // [2021/08/03 10:11:20]
 std::string GetDateStr();
 
+// t をログ用の文字列にする｡ (GetDateStr() の形式)
+std::string FormatLogDate(std::time_t t);
+
+// t を HTTP の Date ヘッダーで使う IMF-fixdate にする｡
+// Sun, 06 Nov 1994 08:49:37 GMT
+std::string FormatImfFixdate(std::time_t t);
+
+// イベントループごとに持つ時計｡
+//
+// 現在時刻が必要になるたびにシステムコールを呼んだり文字列を作ったりしないように､
+// Update() を呼んだ時点の時刻を保持する｡
+// 時刻の文字列は秒が変わった時だけ作り直す｡
+class CachedClock {
+ private:
+  long now_ms_;
+  std::time_t now_sec_;
+  std::string imf_fixdate_;
+  std::string log_date_;
+
+ public:
+  CachedClock();
+  CachedClock(const CachedClock &rhs);
+  CachedClock &operator=(const CachedClock &rhs);
+  ~CachedClock();
+
+  // 現在時刻を取得し直す
+  void Update();
+
+  long GetNowMs() const;
+
+  // Date ヘッダーの値
+  const std::string &GetImfFixdate() const;
+
+  // ログに出力する時刻
+  const std::string &GetLogDate() const;
+};
+
 }  // namespace utils
 
 #endif
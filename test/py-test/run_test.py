@@ -104,6 +104,29 @@ def run_test(
     return is_success
 
 
+# send_data をソケットでそのまま送り､レスポンスのステータスコードを比べる
+def run_socket_test(
+    send_data,
+    expect_code,
+    port=cmd_args.WEBSERV_PORT,
+    test_name="",
+) -> bool:
+    response = send_req_utils.send_socket_request(send_data, port)
+    status_line = response.split("\r\n", 1)[0].split(" ")
+    code = -1
+    if len(status_line) >= 2 and status_line[1].isdigit():
+        code = int(status_line[1])
+
+    log_msg = f"send_data : {send_data[:50]!r} ..."
+    is_success = code == expect_code
+    print(OK_MSG if is_success else KO_MSG, log_msg)
+
+    if test_name == "":
+        test_name = inspect_utils.get_caller_func_name()
+    append_test_result(test_name, is_success, log_msg)
+    return is_success
+
+
 def run_cmp_test(
     req_path,
     body=None,
@@ -55,7 +55,7 @@ def send_socket_request(send_data, port):
         s = socket.socket(socket.AF_INET)
         s.settimeout(timeout)
         s.connect(("localhost", port))
-        s.send(send_data.encode("utf-8"))
+        s.sendall(send_data.encode("utf-8"))
         time.sleep(0.1)
         return s.recv(10000).decode("utf-8")
     except socket.timeout:
@@ -3,6 +3,7 @@ from . import cmd_args
 from .str_utils import to_hex_str
 from .run_test import run_test
 from .run_test import run_cmp_test
+from .run_test import run_socket_test
 from .run_test import is_test_success
 
 import string
@@ -153,6 +154,12 @@ def decode_test():
     run_test(req_path, res.response(400), ck_body=False)
 
 
+def buffer_limit_test():
+    # connection_buffer_limit(65536) に達してもヘッダーが終わらない
+    send_data = "GET / HTTP/1.1\r\nHost: localhost\r\nX-Long: " + "a" * 70000
+    run_socket_test(send_data, 431)
+
+
 # TODO : content_type を 見るようにする。
 def content_type_test():
     expect_res = res.response(
@@ -314,6 +321,7 @@ def run_all_test() -> bool:
     is_all_test_ok &= exec_test(path_normaliz_test)
     is_all_test_ok &= exec_test(has_q_prm_test)
     is_all_test_ok &= exec_test(decode_test)
+    is_all_test_ok &= exec_test(buffer_limit_test)
     is_all_test_ok &= exec_test(content_type_test, must_all_test_ok=False)
     is_all_test_ok &= exec_test(cmp_test, must_all_test_ok=False)
     is_all_test_ok &= exec_test(cgi_simple_test, must_all_test_ok=False)
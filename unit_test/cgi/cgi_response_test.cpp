@@ -3,6 +3,7 @@
 #include <gtest/gtest.h>
 
 #include "expectations/expect_result.hpp"
+#include "utils/ByteBuffer.hpp"
 #include "utils/ByteVector.hpp"
 
 namespace cgi {
@@ -42,7 +43,7 @@ void EXPECT_EQ_HEADERS(const CgiResponse::HeaderVecType &actual,
 // Status 付きのドキュメントレスポンス
 // document-response = Content-Type [ Status ] *other-field NL response-body
 TEST(CgiResponseParse, DocumentResponseWithStatus) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\n"
       "Status: 404 Not Found\n"
       "Optional: hoge\n"
@@ -70,7 +71,7 @@ TEST(CgiResponseParse, DocumentResponseWithStatus) {
 // Status が付いていないドキュメントレスポンス
 // Status がない場合は Status = 200 OK という扱いになる
 TEST(CgiResponseParse, ValidDocumentResponseWithoutStatus) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\n"
       "Optional: hoge\n"
       "\n"
@@ -98,7 +99,7 @@ TEST(CgiResponseParse, ValidDocumentResponseWithoutStatus) {
 // ローカルリダイレクト
 // local-redir-response = local-Location NL
 TEST(CgiResponseParse, ValidLocalRedirectResponse) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:/users?q=jun\n"
       "\n");
 
@@ -114,7 +115,7 @@ TEST(CgiResponseParse, ValidLocalRedirectResponse) {
 // クライアントリダイレクト
 // client-redir-response = client-Location *extension-field NL
 TEST(CgiResponseParse, ValidClientRedirectResponse) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:https://www.google.com/search?q=pikachu\n"
       "ExtensionField: hoge\n"
       "\n");
@@ -134,7 +135,7 @@ TEST(CgiResponseParse, ValidClientRedirectResponse) {
 // client-redirdoc-response = client-Location Status Content-Type *other-field
 // NL response-body
 TEST(CgiResponseParse, ValidClientRedirectResponseWithDocument) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:https://www.google.com/search?q=pikachu\n"
       "Status: 302 Found\n"
       "Content-Type: text/html\n"
@@ -170,7 +171,7 @@ TEST(CgiResponseParse, ValidClientRedirectResponseWithDocument) {
 // 302以外でもリダイレクトを表す300番台のHTTPステータスコードならOK
 TEST(CgiResponseParse,
      ValidClientRedirectResponseWithDocumentAndCustomRedirectCode) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:https://www.google.com/search?q=pikachu\n"
       "Status: 301 Moved Permanently\n"
       "Content-Type: text/html\n"
@@ -201,7 +202,7 @@ TEST(CgiResponseParse,
 
 // UNIX 上での CGI は改行コードとして CRLF も受け付け可能である
 TEST(CgiResponseParse, NewLineIsCrlf) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\r\n"
       "Status: 404 Not Found\r\n"
       "Optional: hoge\r\n"
@@ -228,7 +229,7 @@ TEST(CgiResponseParse, NewLineIsCrlf) {
 
 // body に LF と CRLF が混ざっているデータがあっても良い
 TEST(CgiResponseParse, DocumentResponsesBodyIncludeLfAndCrlf) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\n"
       "Status: 404 Not Found\n"
       "Optional: hoge\n"
@@ -256,7 +257,7 @@ TEST(CgiResponseParse, DocumentResponsesBodyIncludeLfAndCrlf) {
 TEST(CgiResponseParse, ChoppedBuffer) {
   CgiResponse cgi_res;
 
-  utils::ByteVector buffer;
+  utils::ByteBuffer buffer;
 
   const char *cgi_output1(
       "Content-Type: text/html\n"
@@ -302,7 +303,7 @@ TEST(CgiResponseParse, ChoppedBuffer) {
 TEST(CgiResponseParse, ChoppedBufferThatIsSplitedBeforeHeaderBoundary) {
   CgiResponse cgi_res;
 
-  utils::ByteVector buffer;
+  utils::ByteBuffer buffer;
 
   const char *cgi_output1(
       "Content-Type: text/html\n"
@@ -346,7 +347,7 @@ TEST(CgiResponseParse, ChoppedBufferThatIsSplitedBeforeHeaderBoundary) {
 TEST(CgiResponseParse, ChoppedBufferThatIsSplitedInMiddleHeaderBoundary) {
   CgiResponse cgi_res;
 
-  utils::ByteVector buffer;
+  utils::ByteBuffer buffer;
 
   const char *cgi_output1(
       "Content-Type: text/html\n"
@@ -391,7 +392,7 @@ TEST(CgiResponseParse, ChoppedBufferThatIsSplitedInMiddleHeaderBoundary) {
 TEST(CgiResponseParse, ChoppedBufferThatIsSplitedAftertHeaderBoundary) {
   CgiResponse cgi_res;
 
-  utils::ByteVector buffer;
+  utils::ByteBuffer buffer;
 
   const char *cgi_output1(
       "Content-Type: text/html\n"
@@ -438,7 +439,7 @@ TEST(CgiResponseParse, ChoppedBufferThatIsSplitedAftertHeaderBoundary) {
 
 // CRLF と LF が混ざっているものはエラー
 TEST(CgiResponseParse, MixedNewLineIsError) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\r\n"
       "Status: 404 Not Found\n"
       "Optional: hoge\r\n"
@@ -453,7 +454,7 @@ TEST(CgiResponseParse, MixedNewLineIsError) {
 
 // ヘッダー名が無い
 TEST(CgiResponseParse, HeaderNameIsNone) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       ": text/html\n"
       "Status: 200 OK\n"
       "Optional: hoge\n"
@@ -468,7 +469,7 @@ TEST(CgiResponseParse, HeaderNameIsNone) {
 
 // ヘッダーにコロンが無い
 TEST(CgiResponseParse, NoColonAfterHeaderName) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type text/html\n"
       "Status: 200 OK\n"
       "Optional: hoge\n"
@@ -483,7 +484,7 @@ TEST(CgiResponseParse, NoColonAfterHeaderName) {
 
 // 同じ名前のヘッダーが2つある
 TEST(CgiResponseParse, HeaderDuplication) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\n"
       "Status: 200 OK\n"
       "Status: 404 Not Found\n"
@@ -499,7 +500,7 @@ TEST(CgiResponseParse, HeaderDuplication) {
 
 // レスポンスタイプ判別不能
 TEST(CgiResponseParse, UnknownResponseType) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Status: 200 OK\n"
       "\n"
       "<HTML>\n"
@@ -512,7 +513,7 @@ TEST(CgiResponseParse, UnknownResponseType) {
 
 // ドキュメントレスポンスのStatusが不正
 TEST(CgiResponseParse, DocumentResponseWithInvalidStatusIsError) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Content-Type: text/html\n"
       "Status: 2000 Not Found\n"
       "Optional: hoge\n"
@@ -527,7 +528,7 @@ TEST(CgiResponseParse, DocumentResponseWithInvalidStatusIsError) {
 
 // ローカルリダイレクトはLocation以外のフィールドを持てない
 TEST(CgiResponseParse, LocalRedirectResponseWithOtherFields) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:/users?q=jun\n"
       "OtherFiled: hoge\n"
       "\n");
@@ -538,7 +539,7 @@ TEST(CgiResponseParse, LocalRedirectResponseWithOtherFields) {
 
 // ローカルリダイレクトは response-body を持てない
 TEST(CgiResponseParse, LocalRedirectResponseWithBody) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:/users?q=jun\n"
       "\n"
       "Local redirect can't hold body.");
@@ -551,7 +552,7 @@ TEST(CgiResponseParse, LocalRedirectResponseWithBody) {
 // URIの形式については https://tex2e.github.io/rfc-translater/html/rfc2396.html
 // のセクション3を参照
 TEST(CgiResponseParse, ClientRedirectResponseWithDocumentHasInvalidUri) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:httpswww.google.com/search?q=pikachu\n"
       "Status: 302 Found\n"
       "Content-Type: text/html\n"
@@ -568,7 +569,7 @@ TEST(CgiResponseParse, ClientRedirectResponseWithDocumentHasInvalidUri) {
 
 // ドキュメント付きクライアントリダイレクトにStatusが無い
 TEST(CgiResponseParse, ClientRedirectResponseWithDocumentWithoutStatus) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:https://www.google.com/search?q=pikachu\n"
       "Content-Type: text/html\n"
       "ExtensionField: hoge\n"
@@ -584,7 +585,7 @@ TEST(CgiResponseParse, ClientRedirectResponseWithDocumentWithoutStatus) {
 
 // ドキュメント付きクライアントリダイレクトにContent-Typeが無い
 TEST(CgiResponseParse, ClientRedirectResponseWithDocumentWioutContentType) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:https://www.google.com/search?q=pikachu\n"
       "Status: 302 Found\n"
       "ExtensionField: hoge\n"
@@ -601,7 +602,7 @@ TEST(CgiResponseParse, ClientRedirectResponseWithDocumentWioutContentType) {
 // ドキュメント付きクライアントリダイレクトで
 // HTTPステータスコードがリダイレクトを表すステータスコードじゃない
 TEST(CgiResponseParse, ClientRedirectResponseWithDocumentsStatusCodeIsInvalid) {
-  utils::ByteVector cgi_output(
+  utils::ByteBuffer cgi_output(
       "Location:https://www.google.com/search?q=pikachu\n"
       "Status: 404 Not Found\n"
       "Content-Type: text/html\n"
@@ -797,6 +797,366 @@ TEST(ParserTest, ListenDuplication) {
   EXPECT_THROW(parser.ParseConfig();, Parser::ParserException);
 }
 
+TEST(ParserTest, EdgeTriggered) {
+  Parser parser;
+  parser.LoadData(
+      "edge_triggered on;                           "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_TRUE(config.GetIsEdgeTriggered());
+}
+
+TEST(ParserTest, EdgeTriggeredIsOffByDefault) {
+  Parser parser;
+  parser.LoadData(
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_FALSE(config.GetIsEdgeTriggered());
+}
+
+TEST(ParserTest, EdgeTriggeredDuplication) {
+  Parser parser;
+  parser.LoadData(
+      "edge_triggered on;                           "
+      "edge_triggered off;                          "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  EXPECT_THROW(parser.ParseConfig();, Parser::ParserException);
+}
+
+TEST(ParserTest, WorkerProcesses) {
+  Parser parser;
+  parser.LoadData(
+      "worker_processes 4;                          "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_EQ(config.GetWorkerProcesses(), 4);
+}
+
+TEST(ParserTest, WorkerProcessesAuto) {
+  Parser parser;
+  parser.LoadData(
+      "worker_processes auto;                       "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_GE(config.GetWorkerProcesses(), 1);
+}
+
+TEST(ParserTest, WorkerProcessesIsInvalid) {
+  const char *args[] = {"0", "-1", "1025", "many"};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("worker_processes ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    EXPECT_THROW(parser.ParseConfig();, Parser::ParserException) << args[i];
+  }
+}
+
+TEST(ParserTest, WorkerThreadsAndBalancing) {
+  Parser parser;
+  parser.LoadData(
+      "worker_threads 8;                            "
+      "thread_balancing least_conn;                 "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_EQ(config.GetWorkerThreads(), 8);
+  EXPECT_EQ(config.GetThreadBalancing(), Config::kLeastConnections);
+}
+
+TEST(ParserTest, ThreadBalancingIsInvalid) {
+  Parser parser;
+  parser.LoadData(
+      "thread_balancing random;                     "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  EXPECT_THROW(parser.ParseConfig();, Parser::ParserException);
+}
+
+TEST(ParserTest, EventBackend) {
+  Parser parser;
+  parser.LoadData(
+      "event_backend io_uring;                      "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_EQ(config.GetEventBackend(), Config::kIoUringBackend);
+}
+
+TEST(ParserTest, EventBackendIsEpollByDefault) {
+  Parser parser;
+  parser.LoadData(
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_EQ(config.GetEventBackend(), Config::kEpollBackend);
+}
+
+TEST(ParserTest, EventBackendIsInvalid) {
+  const char *args[] = {"kqueue", "epoll epoll", ""};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("event_backend ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    EXPECT_THROW(parser.ParseConfig();, Parser::ParserException) << args[i];
+  }
+}
+
+TEST(ParserTest, ReusePortAndAcceptBatch) {
+  Parser parser;
+  parser.LoadData(
+      "reuse_port off;                              "
+      "accept_batch 16;                             "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_FALSE(config.GetIsReusePort());
+  EXPECT_EQ(config.GetAcceptBatch(), 16);
+}
+
+TEST(ParserTest, EpollEvents) {
+  const char *args[] = {"1", "1024", "65536"};
+  const int expected[] = {1, 1024, 65536};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("epoll_events ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    Config config = parser.ParseConfig();
+    EXPECT_TRUE(config.IsValid());
+    EXPECT_EQ(config.GetEpollEvents(), expected[i]);
+  }
+}
+
+TEST(ParserTest, Sendfile) {
+  Parser parser;
+  parser.LoadData(
+      "sendfile off;                                "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_FALSE(config.GetIsSendfile());
+}
+
+TEST(ParserTest, TcpNodelayAndTcpNopush) {
+  Parser parser;
+  parser.LoadData(
+      "tcp_nodelay off;                             "
+      "tcp_nopush off;                              "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_FALSE(config.GetIsTcpNodelay());
+  EXPECT_FALSE(config.GetIsTcpNopush());
+}
+
+TEST(ParserTest, ReusePortAndAcceptBatchDefault) {
+  Parser parser;
+  parser.LoadData(
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.GetIsReusePort());
+  EXPECT_EQ(config.GetAcceptBatch(), 64);
+  EXPECT_EQ(config.GetEpollEvents(), 512);
+  EXPECT_TRUE(config.GetIsSendfile());
+  EXPECT_TRUE(config.GetIsTcpNodelay());
+  EXPECT_TRUE(config.GetIsTcpNopush());
+  EXPECT_EQ(config.GetConnectionBufferLimit(), 1024 * 1024);
+  EXPECT_EQ(config.GetClientBodyBufferSize(), 16 * 1024);
+}
+
+TEST(ParserTest, ConnectionBufferLimit) {
+  Parser parser;
+  parser.LoadData(
+      "connection_buffer_limit 65536;               "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  Config config = parser.ParseConfig();
+  EXPECT_TRUE(config.IsValid());
+  EXPECT_EQ(config.GetConnectionBufferLimit(), 65536);
+}
+
+TEST(ParserTest, ConnectionBufferLimitIsInvalid) {
+  Parser parser;
+  parser.LoadData(
+      "connection_buffer_limit 0;                   "
+      "server {                                     "
+      "  listen 8080;                               "
+      "                                             "
+      "  location / {                               "
+      "    root /var/www/html;                      "
+      "  }                                          "
+      "}                                            ");
+  EXPECT_THROW(parser.ParseConfig(), Parser::ParserException);
+}
+
+TEST(ParserTest, ClientBodyBufferSize) {
+  const char *args[] = {"0", "1048576"};
+  const unsigned long expected[] = {0, 1048576};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("client_body_buffer_size ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    Config config = parser.ParseConfig();
+    EXPECT_TRUE(config.IsValid());
+    EXPECT_EQ(config.GetClientBodyBufferSize(), expected[i]);
+  }
+}
+
+TEST(ParserTest, ClientBodyBufferSizeIsInvalid) {
+  const char *args[] = {"-1", "16k", ""};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("client_body_buffer_size ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    EXPECT_THROW(parser.ParseConfig(), Parser::ParserException) << args[i];
+  }
+}
+
+TEST(ParserTest, AcceptBatchIsInvalid) {
+  const char *args[] = {"0", "-1", "4097", "auto", ""};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("accept_batch ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    EXPECT_THROW(parser.ParseConfig();, Parser::ParserException) << args[i];
+  }
+}
+
+TEST(ParserTest, EpollEventsIsInvalid) {
+  const char *args[] = {"0", "-1", "65537", "auto", ""};
+  for (size_t i = 0; i < sizeof(args) / sizeof(args[0]); ++i) {
+    Parser parser;
+    parser.LoadData(std::string("epoll_events ") + args[i] +
+                    ";"
+                    "server {                                     "
+                    "  listen 8080;                               "
+                    "  location / {                               "
+                    "    root /var/www/html;                      "
+                    "  }                                          "
+                    "}                                            ");
+    EXPECT_THROW(parser.ParseConfig();, Parser::ParserException) << args[i];
+  }
+}
+
 class ParserLocationTestKo : public ::testing::TestWithParam<std::string> {};
 
 TEST_P(ParserLocationTestKo, Ng) {
@@ -0,0 +1,157 @@
+#include "http/chunked_decoder.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+namespace http {
+
+namespace {
+
+struct DecodeResult {
+  ChunkedDecoder::Status status;
+  std::string body;
+  // 読み進めたバイト数
+  size_t consumed;
+};
+
+// input を read_size バイトずつ渡してデコードする
+DecodeResult Decode(const std::string &input, size_t read_size,
+                    unsigned long max_body_size = 1024 * 1024) {
+  ChunkedDecoder decoder;
+  decoder.SetMaxBodySize(max_body_size);
+  DecodeResult res;
+  res.consumed = 0;
+  const utils::Byte *bytes =
+      reinterpret_cast<const utils::Byte *>(input.data());
+  for (size_t received = 0;
+       received < input.size() &&
+       decoder.GetStatus() == ChunkedDecoder::kInProgress;) {
+    received = std::min(received + read_size, input.size());
+    // 読み進めていない所から受信済みの所までを渡し直す
+    while (res.consumed < received &&
+           decoder.GetStatus() == ChunkedDecoder::kInProgress) {
+      const utils::Byte *body;
+      size_t body_size;
+      res.consumed += decoder.Decode(bytes + res.consumed,
+                                     received - res.consumed, &body,
+                                     &body_size);
+      res.body.append(reinterpret_cast<const char *>(body), body_size);
+    }
+  }
+  res.status = decoder.GetStatus();
+  EXPECT_EQ(decoder.GetBodySize(), res.body.size());
+  return res;
+}
+
+const size_t kReadSizes[] = {1, 2, 3, 7, 1024};
+
+}  // namespace
+
+TEST(ChunkedDecoderTest, Decode) {
+  const std::string input =
+      "5\r\n12345\r\n"
+      "A\r\nabcdefghij\r\n"
+      "0\r\n\r\n";
+  for (size_t i = 0; i < sizeof(kReadSizes) / sizeof(kReadSizes[0]); ++i) {
+    DecodeResult res = Decode(input, kReadSizes[i]);
+    EXPECT_EQ(res.status, ChunkedDecoder::kFinished) << kReadSizes[i];
+    EXPECT_EQ(res.body, "12345abcdefghij") << kReadSizes[i];
+    EXPECT_EQ(res.consumed, input.size()) << kReadSizes[i];
+  }
+}
+
+// chunk-ext と trailer-section は読み飛ばす
+TEST(ChunkedDecoderTest, SkipExtensionsAndTrailers) {
+  const std::string input =
+      "5;name=value\r\n12345\r\n"
+      "3 ; quoted=\"a;b\"\r\nxyz\r\n"
+      "0;last\r\n"
+      "Expires: Wed, 21 Oct 2015 07:28:00 GMT\r\n"
+      "X-Trailer: 1\r\n"
+      "\r\n";
+  for (size_t i = 0; i < sizeof(kReadSizes) / sizeof(kReadSizes[0]); ++i) {
+    DecodeResult res = Decode(input, kReadSizes[i]);
+    EXPECT_EQ(res.status, ChunkedDecoder::kFinished) << kReadSizes[i];
+    EXPECT_EQ(res.body, "12345xyz") << kReadSizes[i];
+  }
+}
+
+// chunk-data の中の CRLF は区切りとして扱わない
+TEST(ChunkedDecoderTest, DataContainsCrlf) {
+  const std::string input = "6\r\n\r\n\r\n\r\n\r\n0\r\n\r\n";
+  for (size_t i = 0; i < sizeof(kReadSizes) / sizeof(kReadSizes[0]); ++i) {
+    DecodeResult res = Decode(input, kReadSizes[i]);
+    EXPECT_EQ(res.status, ChunkedDecoder::kFinished) << kReadSizes[i];
+    EXPECT_EQ(res.body, "\r\n\r\n\r\n") << kReadSizes[i];
+  }
+}
+
+// 終わった後のデータ(次のリクエスト)は読み進めない
+TEST(ChunkedDecoderTest, StopAtEndOfBody) {
+  const std::string body = "1\r\na\r\n0\r\n\r\n";
+  const std::string input = body + "GET / HTTP/1.1\r\n";
+  for (size_t i = 0; i < sizeof(kReadSizes) / sizeof(kReadSizes[0]); ++i) {
+    DecodeResult res = Decode(input, kReadSizes[i]);
+    EXPECT_EQ(res.status, ChunkedDecoder::kFinished);
+    EXPECT_EQ(res.consumed, body.size());
+  }
+}
+
+TEST(ChunkedDecoderTest, Incomplete) {
+  const char *inputs[] = {"", "5", "5\r\n123", "5\r\n12345\r\n",
+                          "0\r\n", "0\r\nX-Trailer: 1\r\n"};
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    EXPECT_EQ(Decode(inputs[i], 1).status, ChunkedDecoder::kInProgress)
+        << inputs[i];
+  }
+}
+
+TEST(ChunkedDecoderTest, BadRequest) {
+  const char *inputs[] = {
+      // chunk-size が無い
+      "\r\n",
+      ";ext\r\n",
+      // 16進数ではない
+      "g\r\n",
+      "5x\r\n12345\r\n0\r\n\r\n",
+      // CR の無い LF
+      "5\n12345\r\n0\r\n\r\n",
+      "0\r\nX-Trailer: 1\n\r\n",
+      "0\r\n\n",
+      // chunk-data が chunk-size と合わない
+      "5\r\n123456\r\n0\r\n\r\n",
+      "5\r\n1234\r\n0\r\n\r\n",
+  };
+  for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); ++i) {
+    for (size_t j = 0; j < sizeof(kReadSizes) / sizeof(kReadSizes[0]); ++j) {
+      EXPECT_EQ(Decode(inputs[i], kReadSizes[j]).status,
+                ChunkedDecoder::kErrorBadRequest)
+          << inputs[i];
+    }
+  }
+}
+
+TEST(ChunkedDecoderTest, TooLongLine) {
+  std::string size_line =
+      "1;" + std::string(ChunkedDecoder::kMaxSizeLineSize, 'a') + "\r\n";
+  EXPECT_EQ(Decode(size_line + "a\r\n0\r\n\r\n", 1024).status,
+            ChunkedDecoder::kErrorBadRequest);
+  std::string trailer =
+      "X: " + std::string(ChunkedDecoder::kMaxTrailerSize, 'a') + "\r\n";
+  EXPECT_EQ(Decode("0\r\n" + trailer + "\r\n", 1024).status,
+            ChunkedDecoder::kErrorBadRequest);
+}
+
+// chunk-data の合計が上限を超える場合はデータが届く前にエラーにする
+TEST(ChunkedDecoderTest, TooLarge) {
+  EXPECT_EQ(Decode("5\r\n12345\r\n5\r\n12345\r\n0\r\n\r\n", 1024, 10).status,
+            ChunkedDecoder::kFinished);
+  EXPECT_EQ(Decode("5\r\n12345\r\n6\r\n", 1024, 10).status,
+            ChunkedDecoder::kErrorTooLarge);
+  EXPECT_EQ(Decode("fffffffffffffffffffff\r\n", 1024).status,
+            ChunkedDecoder::kErrorTooLarge);
+}
+
+}  // namespace http
@@ -0,0 +1,40 @@
+#include "http/known_header.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+namespace http {
+
+namespace {
+
+KnownHeader Lookup(const char *name) {
+  return LookupKnownHeader(name, std::strlen(name));
+}
+
+}  // namespace
+
+TEST(KnownHeaderTest, LookupKnownHeader) {
+  EXPECT_EQ(Lookup("Host"), kHeaderHost);
+  EXPECT_EQ(Lookup("Connection"), kHeaderConnection);
+  EXPECT_EQ(Lookup("Content-Length"), kHeaderContentLength);
+  EXPECT_EQ(Lookup("Content-Type"), kHeaderContentType);
+  EXPECT_EQ(Lookup("Transfer-Encoding"), kHeaderTransferEncoding);
+  // 大文字小文字は区別しない
+  EXPECT_EQ(Lookup("HOST"), kHeaderHost);
+  EXPECT_EQ(Lookup("content-length"), kHeaderContentLength);
+}
+
+TEST(KnownHeaderTest, LookupUnknownHeader) {
+  EXPECT_EQ(Lookup(""), kKnownHeaderNum);
+  EXPECT_EQ(Lookup("Hos"), kKnownHeaderNum);
+  EXPECT_EQ(Lookup("Hosts"), kKnownHeaderNum);
+  EXPECT_EQ(Lookup("Content-Lengtx"), kKnownHeaderNum);
+  EXPECT_EQ(Lookup("Cookie"), kKnownHeaderNum);
+  EXPECT_EQ(Lookup("User-Agent"), kKnownHeaderNum);
+  // 名前の一部だけが一致する場合
+  EXPECT_EQ(LookupKnownHeader("Hostname", 4), kHeaderHost);
+  EXPECT_EQ(LookupKnownHeader("Host", 3), kKnownHeaderNum);
+}
+
+}  // namespace http
@@ -6,7 +6,9 @@
 #include "http/http_request.hpp"
 #include "http/http_status.hpp"
 #include "result/result.hpp"
+#include "utils/ByteBuffer.hpp"
 #include "utils/ByteVector.hpp"
+#include "utils/SpoolBuffer.hpp"
 
 #define CRLF "\r\n"
 
@@ -16,18 +18,32 @@ const std::string kConfigurationDirPath = "unit_test/http/config/";
 const config::Config default_conf =
     config::ParseConfig(kConfigurationDirPath + "SimpleServer.conf");
 
-utils::ByteVector OpenFile(const std::string& name) {
+utils::ByteBuffer OpenFile(const std::string& name) {
   std::ifstream ifs(("./unit_test/http/req/" + name).c_str());
   std::stringstream ss;
   ss << ifs.rdbuf();
   std::string file_content = ss.str();
-  utils::ByteVector res(file_content);
+  utils::ByteBuffer res(file_content);
+  return res;
+}
+
+utils::ByteVector ReadBody(const http::HttpRequest& req) {
+  const utils::SpoolBuffer& body = req.GetBody();
+  utils::ByteVector res;
+  utils::Byte buf[1024];
+  while (res.size() < body.size()) {
+    Result<size_t> read_res = body.Read(res.size(), buf, sizeof(buf));
+    if (read_res.IsErr() || read_res.Ok() == 0) {
+      break;
+    }
+    res.AppendDataToBuffer(buf, read_res.Ok());
+  }
   return res;
 }
 
 TEST(RequestParserTest, KOFormatExistOBSfoldFirstHeader) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistOBSfoldFirstHeader.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistOBSfoldFirstHeader.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -36,7 +52,7 @@ TEST(RequestParserTest, KOFormatExistOBSfoldFirstHeader) {
 
 TEST(RequestParserTest, KOFormatExistOBSfold) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistOBSfold.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistOBSfold.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -45,7 +61,7 @@ TEST(RequestParserTest, KOFormatExistOBSfold) {
 
 TEST(RequestParserTest, KOFormatExistSPAfterVersion) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistSPAfterVersion.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistSPAfterVersion.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -54,7 +70,7 @@ TEST(RequestParserTest, KOFormatExistSPAfterVersion) {
 
 TEST(RequestParserTest, KOFormatExistSPBeforeSpace) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistSPBeforeSpace.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistSPBeforeSpace.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -63,7 +79,7 @@ TEST(RequestParserTest, KOFormatExistSPBeforeSpace) {
 
 TEST(RequestParserTest, KOFormatExistSPBetWeenMethodAndURL) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistSPBetWeenMethodAndURL.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistSPBetWeenMethodAndURL.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -72,7 +88,7 @@ TEST(RequestParserTest, KOFormatExistSPBetWeenMethodAndURL) {
 
 TEST(RequestParserTest, KOFormatExistSPBetWeenURLAndVersion) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistSPBetWeenURLAndVersion.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistSPBetWeenURLAndVersion.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -81,7 +97,7 @@ TEST(RequestParserTest, KOFormatExistSPBetWeenURLAndVersion) {
 
 TEST(RequestParserTest, KOFormatNotExistCRLF) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatNotExistCRLF.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatNotExistCRLF.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -90,7 +106,7 @@ TEST(RequestParserTest, KOFormatNotExistCRLF) {
 
 TEST(RequestParserTest, KOFormatNotExistHostHeader) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatNotExistHostHeader.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatNotExistHostHeader.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -99,7 +115,7 @@ TEST(RequestParserTest, KOFormatNotExistHostHeader) {
 
 TEST(RequestParserTest, KOFormatExistMultipleHostHeader) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatExistMultipleHostHeader.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatExistMultipleHostHeader.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -108,7 +124,7 @@ TEST(RequestParserTest, KOFormatExistMultipleHostHeader) {
 
 TEST(RequestParserTest, KOFormatNotExistMethod) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatNotExistMethod.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatNotExistMethod.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -117,7 +133,7 @@ TEST(RequestParserTest, KOFormatNotExistMethod) {
 
 TEST(RequestParserTest, KOFormatNotExistRequestLine) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatNotExistRequestLine.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatNotExistRequestLine.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -126,7 +142,7 @@ TEST(RequestParserTest, KOFormatNotExistRequestLine) {
 
 TEST(RequestParserTest, KOFormatNotExistURL) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatNotExistURL.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatNotExistURL.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -135,7 +151,7 @@ TEST(RequestParserTest, KOFormatNotExistURL) {
 
 TEST(RequestParserTest, KOFormatNotExistVersion) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFormatNotExistVersion.txt");
+  utils::ByteBuffer buf = OpenFile("KOFormatNotExistVersion.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -144,7 +160,7 @@ TEST(RequestParserTest, KOFormatNotExistVersion) {
 
 TEST(RequestParserTest, KOHeaderExistSPBeforeColon) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOHeaderExistSPBeforeColon.txt");
+  utils::ByteBuffer buf = OpenFile("KOHeaderExistSPBeforeColon.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -153,7 +169,7 @@ TEST(RequestParserTest, KOHeaderExistSPBeforeColon) {
 
 TEST(RequestParserTest, KOHeaderExistTabBeforeColon) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOHeaderExistTabBeforeColon.txt");
+  utils::ByteBuffer buf = OpenFile("KOHeaderExistTabBeforeColon.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -162,7 +178,7 @@ TEST(RequestParserTest, KOHeaderExistTabBeforeColon) {
 
 TEST(RequestParserTest, KOHeaderNotExistDquotePair) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOHeaderNotExistDquotePair.txt");
+  utils::ByteBuffer buf = OpenFile("KOHeaderNotExistDquotePair.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -171,7 +187,7 @@ TEST(RequestParserTest, KOHeaderNotExistDquotePair) {
 
 TEST(RequestParserTest, KOMethodNotAllowd) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOMethodNotAllowd.txt");
+  utils::ByteBuffer buf = OpenFile("KOMethodNotAllowd.txt");
   const config::Config not_allowed_conf =
       config::ParseConfig(kConfigurationDirPath + "NotAllowed.conf");
 
@@ -182,7 +198,7 @@ TEST(RequestParserTest, KOMethodNotAllowd) {
 
 TEST(RequestParserTest, KOUnknownMethod) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOUnknownMethod.txt");
+  utils::ByteBuffer buf = OpenFile("KOUnknownMethod.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -191,7 +207,7 @@ TEST(RequestParserTest, KOUnknownMethod) {
 
 TEST(RequestParserTest, KOURLTooLong) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOURLTooLong.txt");
+  utils::ByteBuffer buf = OpenFile("KOURLTooLong.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -200,7 +216,7 @@ TEST(RequestParserTest, KOURLTooLong) {
 
 TEST(RequestParserTest, KOContentLengthTooLong) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOContentLengthTooLong.txt");
+  utils::ByteBuffer buf = OpenFile("KOContentLengthTooLong.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -209,7 +225,7 @@ TEST(RequestParserTest, KOContentLengthTooLong) {
 
 TEST(RequestParserTest, KOVersioExistMultipleDot) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersioExistMultipleDot.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersioExistMultipleDot.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -218,7 +234,7 @@ TEST(RequestParserTest, KOVersioExistMultipleDot) {
 
 TEST(RequestParserTest, KOVersioInvalidMinorLong) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersioInvalidMinorLong.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersioInvalidMinorLong.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -227,7 +243,7 @@ TEST(RequestParserTest, KOVersioInvalidMinorLong) {
 
 TEST(RequestParserTest, KOVersionInvalidMajorLong) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersionInvalidMajorLong.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersionInvalidMajorLong.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -236,7 +252,7 @@ TEST(RequestParserTest, KOVersionInvalidMajorLong) {
 
 TEST(RequestParserTest, KOVersionInvalidMajorLower) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersionInvalidMajorLower.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersionInvalidMajorLower.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -245,7 +261,7 @@ TEST(RequestParserTest, KOVersionInvalidMajorLower) {
 
 TEST(RequestParserTest, KOVersionInvalidMajorUpper) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersionInvalidMajorUpper.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersionInvalidMajorUpper.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -254,7 +270,7 @@ TEST(RequestParserTest, KOVersionInvalidMajorUpper) {
 
 TEST(RequestParserTest, KOVersionInvalidPrefix) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersionInvalidPrefix.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersionInvalidPrefix.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -263,7 +279,7 @@ TEST(RequestParserTest, KOVersionInvalidPrefix) {
 
 TEST(RequestParserTest, KOVersioNotExistDot) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOVersioNotExistDot.txt");
+  utils::ByteBuffer buf = OpenFile("KOVersioNotExistDot.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -272,7 +288,7 @@ TEST(RequestParserTest, KOVersioNotExistDot) {
 
 TEST(RequestParserTest, OKCommaInDquote) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKCommaInDquote.txt");
+  utils::ByteBuffer buf = OpenFile("OKCommaInDquote.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -281,7 +297,7 @@ TEST(RequestParserTest, OKCommaInDquote) {
 
 TEST(RequestParserTest, OKCorrectNewLine) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKCorrectNewLine.txt");
+  utils::ByteBuffer buf = OpenFile("OKCorrectNewLine.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -290,7 +306,7 @@ TEST(RequestParserTest, OKCorrectNewLine) {
 
 TEST(RequestParserTest, KOLocationNotFound) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOLocationNotFound.txt");
+  utils::ByteBuffer buf = OpenFile("KOLocationNotFound.txt");
   const config::Config conf =
       config::ParseConfig(kConfigurationDirPath + "LocationNotFound.conf");
 
@@ -301,7 +317,7 @@ TEST(RequestParserTest, KOLocationNotFound) {
 
 TEST(RequestParserTest, OKCorrect) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKCorrect.txt");
+  utils::ByteBuffer buf = OpenFile("OKCorrect.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -310,7 +326,7 @@ TEST(RequestParserTest, OKCorrect) {
 
 TEST(RequestParserTest, OKHeaderDquoteStringEscape) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKHeaderDquoteStringEscape.txt");
+  utils::ByteBuffer buf = OpenFile("OKHeaderDquoteStringEscape.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -319,7 +335,7 @@ TEST(RequestParserTest, OKHeaderDquoteStringEscape) {
 
 TEST(RequestParserTest, OKHeaderDquoteString) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKHeaderDquoteString.txt");
+  utils::ByteBuffer buf = OpenFile("OKHeaderDquoteString.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -328,7 +344,7 @@ TEST(RequestParserTest, OKHeaderDquoteString) {
 
 TEST(RequestParserTest, OKHeaderExistOWSBeforeValue) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKHeaderExistOWSBeforeValue.txt");
+  utils::ByteBuffer buf = OpenFile("OKHeaderExistOWSBeforeValue.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -337,7 +353,7 @@ TEST(RequestParserTest, OKHeaderExistOWSBeforeValue) {
 
 TEST(RequestParserTest, OKHeaderExistOWSftrerValue) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKHeaderExistOWSftrerValue.txt");
+  utils::ByteBuffer buf = OpenFile("OKHeaderExistOWSftrerValue.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -346,7 +362,7 @@ TEST(RequestParserTest, OKHeaderExistOWSftrerValue) {
 
 TEST(RequestParserTest, OKHeaderListMultipleLine) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKHeaderListMultipleLine.txt");
+  utils::ByteBuffer buf = OpenFile("OKHeaderListMultipleLine.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -355,16 +371,96 @@ TEST(RequestParserTest, OKHeaderListMultipleLine) {
 
 TEST(RequestParserTest, OKHeaderList) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKHeaderList.txt");
+  utils::ByteBuffer buf = OpenFile("OKHeaderList.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
   EXPECT_EQ(req.GetParseStatus(), OK);
 }
 
+TEST(RequestParserTest, OKHeaderValues) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf = OpenFile("OKHeaderList.txt");
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  EXPECT_EQ(req.GetParseStatus(), OK);
+  Result<const std::vector<std::string> &> hoge = req.GetHeader("hOGE");
+  ASSERT_TRUE(hoge.IsOk());
+  ASSERT_EQ(hoge.Ok().size(), 2);
+  EXPECT_EQ(hoge.Ok()[0], "hoge");
+  EXPECT_EQ(hoge.Ok()[1], "fuga");
+  EXPECT_TRUE(req.GetHeader("Cookie").IsErr());
+  EXPECT_EQ(req.GetHeaders().size(), 2);
+}
+
+TEST(RequestParserTest, OKHeaderValuesEscaped) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf = OpenFile("OKHeaderDquoteStringEscape.txt");
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  Result<const std::vector<std::string> &> hoge = req.GetHeader("Hoge");
+  ASSERT_TRUE(hoge.IsOk());
+  ASSERT_EQ(hoge.Ok().size(), 1);
+  EXPECT_EQ(hoge.Ok()[0], "\"\\hello\\\"");
+}
+
+// 同じヘッダーが複数ある場合は最後のものが使われること
+TEST(RequestParserTest, OKHeaderValuesLastWins) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf = OpenFile("OKHeaderListMultipleLine.txt");
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  Result<const std::vector<std::string> &> hoge = req.GetHeader("Hoge");
+  ASSERT_TRUE(hoge.IsOk());
+  ASSERT_EQ(hoge.Ok().size(), 1);
+  EXPECT_EQ(hoge.Ok()[0], "fuga");
+
+  const HeaderMap &headers = req.GetHeaders();
+  ASSERT_EQ(headers.count("HOGE"), 1);
+  EXPECT_EQ(headers.find("HOGE")->second, hoge.Ok());
+  EXPECT_EQ(headers.count("HOST"), 1);
+}
+
+// 既知のヘッダーは名前でも KnownHeader でも同じ値を取り出せること
+TEST(RequestParserTest, OKKnownHeaders) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf(std::string("POST / HTTP/1.1" CRLF
+                                    "hOsT: localhost" CRLF
+                                    "Connection: keep-alive" CRLF
+                                    "content-type: text/plain" CRLF
+                                    "Content-Length: 5" CRLF
+                                    "Connection: close" CRLF
+                                    "X-Content-Length: 1" CRLF CRLF
+                                    "hello"));
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  ASSERT_EQ(req.GetParseStatus(), OK);
+  Result<const std::vector<std::string> &> host = req.GetHeader(kHeaderHost);
+  ASSERT_TRUE(host.IsOk());
+  ASSERT_EQ(host.Ok().size(), 1);
+  EXPECT_EQ(host.Ok()[0], "localhost");
+  EXPECT_EQ(&req.GetHeader("HOST").Ok(), &host.Ok());
+
+  Result<const std::vector<std::string> &> connection =
+      req.GetHeader(kHeaderConnection);
+  ASSERT_TRUE(connection.IsOk());
+  ASSERT_EQ(connection.Ok().size(), 1);
+  EXPECT_EQ(connection.Ok()[0], "close");
+  ASSERT_TRUE(req.GetHeader(kHeaderContentType).IsOk());
+  EXPECT_EQ(req.GetHeader(kHeaderContentType).Ok()[0], "text/plain");
+  EXPECT_TRUE(req.GetHeader(kHeaderTransferEncoding).IsErr());
+  ASSERT_TRUE(req.GetHeader("x-content-length").IsOk());
+  EXPECT_EQ(req.GetHeader("x-content-length").Ok()[0], "1");
+
+  const HeaderMap &headers = req.GetHeaders();
+  EXPECT_EQ(headers.size(), 5);
+  ASSERT_EQ(headers.count("CONTENT-TYPE"), 1);
+  EXPECT_EQ(headers.find("CONTENT-TYPE")->second[0], "text/plain");
+}
+
 TEST(RequestParserTest, OKVersionMinorUpper) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKVersionMinorUpper.txt");
+  utils::ByteBuffer buf = OpenFile("OKVersionMinorUpper.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -373,7 +469,7 @@ TEST(RequestParserTest, OKVersionMinorUpper) {
 
 TEST(RequestParserTest, KOBodyChunkSizeTooLarge) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOBodyChunkSizeTooLarge.txt");
+  utils::ByteBuffer buf = OpenFile("KOBodyChunkSizeTooLarge.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -382,16 +478,42 @@ TEST(RequestParserTest, KOBodyChunkSizeTooLarge) {
 
 TEST(RequestParserTest, KOBufferTooLarge) {
   http::HttpRequest req;
-  utils::ByteVector buf(std::string(1024 * 1024 + 1, 'G'));
+  utils::ByteBuffer buf(std::string(1024 * 1024 + 1, 'G'));
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
   EXPECT_EQ(req.GetParseStatus(), BAD_REQUEST);
 }
 
+// 接続のバッファが上限に達してもヘッダーが終わらない
+TEST(RequestParserTest, KOBufferLimitExceededInHeader) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf("GET / HTTP/1.1" CRLF "Host: localhost" CRLF
+                        "X-Long: aaaaaaaa");
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  EXPECT_FALSE(req.IsResponsible());
+  req.SetBufferLimitExceeded();
+  EXPECT_TRUE(req.IsErrorRequest() == true);
+  EXPECT_EQ(req.GetParseStatus(), REQUEST_HEADER_FIELDS_TOO_LARGE);
+}
+
+// 接続のバッファが上限に達してもボディが終わらない
+TEST(RequestParserTest, KOBufferLimitExceededInBody) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf("POST / HTTP/1.1" CRLF "Host: localhost" CRLF
+                        "Content-Length: 10" CRLF CRLF "12345");
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  EXPECT_FALSE(req.IsResponsible());
+  req.SetBufferLimitExceeded();
+  EXPECT_TRUE(req.IsErrorRequest() == true);
+  EXPECT_EQ(req.GetParseStatus(), PAYLOAD_TOO_LARGE);
+}
+
 TEST(RequestParserTest, KOBodyInvalidChunkSizeLower) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOBodyInvalidChunkSizeLower.txt");
+  utils::ByteBuffer buf = OpenFile("KOBodyInvalidChunkSizeLower.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -400,7 +522,7 @@ TEST(RequestParserTest, KOBodyInvalidChunkSizeLower) {
 
 TEST(RequestParserTest, KOBodyInvalidChunkSizeUpper) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOBodyInvalidChunkSizeUpper.txt");
+  utils::ByteBuffer buf = OpenFile("KOBodyInvalidChunkSizeUpper.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -409,7 +531,7 @@ TEST(RequestParserTest, KOBodyInvalidChunkSizeUpper) {
 
 TEST(RequestParserTest, KOBodyNotExistChunkSize) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOBodyNotExistChunkSize.txt");
+  utils::ByteBuffer buf = OpenFile("KOBodyNotExistChunkSize.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -418,7 +540,7 @@ TEST(RequestParserTest, KOBodyNotExistChunkSize) {
 
 TEST(RequestParserTest, KOFieldInvalidTransferEncoding) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("KOFieldInvalidTransferEncoding.txt");
+  utils::ByteBuffer buf = OpenFile("KOFieldInvalidTransferEncoding.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == true);
@@ -427,20 +549,20 @@ TEST(RequestParserTest, KOFieldInvalidTransferEncoding) {
 
 TEST(RequestParserTest, OKBodyChunkSizeZero) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKBodyChunkSizeZero.txt");
+  utils::ByteBuffer buf = OpenFile("OKBodyChunkSizeZero.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
   EXPECT_EQ(req.GetParseStatus(), OK);
 
   const utils::ByteVector expect_body("");
-  const utils::ByteVector body = req.GetBody();
+  const utils::ByteVector body = ReadBody(req);
   EXPECT_EQ(body, expect_body);
 }
 
 TEST(RequestParserTest, OKBodyCorrectChunkHexadecimal) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKBodyCorrectChunkHexadecimal.txt");
+  utils::ByteBuffer buf = OpenFile("OKBodyCorrectChunkHexadecimal.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
@@ -451,21 +573,80 @@ TEST(RequestParserTest, OKBodyCorrectChunkHexadecimal) {
       "345678901234567890123456789012345678901234567890123456789012345678901234"
       "567890123456789012345678901123456789012123456789012312345678901234123456"
       "789012345");
-  const utils::ByteVector body = req.GetBody();
+  const utils::ByteVector body = ReadBody(req);
   EXPECT_EQ(body, expect_body);
 }
 
 TEST(RequestParserTest, OKBodyCorrectChunk) {
   http::HttpRequest req;
-  utils::ByteVector buf = OpenFile("OKBodyCorrectChunk.txt");
+  utils::ByteBuffer buf = OpenFile("OKBodyCorrectChunk.txt");
 
   req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
   EXPECT_TRUE(req.IsErrorRequest() == false);
   EXPECT_EQ(req.GetParseStatus(), OK);
 
   const utils::ByteVector expect_body("12345abcde");
-  const utils::ByteVector body = req.GetBody();
+  const utils::ByteVector body = ReadBody(req);
+  EXPECT_EQ(body, expect_body);
+}
+
+// 1バイトずつ届いても途中から区切りを探して正しくパースできること
+TEST(RequestParserTest, OKBodyCorrectChunkArrivesByteByByte) {
+  http::HttpRequest req;
+  utils::ByteBuffer file = OpenFile("OKBodyCorrectChunk.txt");
+  utils::ByteBuffer buf;
+
+  for (size_t i = 0; i < file.size() && !req.IsResponsible(); ++i) {
+    buf.AppendDataToBuffer(&file[i], 1);
+    req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  }
+  EXPECT_TRUE(req.IsResponsible());
+  EXPECT_TRUE(req.IsErrorRequest() == false);
+  EXPECT_EQ(req.GetParseStatus(), OK);
+
+  const utils::ByteVector expect_body("12345abcde");
+  const utils::ByteVector body = ReadBody(req);
   EXPECT_EQ(body, expect_body);
 }
 
+// chunk-data の中の CRLF は区切りとして扱わず､次のリクエストは残す
+TEST(RequestParserTest, OKBodyChunkDataContainsCrlf) {
+  http::HttpRequest req;
+  utils::ByteBuffer buf(
+      "POST /hoge.txt HTTP/1.1\r\n"
+      "Host: localhost\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n"
+      "4;ext=1\r\n\r\n\r\n\r\n"
+      "0\r\n"
+      "X-Trailer: 1\r\n"
+      "\r\n"
+      "GET / HTTP/1.1\r\n");
+
+  req.ParseRequest(buf, default_conf, config::kAnyIpAddress, "8080");
+  EXPECT_TRUE(req.IsResponsible());
+  EXPECT_TRUE(req.IsErrorRequest() == false);
+  EXPECT_EQ(ReadBody(req), utils::ByteVector("\r\n\r\n"));
+  EXPECT_EQ(buf.SubstrBeforePos(buf.size()), "GET / HTTP/1.1\r\n");
+}
+
+// client_body_buffer_size を超えたボディは一時ファイルに書き出す
+TEST(RequestParserTest, OKBodySpooledOverClientBodyBufferSize) {
+  config::Config conf = default_conf;
+  conf.SetClientBodyBufferSize(4);
+  http::HttpRequest req;
+  utils::ByteBuffer buf = OpenFile("OKBodyCorrectChunk.txt");
+
+  req.ParseRequest(buf, conf, config::kAnyIpAddress, "8080");
+  EXPECT_TRUE(req.IsErrorRequest() == false);
+  EXPECT_EQ(req.GetParseStatus(), OK);
+  EXPECT_TRUE(req.GetBody().IsSpooled());
+
+  const utils::ByteVector expect_body("12345abcde");
+  EXPECT_EQ(ReadBody(req), expect_body);
+  // コピーしても同じボディを読み出せる
+  const http::HttpRequest copied(req);
+  EXPECT_EQ(ReadBody(copied), expect_body);
+}
+
 }  // namespace http
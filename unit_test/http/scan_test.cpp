@@ -0,0 +1,86 @@
+#include "http/scan.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace http {
+
+namespace {
+
+// CR だけや LF だけの場合を作るため､
+// CR と LF が多めに入ったランダムなバイト列を作る
+std::string CreateRandomBytes(size_t size) {
+  const char kChars[] = "\r\n\r\naZ09!~:(\"\x7f\x80\xff \t";
+  std::string res(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    res[i] = kChars[std::rand() % (sizeof(kChars) - 1)];
+  }
+  return res;
+}
+
+// tchar だけのバイト列の途中に tchar でないバイトを1つ入れる
+std::string CreateTcharRun(size_t size, size_t break_pos, char c) {
+  const std::string kTchars =
+      "!#$%&'*+-.^_`|~0123456789abcdefghijklmnopqrstuvwxyz"
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  std::string res(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    res[i] = kTchars[std::rand() % kTchars.size()];
+  }
+  if (break_pos < size) {
+    res[break_pos] = c;
+  }
+  return res;
+}
+
+}  // namespace
+
+TEST(ScanTest, FindCrlf) {
+  std::string str = std::string(40, 'a') + "\r\r\n" + std::string(40, 'b');
+  EXPECT_EQ(FindCrlf(str.data(), str.data() + str.size()), str.data() + 41);
+  // 末尾の CR だけでは見つからない
+  str = std::string(40, 'a') + "\n\r";
+  EXPECT_EQ(FindCrlf(str.data(), str.data() + str.size()),
+            str.data() + str.size());
+  // end の直前の CR の次のバイトは見ない
+  str = "ab\r\n";
+  EXPECT_EQ(FindCrlf(str.data(), str.data() + 3), str.data() + 3);
+  EXPECT_EQ(FindCrlf(str.data(), str.data()), str.data());
+}
+
+TEST(ScanTest, SpanTcharAllBytes) {
+  const std::string kDelimiters = "\"(),/:;<=>?@[\\]{}";
+  for (int c = 0; c < 256; ++c) {
+    bool is_tchar = 0x21 <= c && c <= 0x7e &&
+                    kDelimiters.find(static_cast<char>(c)) == std::string::npos;
+    for (size_t pos = 0; pos < 70; pos += 23) {
+      std::string str = CreateTcharRun(70, pos, static_cast<char>(c));
+      EXPECT_EQ(SpanTchar(str.data(), str.size()), is_tchar ? 70 : pos)
+          << "c = " << c << ", pos = " << pos;
+    }
+  }
+}
+
+// 1バイトずつ調べた結果と同じ位置を返すこと
+TEST(ScanTest, FindCrlfRandomBytes) {
+  std::srand(42);
+  for (int i = 0; i < 2000; ++i) {
+    const std::string bytes = CreateRandomBytes(std::rand() % 200);
+    const char *begin = bytes.data();
+    const char *end = bytes.data() + bytes.size();
+
+    const char *expected = end;
+    for (const char *p = begin; end - p >= 2; ++p) {
+      if (p[0] == '\r' && p[1] == '\n') {
+        expected = p;
+        break;
+      }
+    }
+    EXPECT_EQ(FindCrlf(begin, end), expected);
+  }
+}
+
+}  // namespace http
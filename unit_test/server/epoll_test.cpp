@@ -0,0 +1,414 @@
+#include "server/epoll.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "server/io_uring_backend.hpp"
+
+namespace server {
+
+namespace {
+
+void DoNothing(FdEvent *fde, unsigned int events, void *data, Epoll *epoll) {
+  (void)fde;
+  (void)events;
+  (void)data;
+  (void)epoll;
+}
+
+// io_uring のリングを閉じたスレッドではしばらくブロックするシステムコールが
+// EINTR になることがあるので､EventLoop と同じように EINTR は無視する
+Result<void> WaitEvents(Epoll &epoll, std::vector<FdEventEvent> &fdees,
+                        int timeout_ms) {
+  Result<void> res = epoll.WaitEvents(fdees, timeout_ms);
+  while (res.IsErr() && errno == EINTR) {
+    res = epoll.WaitEvents(fdees, timeout_ms);
+  }
+  return res;
+}
+
+// io_uring では CQE が非同期に来ることがあるので､
+// イベントが来るまで何回か WaitEvents() する
+void WaitSomeEvents(Epoll &epoll, std::vector<FdEventEvent> &fdees) {
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+    if (!fdees.empty()) {
+      return;
+    }
+  }
+}
+
+// WaitEvents() で送信を進めながら fd から size バイト読み込む｡
+// EOF になったら読み込めた分だけ返す｡
+std::string ReceiveWhileWaiting(Epoll &epoll, int fd, size_t size) {
+  std::string res;
+  std::vector<FdEventEvent> fdees;
+  char buf[4096];
+  for (int i = 0; i < 100 && res.size() < size; ++i) {
+    if (WaitEvents(epoll, fdees, 10).IsErr()) {
+      break;
+    }
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+      res.append(buf, n);
+    }
+    if (n == 0) {
+      break;
+    }
+  }
+  return res;
+}
+
+class EpollTest
+    : public ::testing::TestWithParam<config::Config::EventBackend> {
+ protected:
+  int fds_[2];
+  FdEvent *fde_;
+
+  virtual void SetUp() {
+    fds_[0] = -1;
+    fds_[1] = -1;
+    fde_ = NULL;
+    if (GetParam() == config::Config::kIoUringBackend) {
+      IoUringBackend *backend = IoUringBackend::Create();
+      if (backend == NULL) {
+        GTEST_SKIP() << "io_uring is not available";
+      }
+      delete backend;
+    }
+    ASSERT_EQ(pipe(fds_), 0);
+    fde_ = CreateFdEvent(fds_[0], DoNothing, NULL);
+    // 読み込み可能な状態にしておく
+    ASSERT_EQ(write(fds_[1], "a", 1), 1);
+  }
+
+  virtual void TearDown() {
+    delete fde_;
+    if (fds_[0] >= 0) {
+      close(fds_[0]);
+      close(fds_[1]);
+    }
+  }
+
+  const char *GetExpectedBackendName() const {
+    return GetParam() == config::Config::kIoUringBackend ? "io_uring"
+                                                         : "epoll";
+  }
+};
+
+// Read(), Writev() で読み書きする接続ソケットのテスト
+// sock_fds_[0] を RegisterStream() し､sock_fds_[1] を相手側として使う｡
+class EpollStreamTest : public EpollTest {
+ protected:
+  int sock_fds_[2];
+  FdEvent *sock_fde_;
+
+  virtual void SetUp() {
+    sock_fds_[0] = -1;
+    sock_fds_[1] = -1;
+    sock_fde_ = NULL;
+    EpollTest::SetUp();
+    if (IsSkipped()) {
+      return;
+    }
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sock_fds_), 0);
+    ASSERT_EQ(fcntl(sock_fds_[0], F_SETFL, O_NONBLOCK), 0);
+    ASSERT_EQ(fcntl(sock_fds_[1], F_SETFL, O_NONBLOCK), 0);
+    sock_fde_ = CreateFdEvent(sock_fds_[0], DoNothing, NULL);
+  }
+
+  virtual void TearDown() {
+    delete sock_fde_;
+    if (sock_fds_[0] >= 0) {
+      close(sock_fds_[0]);
+    }
+    if (sock_fds_[1] >= 0) {
+      close(sock_fds_[1]);
+    }
+    EpollTest::TearDown();
+  }
+};
+
+}  // namespace
+
+TEST_P(EpollTest, UseSpecifiedBackend) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  EXPECT_STREQ(epoll.GetBackendName(), GetExpectedBackendName());
+}
+
+TEST_P(EpollTest, NotifyReadEvent) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.Register(fde_);
+  epoll.Add(fde_, kFdeRead);
+
+  std::vector<FdEventEvent> fdees;
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+  EXPECT_EQ(fdees[0].fde, fde_);
+  EXPECT_TRUE(fdees[0].events & kFdeRead);
+
+  epoll.Unregister(fde_);
+}
+
+// レベルトリガーでは読み込むまで毎回通知される｡
+// (io_uring では通知した fd を次の WaitEvents() で POLL_ADD し直す)
+TEST_P(EpollTest, NotifyAgainUntilReadInLevelTriggered) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.Register(fde_);
+  epoll.Add(fde_, kFdeRead);
+
+  std::vector<FdEventEvent> fdees;
+  for (int i = 0; i < 3; ++i) {
+    WaitSomeEvents(epoll, fdees);
+    ASSERT_EQ(fdees.size(), 1u);
+    EXPECT_EQ(fdees[0].fde, fde_);
+  }
+
+  char c;
+  ASSERT_EQ(read(fds_[0], &c, 1), 1);
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+
+  // 読み込み可能になったらまた通知される
+  ASSERT_EQ(write(fds_[1], "a", 1), 1);
+  WaitSomeEvents(epoll, fdees);
+  EXPECT_EQ(fdees.size(), 1u);
+
+  epoll.Unregister(fde_);
+}
+
+TEST_P(EpollTest, CancelledChangeIsNotApplied) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.Register(fde_);
+  epoll.Add(fde_, kFdeRead);
+  epoll.Del(fde_, kFdeRead);
+
+  std::vector<FdEventEvent> fdees;
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+
+  epoll.Add(fde_, kFdeRead);
+  WaitSomeEvents(epoll, fdees);
+  EXPECT_EQ(fdees.size(), 1u);
+
+  epoll.Unregister(fde_);
+}
+
+TEST_P(EpollTest, UnregisterBeforeWait) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.Register(fde_);
+  epoll.Add(fde_, kFdeRead);
+  epoll.Unregister(fde_);
+
+  std::vector<FdEventEvent> fdees;
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+  EXPECT_EQ(epoll.GetFdeByFd(fds_[0]), static_cast<FdEvent *>(NULL));
+}
+
+// 監視を登録し直す前の監視のイベントは通知されない｡
+// (io_uring では user_data の generation が古い CQE を捨てる)
+TEST_P(EpollTest, StaleEventIsDropped) {
+  char c;
+  ASSERT_EQ(read(fds_[0], &c, 1), 1);
+
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.Register(fde_);
+  epoll.Add(fde_, kFdeRead);
+  std::vector<FdEventEvent> fdees;
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+
+  // 読み込みの監視中に同じ fd を別の FdEvent で登録し直す
+  epoll.Unregister(fde_);
+  FdEvent *new_fde = CreateFdEvent(fds_[0], DoNothing, NULL);
+  epoll.Register(new_fde);
+  epoll.Add(new_fde, kFdeWrite);
+  ASSERT_EQ(write(fds_[1], "a", 1), 1);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+    EXPECT_TRUE(fdees.empty());
+  }
+
+  epoll.Add(new_fde, kFdeRead);
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+  EXPECT_EQ(fdees[0].fde, new_fde);
+  EXPECT_EQ(fdees[0].events, static_cast<unsigned int>(kFdeRead));
+
+  epoll.Unregister(new_fde);
+  delete new_fde;
+}
+
+// 同じ fd の読み込み･書き込みのイベントは1つにまとめて通知される
+TEST_P(EpollTest, MergeEventsOfSameFd) {
+  for (int is_et = 0; is_et < 2; ++is_et) {
+    int sock_fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sock_fds), 0);
+    ASSERT_EQ(write(sock_fds[1], "a", 1), 1);
+    FdEvent *fde = CreateFdEvent(sock_fds[0], DoNothing, NULL);
+
+    Epoll epoll(Epoll::kDefaultMaxEvents, is_et, GetParam());
+    epoll.Register(fde);
+    epoll.Add(fde, kFdeRead | kFdeWrite);
+
+    std::vector<FdEventEvent> fdees;
+    WaitSomeEvents(epoll, fdees);
+    ASSERT_EQ(fdees.size(), 1u) << "is_et: " << is_et;
+    EXPECT_EQ(fdees[0].events, static_cast<unsigned int>(kFdeRead | kFdeWrite))
+        << "is_et: " << is_et;
+
+    epoll.Unregister(fde);
+    delete fde;
+    close(sock_fds[0]);
+    close(sock_fds[1]);
+  }
+}
+
+TEST_P(EpollTest, RearmNotifiesAgainInEdgeTriggered) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, true, GetParam());
+  epoll.Register(fde_);
+  epoll.Add(fde_, kFdeRead);
+
+  std::vector<FdEventEvent> fdees;
+  WaitSomeEvents(epoll, fdees);
+  EXPECT_EQ(fdees.size(), 1u);
+  // エッジトリガーなので読み込まなくても再度通知されない
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+
+  epoll.Rearm(fde_);
+  WaitSomeEvents(epoll, fdees);
+  EXPECT_EQ(fdees.size(), 1u);
+
+  epoll.Unregister(fde_);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, EpollTest,
+                         ::testing::Values(config::Config::kEpollBackend,
+                                           config::Config::kIoUringBackend));
+
+TEST_P(EpollStreamTest, ReadReceivedData) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.RegisterStream(sock_fde_);
+  epoll.Add(sock_fde_, kFdeRead);
+
+  std::vector<FdEventEvent> fdees;
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+
+  ASSERT_EQ(write(sock_fds_[1], "hello", 5), 5);
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+  EXPECT_EQ(fdees[0].events, static_cast<unsigned int>(kFdeRead));
+  // レベルトリガーなので読み込むまで通知される
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+
+  char buf[16];
+  Result<size_t> res = epoll.Read(sock_fde_, buf, sizeof(buf));
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(std::string(buf, res.Ok()), "hello");
+  res = epoll.Read(sock_fde_, buf, sizeof(buf));
+  ASSERT_TRUE(res.IsErr());
+  EXPECT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+
+  // 相手が閉じたら 0 を返す
+  close(sock_fds_[1]);
+  sock_fds_[1] = -1;
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+  res = epoll.Read(sock_fde_, buf, sizeof(buf));
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 0u);
+
+  epoll.Unregister(sock_fde_);
+}
+
+// 読み込みの監視を止めている間に受信したデータも読み込める
+TEST_P(EpollStreamTest, ReadDataReceivedBeforeDel) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.RegisterStream(sock_fde_);
+  epoll.Add(sock_fde_, kFdeRead);
+
+  ASSERT_EQ(write(sock_fds_[1], "hello", 5), 5);
+  std::vector<FdEventEvent> fdees;
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+
+  epoll.Del(sock_fde_, kFdeRead);
+  ASSERT_TRUE(WaitEvents(epoll, fdees, 10).IsOk());
+  EXPECT_TRUE(fdees.empty());
+
+  epoll.Add(sock_fde_, kFdeRead);
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+  char buf[16];
+  Result<size_t> res = epoll.Read(sock_fde_, buf, sizeof(buf));
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(std::string(buf, res.Ok()), "hello");
+
+  epoll.Unregister(sock_fde_);
+}
+
+TEST_P(EpollStreamTest, WriteThroughSink) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.RegisterStream(sock_fde_);
+  epoll.Add(sock_fde_, kFdeWrite);
+
+  std::vector<FdEventEvent> fdees;
+  WaitSomeEvents(epoll, fdees);
+  ASSERT_EQ(fdees.size(), 1u);
+  EXPECT_EQ(fdees[0].events, static_cast<unsigned int>(kFdeWrite));
+
+  FdEventSink sink(&epoll, sock_fde_);
+  std::string header = "header\n";
+  std::string body = "body\n";
+  iovec iov[2];
+  iov[0].iov_base = &header[0];
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = &body[0];
+  iov[1].iov_len = body.size();
+  Result<size_t> res = sink.Writev(iov, 2, false);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), header.size() + body.size());
+
+  EXPECT_EQ(ReceiveWhileWaiting(epoll, sock_fds_[1], 12), "header\nbody\n");
+
+  epoll.Unregister(sock_fde_);
+}
+
+// ShutDown() は書き込んだデータを送り終えてから相手に EOF を送る
+TEST_P(EpollStreamTest, ShutDownAfterSendingData) {
+  Epoll epoll(Epoll::kDefaultMaxEvents, false, GetParam());
+  epoll.RegisterStream(sock_fde_);
+  epoll.Add(sock_fde_, kFdeRead);
+
+  std::string data(64 * 1024, 'x');
+  iovec iov;
+  iov.iov_base = &data[0];
+  iov.iov_len = data.size();
+  Result<size_t> res = epoll.Writev(sock_fde_, &iov, 1, false);
+  ASSERT_TRUE(res.IsOk());
+  std::string expected = data.substr(0, res.Ok());
+  ASSERT_TRUE(epoll.ShutDown(sock_fde_).IsOk());
+
+  EXPECT_EQ(ReceiveWhileWaiting(epoll, sock_fds_[1], data.size() + 1),
+            expected);
+
+  epoll.Unregister(sock_fde_);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, EpollStreamTest,
+                         ::testing::Values(config::Config::kEpollBackend,
+                                           config::Config::kIoUringBackend));
+
+}  // namespace server
@@ -0,0 +1,224 @@
+#include "server/timer_wheel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "server/epoll.hpp"
+
+namespace server {
+
+namespace {
+
+FdEvent *CreateTimerFdEvent(int fd, long last_active, long timeout_ms) {
+  FdEvent *fde = CreateFdEvent(fd, NULL, NULL);
+  fde->last_active = last_active;
+  fde->timeout_ms = timeout_ms;
+  return fde;
+}
+
+bool Contains(const std::vector<FdEvent *> &fdes, FdEvent *fde) {
+  return std::find(fdes.begin(), fdes.end(), fde) != fdes.end();
+}
+
+}  // namespace
+
+TEST(TimerWheelTest, ExpireAfterTimeout) {
+  TimerWheel timer_wheel(0);
+  FdEvent *fde = CreateTimerFdEvent(0, 0, 100);
+  timer_wheel.Arm(fde, 0);
+
+  std::vector<FdEvent *> expired;
+  timer_wheel.RetrieveExpired(100, expired);
+  EXPECT_TRUE(expired.empty());
+
+  timer_wheel.RetrieveExpired(101, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], fde);
+
+  timer_wheel.Disarm(fde);
+  EXPECT_EQ(timer_wheel.Size(), 0u);
+  delete fde;
+}
+
+TEST(TimerWheelTest, ExpiredTimerIsNotifiedUntilDisarmed) {
+  TimerWheel timer_wheel(0);
+  FdEvent *fde = CreateTimerFdEvent(0, 0, 10);
+  timer_wheel.Arm(fde, 0);
+
+  std::vector<FdEvent *> expired;
+  timer_wheel.RetrieveExpired(20, expired);
+  EXPECT_EQ(expired.size(), 1u);
+  expired.clear();
+  timer_wheel.RetrieveExpired(21, expired);
+  EXPECT_EQ(expired.size(), 1u);
+
+  timer_wheel.Disarm(fde);
+  expired.clear();
+  timer_wheel.RetrieveExpired(30, expired);
+  EXPECT_TRUE(expired.empty());
+  delete fde;
+}
+
+TEST(TimerWheelTest, ActivityExtendsTimeout) {
+  TimerWheel timer_wheel(0);
+  FdEvent *fde = CreateTimerFdEvent(0, 0, 5000);
+  timer_wheel.Arm(fde, 0);
+
+  std::vector<FdEvent *> expired;
+  // ホイールを操作せずに last_active を更新するだけで延長される
+  fde->last_active = 4000;
+  timer_wheel.RetrieveExpired(5001, expired);
+  EXPECT_TRUE(expired.empty());
+  timer_wheel.RetrieveExpired(9000, expired);
+  EXPECT_TRUE(expired.empty());
+  timer_wheel.RetrieveExpired(9001, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], fde);
+
+  timer_wheel.Disarm(fde);
+  delete fde;
+}
+
+TEST(TimerWheelTest, ExpireAcrossLevels) {
+  const long kTimeouts[] = {1, 63, 64, 65, 4095, 4096, 5000, 300000};
+  const size_t kNum = sizeof(kTimeouts) / sizeof(kTimeouts[0]);
+
+  TimerWheel timer_wheel(0);
+  std::vector<FdEvent *> fdes;
+  for (size_t i = 0; i < kNum; ++i) {
+    fdes.push_back(CreateTimerFdEvent(i, 0, kTimeouts[i]));
+    timer_wheel.Arm(fdes[i], 0);
+  }
+
+  for (size_t i = 0; i < kNum; ++i) {
+    std::vector<FdEvent *> expired;
+    timer_wheel.RetrieveExpired(kTimeouts[i], expired);
+    EXPECT_FALSE(Contains(expired, fdes[i])) << kTimeouts[i];
+    timer_wheel.RetrieveExpired(kTimeouts[i] + 1, expired);
+    EXPECT_TRUE(Contains(expired, fdes[i])) << kTimeouts[i];
+    timer_wheel.Disarm(fdes[i]);
+  }
+  EXPECT_EQ(timer_wheel.Size(), 0u);
+
+  for (size_t i = 0; i < kNum; ++i) {
+    delete fdes[i];
+  }
+}
+
+TEST(TimerWheelTest, RearmMovesTimer) {
+  TimerWheel timer_wheel(0);
+  FdEvent *fde = CreateTimerFdEvent(0, 0, 100);
+  timer_wheel.Arm(fde, 0);
+  fde->timeout_ms = 10;
+  timer_wheel.Arm(fde, 0);
+  EXPECT_EQ(timer_wheel.Size(), 1u);
+
+  std::vector<FdEvent *> expired;
+  timer_wheel.RetrieveExpired(11, expired);
+  ASSERT_EQ(expired.size(), 1u);
+
+  timer_wheel.Disarm(fde);
+  delete fde;
+}
+
+TEST(TimerWheelTest, TimeUntilNextExpire) {
+  TimerWheel timer_wheel(0);
+  EXPECT_EQ(timer_wheel.GetTimeUntilNextExpire(0), -1);
+
+  FdEvent *fde = CreateTimerFdEvent(0, 0, 30);
+  timer_wheel.Arm(fde, 0);
+  EXPECT_EQ(timer_wheel.GetTimeUntilNextExpire(0), 31);
+  EXPECT_EQ(timer_wheel.GetTimeUntilNextExpire(10), 21);
+  EXPECT_EQ(timer_wheel.GetTimeUntilNextExpire(40), 0);
+
+  timer_wheel.Disarm(fde);
+  EXPECT_EQ(timer_wheel.GetTimeUntilNextExpire(0), -1);
+  delete fde;
+}
+
+TEST(TimerWheelTest, TimeUntilNextExpireIsNeverLate) {
+  const long kTimeouts[] = {1, 63, 64, 65, 100, 4095, 4096, 5000, 300000};
+  const size_t kNum = sizeof(kTimeouts) / sizeof(kTimeouts[0]);
+
+  for (size_t i = 0; i < kNum; ++i) {
+    TimerWheel timer_wheel(0);
+    FdEvent *fde = CreateTimerFdEvent(0, 0, kTimeouts[i]);
+    timer_wheel.Arm(fde, 0);
+
+    // 返された時間だけ待つことを繰り返すと､期限を過ぎずに期限切れを受け取れる
+    long now = 0;
+    std::vector<FdEvent *> expired;
+    while (expired.empty()) {
+      long timeout = timer_wheel.GetTimeUntilNextExpire(now);
+      ASSERT_GE(timeout, 0) << kTimeouts[i];
+      now += timeout;
+      ASSERT_LE(now, kTimeouts[i] + 1) << kTimeouts[i];
+      timer_wheel.RetrieveExpired(now, expired);
+    }
+    EXPECT_EQ(now, kTimeouts[i] + 1) << kTimeouts[i];
+
+    timer_wheel.Disarm(fde);
+    delete fde;
+  }
+}
+
+// タイマーがない間に時間が経ってから登録しても､経過した時間を基準にしない
+TEST(TimerWheelTest, ArmAfterLongIdle) {
+  TimerWheel timer_wheel(0);
+  FdEvent *fde = CreateTimerFdEvent(0, 0, 10);
+  timer_wheel.Arm(fde, 0);
+  std::vector<FdEvent *> expired;
+  timer_wheel.RetrieveExpired(11, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  timer_wheel.Disarm(fde);
+
+  // 6時間 RetrieveExpired() を呼ばずに待っていた
+  const long kNow = 6L * 60 * 60 * 1000;
+  fde->last_active = kNow;
+  fde->timeout_ms = 60 * 1000;
+  timer_wheel.Arm(fde, kNow);
+  long timeout = timer_wheel.GetTimeUntilNextExpire(kNow);
+  EXPECT_GT(timeout, 0);
+  EXPECT_LE(timeout, 60 * 1000 + 1);
+
+  expired.clear();
+  timer_wheel.RetrieveExpired(kNow + 60 * 1000, expired);
+  EXPECT_TRUE(expired.empty());
+  timer_wheel.RetrieveExpired(kNow + 60 * 1000 + 1, expired);
+  ASSERT_EQ(expired.size(), 1u);
+  EXPECT_EQ(expired[0], fde);
+
+  timer_wheel.Disarm(fde);
+  delete fde;
+}
+
+// 空のスロットを飛ばしても､長い間隔で呼ばれた時に期限を取りこぼさない
+TEST(TimerWheelTest, RetrieveExpiredAfterLongGap) {
+  const long kTimeouts[] = {1, 64, 4096, 300000, 4000000};
+  const size_t kNum = sizeof(kTimeouts) / sizeof(kTimeouts[0]);
+
+  TimerWheel timer_wheel(0);
+  std::vector<FdEvent *> fdes;
+  for (size_t i = 0; i < kNum; ++i) {
+    fdes.push_back(CreateTimerFdEvent(i, 0, kTimeouts[i]));
+    timer_wheel.Arm(fdes[i], 0);
+  }
+
+  std::vector<FdEvent *> expired;
+  timer_wheel.RetrieveExpired(kTimeouts[kNum - 1], expired);
+  EXPECT_EQ(expired.size(), kNum - 1);
+  EXPECT_FALSE(Contains(expired, fdes[kNum - 1]));
+  expired.clear();
+  timer_wheel.RetrieveExpired(kTimeouts[kNum - 1] + 1, expired);
+  // 期限切れのタイマーは Disarm() されるまで毎回通知される
+  EXPECT_EQ(expired.size(), kNum);
+
+  for (size_t i = 0; i < kNum; ++i) {
+    timer_wheel.Disarm(fdes[i]);
+    delete fdes[i];
+  }
+}
+
+}  // namespace server
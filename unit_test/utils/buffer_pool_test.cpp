@@ -0,0 +1,55 @@
+#include "utils/BufferPool.hpp"
+
+#include <gtest/gtest.h>
+
+namespace utils {
+
+TEST(BufferPoolTest, RoundUpToClassSize) {
+  size_t capacity;
+  Byte *buf = BufferPool::Allocate(1, &capacity);
+  EXPECT_EQ(capacity, 4 * 1024);
+  BufferPool::Free(buf, capacity);
+
+  buf = BufferPool::Allocate(4 * 1024 + 1, &capacity);
+  EXPECT_EQ(capacity, 16 * 1024);
+  BufferPool::Free(buf, capacity);
+
+  buf = BufferPool::Allocate(64 * 1024, &capacity);
+  EXPECT_EQ(capacity, 64 * 1024);
+  BufferPool::Free(buf, capacity);
+
+  // 一番大きい区分より大きい場合は切り上げない
+  buf = BufferPool::Allocate(64 * 1024 + 1, &capacity);
+  EXPECT_EQ(capacity, 64 * 1024 + 1);
+  BufferPool::Free(buf, capacity);
+}
+
+TEST(BufferPoolTest, ReuseFreedBuffer) {
+  size_t capacity;
+  Byte *buf = BufferPool::Allocate(16 * 1024, &capacity);
+  size_t free_num = BufferPool::GetFreeNum(capacity);
+  BufferPool::Free(buf, capacity);
+  EXPECT_EQ(BufferPool::GetFreeNum(capacity), free_num + 1);
+
+  size_t reused_capacity;
+  Byte *reused = BufferPool::Allocate(10 * 1024, &reused_capacity);
+  EXPECT_EQ(reused, buf);
+  EXPECT_EQ(reused_capacity, capacity);
+  EXPECT_EQ(BufferPool::GetFreeNum(capacity), free_num);
+  BufferPool::Free(reused, reused_capacity);
+}
+
+TEST(BufferPoolTest, LimitFreeNum) {
+  const int kNum = 1000;
+  Byte *bufs[kNum];
+  size_t capacity;
+  for (int i = 0; i < kNum; ++i) {
+    bufs[i] = BufferPool::Allocate(4 * 1024, &capacity);
+  }
+  for (int i = 0; i < kNum; ++i) {
+    BufferPool::Free(bufs[i], capacity);
+  }
+  EXPECT_LT(BufferPool::GetFreeNum(capacity), static_cast<size_t>(kNum));
+}
+
+}  // namespace utils
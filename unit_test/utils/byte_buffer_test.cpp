@@ -0,0 +1,109 @@
+#include "utils/ByteBuffer.hpp"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+namespace utils {
+
+TEST(ByteBufferTest, AppendAndEraseHead) {
+  ByteBuffer buffer("GET / HTTP/1.1\r\n");
+  EXPECT_EQ(buffer.size(), 16);
+  EXPECT_TRUE(buffer.CompareHead("GET"));
+
+  buffer.EraseHead(4);
+  EXPECT_EQ(buffer.SubstrBeforePos(buffer.size()), "/ HTTP/1.1\r\n");
+  EXPECT_EQ(buffer[0], '/');
+
+  buffer.AppendDataToBuffer(std::string("Host: a\r\n"));
+  EXPECT_EQ(buffer.CutSubstrBeforePos(2), "/ ");
+  EXPECT_EQ(buffer.SubstrBeforePos(buffer.size()), "HTTP/1.1\r\nHost: a\r\n");
+
+  buffer.EraseHead(buffer.size());
+  EXPECT_TRUE(buffer.empty());
+}
+
+TEST(ByteBufferTest, FindString) {
+  ByteBuffer buffer("xxAB\r\n\r\nyy");
+  buffer.EraseHead(2);
+  Result<size_t> res = buffer.FindString("\r\n\r\n");
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 2);
+  EXPECT_TRUE(buffer.FindString("xx").IsErr());
+  EXPECT_TRUE(buffer.FindString(std::string(100, 'y')).IsErr());
+}
+
+TEST(ByteBufferTest, FindStringFromResumePos) {
+  ByteBuffer buffer("Host: a\r\n\r");
+  const std::string boundary = "\r\n\r\n";
+  EXPECT_TRUE(buffer.FindString(boundary).IsErr());
+  size_t resume_pos = buffer.GetResumePos(boundary);
+  EXPECT_EQ(resume_pos, 7);
+
+  // 区切りが2回の読み込みにまたがっても見つかること
+  buffer.AppendDataToBuffer(std::string("\nbody\r\n\r\n"));
+  Result<size_t> res = buffer.FindString(boundary, resume_pos);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 7);
+  res = buffer.FindString(boundary, res.Ok() + 1);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 15);
+  EXPECT_TRUE(buffer.FindString(boundary, buffer.size()).IsErr());
+  EXPECT_TRUE(buffer.FindString(boundary, buffer.size() + 1).IsErr());
+}
+
+TEST(ByteBufferTest, PrepareAndCommitWrite) {
+  ByteBuffer buffer("abc");
+  Byte *p = buffer.PrepareWrite(4096);
+  EXPECT_GE(buffer.GetWritableSize(), 4096);
+  std::memcpy(p, "defg", 4);
+  buffer.CommitWrite(4);
+  EXPECT_EQ(buffer.SubstrBeforePos(buffer.size()), "abcdefg");
+}
+
+// 読み込みと消費を繰り返してもデータが壊れず､メモリが増え続けないこと
+TEST(ByteBufferTest, ReuseConsumedSpace) {
+  ByteBuffer buffer;
+  std::string expected;
+  for (int i = 0; i < 10000; ++i) {
+    std::string data(i % 97 + 1, static_cast<char>('a' + i % 26));
+    buffer.AppendDataToBuffer(data);
+    expected += data;
+    size_t erase_size = expected.size() / 2 + 1;
+    buffer.EraseHead(erase_size);
+    expected.erase(0, erase_size);
+    ASSERT_EQ(buffer.SubstrBeforePos(buffer.size()), expected);
+  }
+  EXPECT_LE(buffer.size() + buffer.GetWritableSize(), 4096);
+}
+
+// 空になったら領域を返し､待機中に領域を持ち続けないこと
+TEST(ByteBufferTest, ReleaseWhenDrained) {
+  ByteBuffer buffer("abc");
+  EXPECT_GT(buffer.GetWritableSize(), 0);
+  buffer.EraseHead(3);
+  EXPECT_EQ(buffer.GetWritableSize(), 0);
+
+  buffer.PrepareWrite(4096);
+  EXPECT_GE(buffer.GetWritableSize(), 4096);
+  buffer.ReleaseIfEmpty();
+  EXPECT_EQ(buffer.GetWritableSize(), 0);
+
+  buffer.AppendDataToBuffer(std::string("def"));
+  buffer.ReleaseIfEmpty();
+  EXPECT_EQ(buffer.SubstrBeforePos(buffer.size()), "def");
+}
+
+TEST(ByteBufferTest, Copy) {
+  ByteBuffer buffer("hello world");
+  buffer.EraseHead(6);
+  ByteBuffer copied(buffer);
+  buffer.EraseHead(5);
+  EXPECT_EQ(copied.SubstrBeforePos(copied.size()), "world");
+
+  buffer = copied;
+  EXPECT_EQ(buffer.SubstrBeforePos(buffer.size()), "world");
+}
+
+}  // namespace utils
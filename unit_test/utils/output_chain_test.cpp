@@ -0,0 +1,295 @@
+#include "utils/OutputChain.hpp"
+
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace utils {
+
+namespace {
+
+std::string ReadAll(int fd) {
+  std::string res;
+  char buf[4096];
+  ssize_t n;
+  while ((n = read(fd, buf, sizeof(buf))) > 0) {
+    res.append(buf, n);
+  }
+  return res;
+}
+
+// content を書き込んだ一時ファイルを開く
+int OpenTmpFile(const std::string &content) {
+  char path[] = "/tmp/output_chain_test_XXXXXX";
+  int fd = mkstemp(path);
+  unlink(path);
+  EXPECT_EQ(write(fd, content.data(), content.size()),
+            static_cast<ssize_t>(content.size()));
+  return fd;
+}
+
+}  // namespace
+
+TEST(OutputChainTest, WriteAllSegmentsInOrder) {
+  std::string file_content(100 * 1024, 'f');
+  int file_fd = OpenTmpFile(file_content);
+  SharedBlob *blob = new SharedBlob("shared\n");
+
+  OutputChain chain;
+  ByteVector header(std::string("header\n"));
+  chain.AppendBytes(header);
+  EXPECT_TRUE(header.empty());
+  chain.AppendShared(blob);
+  chain.AppendFile(file_fd, 10, file_content.size() - 10);
+  chain.AppendBytes(std::string("trailer\n"));
+  blob->Unref();
+  EXPECT_EQ(chain.size(), 7 + 7 + file_content.size() - 10 + 8);
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  // ヘッダーとファイルの最初のブロックは1回の writev で書き込まれる
+  Result<size_t> res = chain.WriteTo(fds[0], 1024 * 1024);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 7 + 7 + OutputChain::kFileReadSize);
+  while (!chain.empty()) {
+    ASSERT_TRUE(chain.WriteTo(fds[0], 1024 * 1024).IsOk());
+  }
+  close(fds[0]);
+
+  EXPECT_EQ(ReadAll(fds[1]), "header\nshared\n" + file_content.substr(10) +
+                                 "trailer\n");
+  close(fds[1]);
+  close(file_fd);
+}
+
+TEST(OutputChainTest, SendFile) {
+  std::string file_content(100 * 1024, 'f');
+  int file_fd = OpenTmpFile(file_content);
+
+  OutputChain chain;
+  chain.SetUseSendfile(true);
+  chain.AppendBytes(std::string("header\n"));
+  chain.AppendFile(file_fd, 10, file_content.size() - 10);
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  // ヘッダーを書き込んでからファイルを sendfile で送る
+  Result<size_t> res = chain.WriteTo(fds[0], 1024 * 1024);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 7);
+  res = chain.WriteTo(fds[0], 1024);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 1024);
+  while (!chain.empty()) {
+    ASSERT_TRUE(chain.WriteTo(fds[0], 1024 * 1024).IsOk());
+  }
+  close(fds[0]);
+
+  EXPECT_EQ(ReadAll(fds[1]), "header\n" + file_content.substr(10));
+  close(fds[1]);
+  close(file_fd);
+}
+
+// MSG_MORE を付けてヘッダーを書き込んでもデータが変わらないこと
+TEST(OutputChainTest, SendFileWithMsgMore) {
+  std::string file_content(100 * 1024, 'f');
+  int file_fd = OpenTmpFile(file_content);
+
+  OutputChain chain;
+  chain.SetUseSendfile(true);
+  chain.SetUseMsgMore(true);
+  chain.AppendBytes(std::string("header\n"));
+  chain.AppendFile(file_fd, 0, file_content.size());
+  chain.AppendBytes(std::string("trailer\n"));
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  Result<size_t> res = chain.WriteTo(fds[0], 1024 * 1024);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 7);
+  while (!chain.empty()) {
+    ASSERT_TRUE(chain.WriteTo(fds[0], 1024 * 1024).IsOk());
+  }
+  close(fds[0]);
+
+  EXPECT_EQ(ReadAll(fds[1]), "header\n" + file_content + "trailer\n");
+  close(fds[1]);
+  close(file_fd);
+}
+
+TEST(OutputChainTest, PartialWrite) {
+  OutputChain chain;
+  chain.AppendBytes(std::string("0123456789"));
+  chain.AppendBytes(std::string(8 * 1024, 'a'));
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  Result<size_t> res = chain.WriteTo(fds[1], 3);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 3);
+  EXPECT_EQ(chain.size(), 7 + 8 * 1024);
+  while (!chain.empty()) {
+    ASSERT_TRUE(chain.WriteTo(fds[1], 1000).IsOk());
+  }
+  close(fds[1]);
+  EXPECT_EQ(ReadAll(fds[0]), "0123456789" + std::string(8 * 1024, 'a'));
+  close(fds[0]);
+}
+
+// 複数のレスポンスを繋げて1回の writev で書き込む
+TEST(OutputChainTest, AppendChain) {
+  SharedBlob *blob = new SharedBlob("shared\n");
+  OutputChain first;
+  first.AppendBytes(std::string("0123456789"));
+  first.AppendShared(blob);
+  OutputChain second;
+  second.AppendBytes(std::string("second\n"));
+  second.AppendShared(blob);
+  blob->Unref();
+  EXPECT_FALSE(first.HasFile());
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  // 書き込み済みの部分は移さない
+  ASSERT_TRUE(first.WriteTo(fds[1], 3).IsOk());
+  OutputChain output;
+  output.AppendChain(first);
+  output.AppendChain(second);
+  EXPECT_TRUE(first.empty());
+  EXPECT_TRUE(second.empty());
+  EXPECT_EQ(output.size(), 7 + 7 + 7 + 7);
+
+  Result<size_t> res = output.WriteTo(fds[1], 1024 * 1024);
+  ASSERT_TRUE(res.IsOk());
+  EXPECT_EQ(res.Ok(), 7 + 7 + 7 + 7);
+  EXPECT_TRUE(output.empty());
+  close(fds[1]);
+  EXPECT_EQ(ReadAll(fds[0]), "0123456789shared\nsecond\nshared\n");
+  close(fds[0]);
+
+  OutputChain file_chain;
+  file_chain.AppendFile(fds[0], 0, 1);
+  EXPECT_TRUE(file_chain.HasFile());
+}
+
+// ノンブロッキングのソケットに EAGAIN になるまで書き込み､
+// 書き込めた分だけが消費されること
+TEST(OutputChainTest, WriteUntilEagain) {
+  std::string file_content(4 * 1024 * 1024, 'f');
+  for (size_t i = 0; i < file_content.size(); i += 4096) {
+    file_content[i] = static_cast<char>('a' + i / 4096 % 26);
+  }
+  int file_fd = OpenTmpFile(file_content);
+  OutputChain chain;
+  chain.AppendBytes(std::string("header\n"));
+  chain.AppendFile(file_fd, 0, file_content.size());
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  ASSERT_EQ(fcntl(fds[0], F_SETFL, O_NONBLOCK), 0);
+  ASSERT_EQ(fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+
+  std::string received;
+  char buf[64 * 1024];
+  bool is_eagain = false;
+  while (!chain.empty()) {
+    size_t before_size = chain.size();
+    Result<size_t> res = chain.WriteTo(fds[0], 1024 * 1024);
+    if (res.IsErr()) {
+      ASSERT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+      EXPECT_EQ(chain.size(), before_size);
+      is_eagain = true;
+      ssize_t n;
+      while ((n = read(fds[1], buf, sizeof(buf))) > 0) {
+        received.append(buf, n);
+      }
+      continue;
+    }
+    EXPECT_EQ(chain.size(), before_size - res.Ok());
+  }
+  close(fds[0]);
+  ssize_t n;
+  while ((n = read(fds[1], buf, sizeof(buf))) > 0) {
+    received.append(buf, n);
+  }
+  EXPECT_TRUE(is_eagain);
+  EXPECT_TRUE(received == "header\n" + file_content);
+  close(fds[1]);
+  close(file_fd);
+}
+
+TEST(OutputChainTest, TruncatedFileIsError) {
+  int file_fd = OpenTmpFile("abc");
+  OutputChain chain;
+  chain.AppendFile(file_fd, 0, 10);
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ASSERT_TRUE(chain.WriteTo(fds[1], 1024).IsOk());
+  EXPECT_TRUE(chain.WriteTo(fds[1], 1024).IsErr());
+  chain.clear();
+  EXPECT_TRUE(chain.empty());
+  close(fds[0]);
+  close(fds[1]);
+  close(file_fd);
+}
+
+namespace {
+
+// sendfile に対応していない OutputSink
+class NoSendfileSink : public OutputSink {
+ public:
+  std::string written;
+  int sendfile_count;
+
+  NoSendfileSink() : sendfile_count(0) {}
+
+  virtual Result<size_t> Writev(const iovec *iov, int iov_num,
+                                bool has_more) {
+    (void)has_more;
+    size_t size = 0;
+    for (int i = 0; i < iov_num; ++i) {
+      written.append(static_cast<const char *>(iov[i].iov_base),
+                     iov[i].iov_len);
+      size += iov[i].iov_len;
+    }
+    return size;
+  }
+
+  virtual Result<size_t> SendFile(int in_fd, off_t offset, size_t size) {
+    (void)in_fd;
+    (void)offset;
+    (void)size;
+    ++sendfile_count;
+    errno = EINVAL;
+    return Error();
+  }
+};
+
+}  // namespace
+
+// sink が sendfile に対応していなければファイルを読み込んで Writev() する
+TEST(OutputChainTest, FallBackToWritevIfSinkCannotSendfile) {
+  std::string file_content(100 * 1024, 'f');
+  int file_fd = OpenTmpFile(file_content);
+  OutputChain chain;
+  chain.SetUseSendfile(true);
+  chain.AppendBytes(std::string("header\n"));
+  chain.AppendFile(file_fd, 0, file_content.size());
+
+  NoSendfileSink sink;
+  while (!chain.empty()) {
+    ASSERT_TRUE(chain.WriteTo(sink, 1024 * 1024).IsOk());
+  }
+  EXPECT_EQ(sink.sendfile_count, 1);
+  EXPECT_TRUE(sink.written == "header\n" + file_content);
+  close(file_fd);
+}
+
+}  // namespace utils
@@ -50,12 +50,18 @@ TEST_P(PathNormalizationTestOk, Ok) {
   EXPECT_TRUE(IsValidPath(input));
   EXPECT_RESULT_IS_OK(NormalizePath(input));
   EXPECT_RESULT_OK_EQ(NormalizePath(input), expected);
+
+  std::string normalized = input;
+  EXPECT_RESULT_IS_OK(NormalizePathInPlace(normalized));
+  EXPECT_EQ(normalized, param.second);
 }
 
 const std::vector<std::pair<std::string, std::string>> PathNormalizationOkVec =
     {
         {"", ""},
         {"hoge", "hoge"},
+        {"./hoge", "hoge"},
+        {"hoge//fuga/..", "hoge/"},
         {"/", "/"},
         {"/.", "/"},
         {"/./", "/"},
@@ -92,11 +98,13 @@ TEST_P(PathNormalizationTestErr, Ok) {
   std::string input = param;
   EXPECT_FALSE(IsValidPath(input));
   EXPECT_RESULT_IS_ERR(NormalizePath(input));
+  EXPECT_RESULT_IS_ERR(NormalizePathInPlace(input));
 }
 
 const std::vector<std::string> PathNormalizationErrVec = {
     "/..",      "/../",        "///../",       "/..///",
     "///..///", "/hoge/../..", "/hoge/../../", "/hoge/fuga/../../..",
+    "hoge/..",
 };
 
 INSTANTIATE_TEST_SUITE_P(PathNormalizationErr, PathNormalizationTestErr,
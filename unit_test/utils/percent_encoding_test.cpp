@@ -48,6 +48,10 @@ TEST_P(DecodeTestOk, Ok) {
   Result<std::string> expected = prm.second;
   EXPECT_RESULT_IS_OK(PercentDecode(input));
   EXPECT_RESULT_OK_EQ(PercentDecode(input), expected);
+
+  std::string decoded = input;
+  EXPECT_RESULT_IS_OK(PercentDecodeInPlace(decoded));
+  EXPECT_EQ(decoded, expected.Ok());
 }
 
 const std::vector<std::pair<std::string, std::string>> DecodeOkVec = {
@@ -76,10 +80,11 @@ TEST_P(DecodeTestErr, Err) {
   std::string input = GetParam();
 
   EXPECT_RESULT_IS_ERR(PercentDecode(input));
+  EXPECT_RESULT_IS_ERR(PercentDecodeInPlace(input));
 }
 
-const std::vector<std::string> DecodeErrVec = {"%",  "%%", "%%%", "% 01",
-                                               "%1", "%E", "%E3%"};
+const std::vector<std::string> DecodeErrVec = {"%",  "%%", "%%%",  "% 01",
+                                               "%1", "%E", "%E3%", "%00"};
 
 INSTANTIATE_TEST_SUITE_P(DecodeErr, DecodeTestErr,
                          ::testing::ValuesIn(DecodeErrVec));
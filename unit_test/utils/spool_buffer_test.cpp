@@ -0,0 +1,169 @@
+#include "utils/SpoolBuffer.hpp"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+namespace {
+
+const Byte *ToBytes(const std::string &str) {
+  return reinterpret_cast<const Byte *>(str.data());
+}
+
+std::string ReadAll(const SpoolBuffer &spool) {
+  std::string res;
+  Byte buf[7];
+  while (res.size() < spool.size()) {
+    Result<size_t> read_res = spool.Read(res.size(), buf, sizeof(buf));
+    if (read_res.IsErr() || read_res.Ok() == 0) {
+      break;
+    }
+    res.append(reinterpret_cast<const char *>(buf), read_res.Ok());
+  }
+  return res;
+}
+
+// WriteAllTo() で一時ファイルに書き込んで読み出す
+std::string ReadAllFromFile(const SpoolBuffer &spool) {
+  FILE *file = std::tmpfile();
+  EXPECT_TRUE(spool.WriteAllTo(fileno(file)).IsOk());
+  std::rewind(file);
+
+  std::string res;
+  char buf[1024];
+  size_t read_size;
+  while ((read_size = std::fread(buf, 1, sizeof(buf), file)) > 0) {
+    res.append(buf, read_size);
+  }
+  std::fclose(file);
+  return res;
+}
+
+// SpoolBuffer の一時ファイルを開いている fd
+std::vector<int> FindSpoolFds() {
+  std::vector<int> fds;
+  DIR *dir = opendir("/proc/self/fd");
+  if (dir == NULL) {
+    return fds;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != NULL) {
+    std::string link_path = std::string("/proc/self/fd/") + entry->d_name;
+    char target[1024];
+    ssize_t len = readlink(link_path.c_str(), target, sizeof(target) - 1);
+    if (len < 0) {
+      continue;
+    }
+    target[len] = '\0';
+    if (std::string(target).find("webserv_body.") != std::string::npos) {
+      fds.push_back(std::atoi(entry->d_name));
+    }
+  }
+  closedir(dir);
+  return fds;
+}
+
+}  // namespace
+
+TEST(SpoolBufferTest, KeepInMemoryUpToLimit) {
+  SpoolBuffer spool;
+  spool.SetMemoryLimit(10);
+  EXPECT_TRUE(spool.empty());
+  EXPECT_TRUE(spool.Append(ToBytes("hello"), 5).IsOk());
+  EXPECT_TRUE(spool.Append(ToBytes("world"), 5).IsOk());
+  EXPECT_FALSE(spool.IsSpooled());
+  EXPECT_EQ(spool.size(), 10);
+  EXPECT_EQ(ReadAll(spool), "helloworld");
+  EXPECT_EQ(ReadAllFromFile(spool), "helloworld");
+}
+
+TEST(SpoolBufferTest, SpoolToFileOverLimit) {
+  SpoolBuffer spool;
+  spool.SetMemoryLimit(10);
+  EXPECT_TRUE(spool.Append(ToBytes("hello"), 5).IsOk());
+  EXPECT_TRUE(spool.Append(ToBytes("world!"), 6).IsOk());
+  EXPECT_TRUE(spool.IsSpooled());
+  EXPECT_TRUE(spool.Append(ToBytes("abc"), 3).IsOk());
+  EXPECT_EQ(spool.size(), 14);
+  EXPECT_EQ(ReadAll(spool), "helloworld!abc");
+  EXPECT_EQ(ReadAllFromFile(spool), "helloworld!abc");
+
+  Byte buf[4];
+  Result<size_t> read_res = spool.Read(12, buf, sizeof(buf));
+  EXPECT_TRUE(read_res.IsOk());
+  EXPECT_EQ(read_res.Ok(), 2);
+  EXPECT_EQ(std::string(reinterpret_cast<char *>(buf), 2), "bc");
+  EXPECT_EQ(spool.Read(14, buf, sizeof(buf)).Ok(), 0);
+
+  spool.clear();
+  EXPECT_TRUE(spool.empty());
+  EXPECT_FALSE(spool.IsSpooled());
+}
+
+// 0 の場合は最初から一時ファイルに書き込む
+TEST(SpoolBufferTest, ZeroMemoryLimit) {
+  SpoolBuffer spool;
+  spool.SetMemoryLimit(0);
+  EXPECT_TRUE(spool.Append(ToBytes(""), 0).IsOk());
+  EXPECT_FALSE(spool.IsSpooled());
+  EXPECT_TRUE(spool.Append(ToBytes("a"), 1).IsOk());
+  EXPECT_TRUE(spool.IsSpooled());
+  EXPECT_EQ(ReadAll(spool), "a");
+}
+
+TEST(SpoolBufferTest, LargeData) {
+  std::string data;
+  for (size_t i = 0; data.size() < 3 * SpoolBuffer::kCopySize + 5; ++i) {
+    data += static_cast<char>('a' + i % 26);
+  }
+  SpoolBuffer spool;
+  for (size_t i = 0; i < data.size(); i += 1000) {
+    size_t size = std::min<size_t>(1000, data.size() - i);
+    EXPECT_TRUE(spool.Append(ToBytes(data) + i, size).IsOk());
+  }
+  EXPECT_TRUE(spool.IsSpooled());
+  EXPECT_EQ(spool.size(), data.size());
+  EXPECT_EQ(ReadAllFromFile(spool), data);
+}
+
+// コピーしても同じデータを読み出せ､元を破棄しても影響しない
+TEST(SpoolBufferTest, CopySharesSpooledFile) {
+  SpoolBuffer *spool = new SpoolBuffer();
+  spool->SetMemoryLimit(4);
+  EXPECT_TRUE(spool->Append(ToBytes("spooled body"), 12).IsOk());
+  SpoolBuffer copy(*spool);
+  SpoolBuffer assigned;
+  assigned = *spool;
+  delete spool;
+  EXPECT_TRUE(copy.IsSpooled());
+  EXPECT_EQ(ReadAll(copy), "spooled body");
+  EXPECT_EQ(ReadAll(assigned), "spooled body");
+}
+
+// 一時ファイルの fd が CGI の子プロセスに引き継がれない
+TEST(SpoolBufferTest, SpooledFdIsCloseOnExec) {
+  ASSERT_TRUE(FindSpoolFds().empty());
+  SpoolBuffer spool;
+  spool.SetMemoryLimit(4);
+  EXPECT_TRUE(spool.Append(ToBytes("spooled body"), 12).IsOk());
+  SpoolBuffer copy(spool);
+
+  std::vector<int> fds = FindSpoolFds();
+  ASSERT_EQ(fds.size(), 2u);
+  for (size_t i = 0; i < fds.size(); ++i) {
+    int flags = fcntl(fds[i], F_GETFD);
+    ASSERT_GE(flags, 0);
+    EXPECT_TRUE(flags & FD_CLOEXEC) << fds[i];
+  }
+}
+
+}  // namespace utils
@@ -0,0 +1,28 @@
+#include "utils/time.hpp"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+namespace utils {
+
+TEST(TimeTest, FormatImfFixdate) {
+  // RFC 7231 の例
+  EXPECT_EQ(FormatImfFixdate(784111777), "Sun, 06 Nov 1994 08:49:37 GMT");
+  EXPECT_EQ(FormatImfFixdate(0), "Thu, 01 Jan 1970 00:00:00 GMT");
+  EXPECT_EQ(FormatImfFixdate(951782400), "Tue, 29 Feb 2000 00:00:00 GMT");
+}
+
+TEST(TimeTest, CachedClockKeepsTimeUntilUpdate) {
+  CachedClock clock;
+  long now_ms = clock.GetNowMs();
+  EXPECT_GT(now_ms, 0);
+  EXPECT_FALSE(clock.GetImfFixdate().empty());
+  EXPECT_FALSE(clock.GetLogDate().empty());
+
+  usleep(2000);
+  EXPECT_EQ(clock.GetNowMs(), now_ms);
+  clock.Update();
+  EXPECT_GT(clock.GetNowMs(), now_ms);
+}
+
+}  // namespace utils